@@ -0,0 +1,682 @@
+// Boost.Polygon library voronoi_attribute_filter.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_ATTRIBUTE_FILTER
+#define BOOST_POLYGON_VORONOI_ATTRIBUTE_FILTER
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "voronoi_parallel_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Attributes of the elements of a diagram (e.g. the edges) stored as
+// columns: up to 32 named flags packed into one word per element and any
+// number of named numeric columns. The columns are padded with zeros to
+// whole blocks of BLOCK_SIZE rows.
+class voronoi_attribute_table {
+ public:
+  typedef boost::uint32_t flags_type;
+  typedef float value_type;
+
+  static const int MAX_FLAGS = 32;
+  static const std::size_t BLOCK_SIZE = 1024;
+
+  voronoi_attribute_table() : size_(0) {}
+
+  // Declares a flag and returns its bit, or -1 if there are too many.
+  int add_flag(const std::string& name) {
+    if (flag_names_.size() == MAX_FLAGS) {
+      return -1;
+    }
+    flag_names_.push_back(name);
+    return static_cast<int>(flag_names_.size()) - 1;
+  }
+
+  // Declares a numeric column and returns its index.
+  int add_column(const std::string& name) {
+    column_names_.push_back(name);
+    columns_.push_back(std::vector<value_type>(flags_.size()));
+    return static_cast<int>(column_names_.size()) - 1;
+  }
+
+  // Sets the number of the elements, the new ones have no flags set and
+  // zero values.
+  void resize(std::size_t size) {
+    std::size_t padded = (size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    // Rows dropped before are zero again.
+    std::size_t kept = (std::min)(size_, size);
+    size_ = size;
+    flags_.resize(kept);
+    flags_.resize(padded);
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+      columns_[i].resize(kept);
+      columns_[i].resize(padded);
+    }
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  // Releases the rows, keeps the schema.
+  void clear() {
+    size_ = 0;
+    std::vector<flags_type>().swap(flags_);
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+      std::vector<value_type>().swap(columns_[i]);
+    }
+  }
+
+  // Returns the bit of the flag or the index of the column, or -1 if
+  // there is none of that name.
+  int find_flag(const std::string& name) const {
+    return find(flag_names_, name);
+  }
+
+  int find_column(const std::string& name) const {
+    return find(column_names_, name);
+  }
+
+  flags_type* flags() {
+    return flags_.data();
+  }
+
+  const flags_type* flags() const {
+    return flags_.data();
+  }
+
+  value_type* column(int index) {
+    return columns_[index].data();
+  }
+
+  const value_type* column(int index) const {
+    return columns_[index].data();
+  }
+
+ private:
+  static int find(const std::vector<std::string>& names,
+                  const std::string& name) {
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      if (names[i] == name) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  std::size_t size_;
+  std::vector<std::string> flag_names_;
+  std::vector<std::string> column_names_;
+  std::vector<flags_type> flags_;
+  std::vector<std::vector<value_type> > columns_;
+};
+
+// Filter expression over the attributes of a table, such as
+//   primary && internal && length > 50 && !curved
+//   clearance < 3 || (infinite && !primary)
+// A flag is a condition on its own; numeric columns and numbers are
+// compared with <, <=, >, >=, == and !=. Conditions are combined with !,
+// && and || (in the order of precedence) and parentheses; true and false
+// are constants.
+//
+// The expression is compiled once against the names of a table into a
+// postfix program. The program is run over blocks of rows, every
+// instruction makes a pass over the block that yields a byte mask per
+// row, so the inner loops run over contiguous columns without branches
+// and vectorize. The blocks are spread over the threads of the parallel
+// routines.
+class voronoi_attribute_filter {
+ public:
+  typedef voronoi_attribute_table table_type;
+  typedef table_type::flags_type flags_type;
+  typedef table_type::value_type value_type;
+  typedef boost::uint32_t index_type;
+
+  voronoi_attribute_filter() : stack_depth_(0) {}
+
+  // Compiles the expression for the tables of the given schema. Returns
+  // false and sets error, the filter being left unchanged, if the
+  // expression is not valid. An empty expression gives an empty filter.
+  bool compile(const std::string& expression, const table_type& schema,
+               std::string* error) {
+    std::vector<instruction> program;
+    parser parser(expression, schema);
+    if (!parser.parse(&program, error)) {
+      return false;
+    }
+    optimize(&program);
+    int depth = 0;
+    int stack_depth = 0;
+    for (std::size_t i = 0; i < program.size(); ++i) {
+      depth += program[i].op <= PUSH_COMPARE ? 1 :
+               program[i].op == NOT ? 0 : -1;
+      stack_depth = (std::max)(stack_depth, depth);
+    }
+    program_.swap(program);
+    stack_depth_ = stack_depth;
+    return true;
+  }
+
+  // Whether the filter passes every row.
+  bool empty() const {
+    return program_.empty();
+  }
+
+  // Sets indices to the rows of the table that pass the filter, in
+  // increasing order. The table has to have the schema the filter was
+  // compiled for.
+  void select(const table_type& table, std::vector<index_type>* indices) const {
+    if (empty()) {
+      indices->resize(table.size());
+      for (std::size_t i = 0; i < table.size(); ++i) {
+        (*indices)[i] = static_cast<index_type>(i);
+      }
+      return;
+    }
+    // Every chunk writes its rows at its own offset, then the runs are
+    // moved down in order. Reusing indices avoids touching new memory.
+    // The result does not depend on the order of the chunks, so they run
+    // free.
+    std::size_t num_chunks = (table.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::size_t> counts(num_chunks);
+    indices->resize(table.size());
+    voronoi_parallel_chunks(table.size(), CHUNK_SIZE, false,
+        [&](std::size_t chunk, std::size_t first, std::size_t last) {
+      std::vector<unsigned char> stack(stack_depth_ * BLOCK_SIZE);
+      index_type* out = indices->data() + first;
+      std::size_t count = 0;
+      for (std::size_t block = first; block < last; block += BLOCK_SIZE) {
+        std::size_t size = (std::min)(last - block, std::size_t(BLOCK_SIZE));
+        const unsigned char* mask = run(table, block, stack.data());
+        for (std::size_t i = 0; i < size; ++i) {
+          out[count] = static_cast<index_type>(block + i);
+          count += mask[i];
+        }
+      }
+      counts[chunk] = count;
+    });
+    std::size_t total = 0;
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk) {
+      index_type* run_first = indices->data() + chunk * CHUNK_SIZE;
+      std::copy(run_first, run_first + counts[chunk],
+                indices->data() + total);
+      total += counts[chunk];
+    }
+    indices->resize(total);
+  }
+
+ private:
+  // Rows per pass of an instruction, small enough for the masks of the
+  // stack to stay in the cache, and rows per parallel chunk.
+  static const std::size_t BLOCK_SIZE = table_type::BLOCK_SIZE;
+  static const std::size_t CHUNK_SIZE = 64 * BLOCK_SIZE;
+
+  enum opcode {
+    PUSH_CONSTANT,
+    PUSH_FLAGS,
+    PUSH_COMPARE,
+    NOT,
+    AND,
+    OR
+  };
+
+  enum comparison {
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL
+  };
+
+  // A flags test passes the rows with (flags & mask) == bits, so that a
+  // conjunction of flags and negated flags is a single pass. A comparison
+  // always has a column on the left; the right side is the column rhs,
+  // or value if rhs is -1.
+  struct instruction {
+    instruction(opcode op, int arg = 0) :
+        op(op), arg(arg), mask(0), bits(0), cmp(LESS), rhs(-1), value(0) {}
+
+    opcode op;
+    // Constant or left column.
+    int arg;
+    flags_type mask;
+    flags_type bits;
+    comparison cmp;
+    int rhs;
+    value_type value;
+  };
+
+  static instruction flags_test(flags_type mask, flags_type bits) {
+    instruction ins(PUSH_FLAGS);
+    ins.mask = mask;
+    ins.bits = bits;
+    return ins;
+  }
+
+  // Folds the negations and the conjunctions of the flags tests as they
+  // are appended. The operands of an instruction that directly follows
+  // tests are those tests.
+  static void optimize(std::vector<instruction>* program) {
+    std::vector<instruction> result;
+    for (std::size_t i = 0; i < program->size(); ++i) {
+      const instruction& ins = (*program)[i];
+      std::size_t n = result.size();
+      if (ins.op == NOT && n >= 1 && result[n - 1].op == PUSH_FLAGS &&
+          (result[n - 1].mask & (result[n - 1].mask - 1)) == 0) {
+        result[n - 1].bits ^= result[n - 1].mask;
+        continue;
+      }
+      if (ins.op == AND && n >= 2 && result[n - 1].op == PUSH_FLAGS &&
+          result[n - 2].op == PUSH_FLAGS) {
+        instruction& lhs = result[n - 2];
+        const instruction& rhs = result[n - 1];
+        flags_type common = lhs.mask & rhs.mask;
+        if ((lhs.bits & common) != (rhs.bits & common)) {
+          // Contradicting tests, such as curved && !curved.
+          lhs = instruction(PUSH_CONSTANT, 0);
+        } else {
+          lhs.mask |= rhs.mask;
+          lhs.bits |= rhs.bits;
+        }
+        result.pop_back();
+        continue;
+      }
+      result.push_back(ins);
+    }
+    program->swap(result);
+  }
+
+  // Runs the program over the block of rows starting at first and returns
+  // the mask of the result, one byte of 0 or 1 per row. The loops have a
+  // fixed trip count and the tables are padded to whole blocks, so that
+  // they vectorize.
+  const unsigned char* run(const table_type& table, std::size_t first,
+                           unsigned char* stack) const {
+    // Offset of the first byte past the top of the stack.
+    std::size_t end = 0;
+    for (std::size_t k = 0; k < program_.size(); ++k) {
+      const instruction& ins = program_[k];
+      switch (ins.op) {
+        case PUSH_CONSTANT:
+          std::fill(stack + end, stack + end + BLOCK_SIZE,
+                    static_cast<unsigned char>(ins.arg));
+          end += BLOCK_SIZE;
+          break;
+        case PUSH_FLAGS:
+          test_flags(table.flags() + first, ins.mask, ins.bits, stack + end);
+          end += BLOCK_SIZE;
+          break;
+        case PUSH_COMPARE:
+          compare(ins, table, first, stack + end);
+          end += BLOCK_SIZE;
+          break;
+        case NOT:
+          negate(stack + end - BLOCK_SIZE);
+          break;
+        case AND:
+          end -= BLOCK_SIZE;
+          combine(stack + end - BLOCK_SIZE, stack + end,
+                  std::bit_and<unsigned char>());
+          break;
+        case OR:
+          end -= BLOCK_SIZE;
+          combine(stack + end - BLOCK_SIZE, stack + end,
+                  std::bit_or<unsigned char>());
+          break;
+      }
+    }
+    return stack + end - BLOCK_SIZE;
+  }
+
+  static void test_flags(const flags_type* flags, flags_type mask,
+                         flags_type bits, unsigned char* out) {
+    // Staged through a local array, the compiler can not tell otherwise
+    // that out does not overlap flags.
+    flags_type masked[BLOCK_SIZE];
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      masked[i] = flags[i] & mask;
+    }
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      out[i] = masked[i] == bits;
+    }
+  }
+
+  static void negate(unsigned char* mask) {
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      mask[i] ^= 1;
+    }
+  }
+
+  template <typename Operation>
+  static void combine(unsigned char* lhs, const unsigned char* rhs,
+                      Operation op) {
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      lhs[i] = op(lhs[i], rhs[i]);
+    }
+  }
+
+  template <typename Compare>
+  static void compare(const value_type* lhs, value_type value,
+                      unsigned char* out, Compare cmp) {
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      out[i] = cmp(lhs[i], value);
+    }
+  }
+
+  template <typename Compare>
+  static void compare(const value_type* lhs, const value_type* rhs,
+                      unsigned char* out, Compare cmp) {
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+      out[i] = cmp(lhs[i], rhs[i]);
+    }
+  }
+
+  template <typename Rhs>
+  static void compare(comparison cmp, const value_type* lhs, Rhs rhs,
+                      unsigned char* out) {
+    switch (cmp) {
+      case LESS:
+        compare(lhs, rhs, out, std::less<value_type>());
+        break;
+      case LESS_EQUAL:
+        compare(lhs, rhs, out, std::less_equal<value_type>());
+        break;
+      case GREATER:
+        compare(lhs, rhs, out, std::greater<value_type>());
+        break;
+      case GREATER_EQUAL:
+        compare(lhs, rhs, out, std::greater_equal<value_type>());
+        break;
+      case EQUAL:
+        compare(lhs, rhs, out, std::equal_to<value_type>());
+        break;
+      case NOT_EQUAL:
+        compare(lhs, rhs, out, std::not_equal_to<value_type>());
+        break;
+    }
+  }
+
+  static void compare(const instruction& ins, const table_type& table,
+                      std::size_t first, unsigned char* out) {
+    const value_type* lhs = table.column(ins.arg) + first;
+    if (ins.rhs < 0) {
+      compare(ins.cmp, lhs, ins.value, out);
+    } else {
+      compare(ins.cmp, lhs, table.column(ins.rhs) + first, out);
+    }
+  }
+
+  // Recursive descent parser emitting the postfix program:
+  //   or: and ("||" and)*
+  //   and: not ("&&" not)*
+  //   not: "!" not | "(" or ")" | condition
+  //   condition: flag | "true" | "false" | operand cmp operand
+  //   operand: column | number
+  class parser {
+   public:
+    parser(const std::string& text, const table_type& schema) :
+        text_(text), schema_(schema), pos_(0) {}
+
+    bool parse(std::vector<instruction>* program, std::string* error) {
+      program_ = program;
+      skip_spaces();
+      if (pos_ == text_.size()) {
+        return true;
+      }
+      if (!parse_or()) {
+        *error = error_;
+        return false;
+      }
+      if (pos_ != text_.size()) {
+        *error = message("unexpected input");
+        return false;
+      }
+      return true;
+    }
+
+   private:
+    bool parse_or() {
+      if (!parse_and()) {
+        return false;
+      }
+      while (accept("||")) {
+        if (!parse_and()) {
+          return false;
+        }
+        program_->push_back(instruction(OR));
+      }
+      return true;
+    }
+
+    bool parse_and() {
+      if (!parse_not()) {
+        return false;
+      }
+      while (accept("&&")) {
+        if (!parse_not()) {
+          return false;
+        }
+        program_->push_back(instruction(AND));
+      }
+      return true;
+    }
+
+    bool parse_not() {
+      if (text_.compare(pos_, 2, "!=") != 0 && accept("!")) {
+        if (!parse_not()) {
+          return false;
+        }
+        program_->push_back(instruction(NOT));
+        return true;
+      }
+      if (accept("(")) {
+        if (!parse_or()) {
+          return false;
+        }
+        if (!accept(")")) {
+          return fail("expected )");
+        }
+        return true;
+      }
+      return parse_condition();
+    }
+
+    bool parse_condition() {
+      std::size_t start = pos_;
+      std::string name = identifier();
+      if (name == "true" || name == "false") {
+        program_->push_back(instruction(PUSH_CONSTANT, name == "true"));
+        return true;
+      }
+      if (!name.empty()) {
+        int bit = schema_.find_flag(name);
+        if (bit >= 0) {
+          flags_type flag = flags_type(1) << bit;
+          program_->push_back(flags_test(flag, flag));
+          return true;
+        }
+      }
+      pos_ = start;
+      operand lhs, rhs;
+      if (!parse_operand(&lhs)) {
+        return false;
+      }
+      comparison cmp;
+      if (!parse_comparison(&cmp)) {
+        return fail("expected a comparison");
+      }
+      if (!parse_operand(&rhs)) {
+        return false;
+      }
+      if (lhs.column < 0 && rhs.column < 0) {
+        program_->push_back(instruction(
+            PUSH_CONSTANT, evaluate(lhs.value, cmp, rhs.value)));
+        return true;
+      }
+      if (lhs.column < 0) {
+        std::swap(lhs, rhs);
+        cmp = mirror(cmp);
+      }
+      instruction ins(PUSH_COMPARE, lhs.column);
+      ins.cmp = cmp;
+      ins.rhs = rhs.column;
+      ins.value = rhs.value;
+      program_->push_back(ins);
+      return true;
+    }
+
+    struct operand {
+      operand() : column(-1), value(0) {}
+
+      int column;
+      value_type value;
+    };
+
+    bool parse_operand(operand* result) {
+      skip_spaces();
+      std::size_t start = pos_;
+      std::string name = identifier();
+      if (!name.empty()) {
+        result->column = schema_.find_column(name);
+        if (result->column < 0) {
+          pos_ = start;
+          return fail("unknown attribute " + name);
+        }
+        return true;
+      }
+      const char* begin = text_.c_str() + pos_;
+      char* end = NULL;
+      double value = std::strtod(begin, &end);
+      if (end == begin) {
+        return fail("expected an attribute or a number");
+      }
+      pos_ += end - begin;
+      result->value = static_cast<value_type>(value);
+      skip_spaces();
+      return true;
+    }
+
+    bool parse_comparison(comparison* cmp) {
+      static const char* const names[] = {"<=", ">=", "==", "!=", "<", ">"};
+      static const comparison values[] = {
+        LESS_EQUAL, GREATER_EQUAL, EQUAL, NOT_EQUAL, LESS, GREATER
+      };
+      for (int i = 0; i < 6; ++i) {
+        if (accept(names[i])) {
+          *cmp = values[i];
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static comparison mirror(comparison cmp) {
+      switch (cmp) {
+        case LESS:
+          return GREATER;
+        case LESS_EQUAL:
+          return GREATER_EQUAL;
+        case GREATER:
+          return LESS;
+        case GREATER_EQUAL:
+          return LESS_EQUAL;
+        default:
+          return cmp;
+      }
+    }
+
+    static bool evaluate(value_type lhs, comparison cmp, value_type rhs) {
+      switch (cmp) {
+        case LESS:
+          return lhs < rhs;
+        case LESS_EQUAL:
+          return lhs <= rhs;
+        case GREATER:
+          return lhs > rhs;
+        case GREATER_EQUAL:
+          return lhs >= rhs;
+        case EQUAL:
+          return lhs == rhs;
+        default:
+          return lhs != rhs;
+      }
+    }
+
+    // Reads an identifier and the spaces after it, or nothing if there
+    // is none.
+    std::string identifier() {
+      skip_spaces();
+      std::size_t start = pos_;
+      if (pos_ < text_.size() &&
+          (std::isalpha(static_cast<unsigned char>(text_[pos_])) ||
+           text_[pos_] == '_')) {
+        while (pos_ < text_.size() &&
+               (std::isalnum(static_cast<unsigned char>(text_[pos_])) ||
+                text_[pos_] == '_')) {
+          ++pos_;
+        }
+      }
+      std::string name = text_.substr(start, pos_ - start);
+      skip_spaces();
+      return name;
+    }
+
+    bool accept(const char* token) {
+      skip_spaces();
+      std::string value(token);
+      if (text_.compare(pos_, value.size(), value) != 0) {
+        return false;
+      }
+      pos_ += value.size();
+      skip_spaces();
+      return true;
+    }
+
+    void skip_spaces() {
+      while (pos_ < text_.size() &&
+             std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+        ++pos_;
+      }
+    }
+
+    bool fail(const std::string& what) {
+      if (error_.empty()) {
+        error_ = message(what);
+      }
+      return false;
+    }
+
+    std::string message(const std::string& what) const {
+      return what + " at column " + std::to_string(pos_ + 1);
+    }
+
+    const std::string& text_;
+    const table_type& schema_;
+    std::size_t pos_;
+    std::vector<instruction>* program_;
+    std::string error_;
+  };
+
+  std::vector<instruction> program_;
+  int stack_depth_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_ATTRIBUTE_FILTER
@@ -0,0 +1,368 @@
+// Boost.Polygon library voronoi_determinism_check.cpp file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+// Runs the parallel stages of the visualizer pipeline that do not need a
+// window with 1, 2, 4, ... up to max_threads threads, in the free running
+// and in the deterministic mode of the parallel routines. Every stage
+// output is hashed: in the deterministic mode the hashes have to agree for
+// all the thread counts. The best time of several runs is reported for
+// both modes, so the cost of the determinism can be read off per stage.
+//
+// Stages:
+//   sites: sorting and deduplication of the site points;
+//   classify: winding number classification of the diagram vertices;
+//   sample: edge sampling merged into a quantized render layer;
+//   tile bin: binning of the sampled edges into the tiles of a zoom level;
+//   preview: raster preview labels.
+//
+// Usage: voronoi_determinism_check [-r runs] [-t max_threads] file...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/polygon/polygon.hpp>
+#include <boost/polygon/voronoi.hpp>
+using namespace boost::polygon;
+
+#include "voronoi_input.hpp"
+#include "voronoi_interior_classifier.hpp"
+#include "voronoi_parallel_utils.hpp"
+#include "voronoi_quantized_layer.hpp"
+#include "voronoi_raster_preview.hpp"
+#include "voronoi_tile_pyramid.hpp"
+#include "voronoi_visual_utils.hpp"
+
+typedef double coordinate_type;
+typedef point_data<coordinate_type> point_type;
+typedef segment_data<coordinate_type> segment_type;
+typedef voronoi_diagram<coordinate_type> VD;
+
+static const int NUM_STAGES = 5;
+static const char* stage_names[NUM_STAGES] = {
+    "sites", "classify", "sample", "tile bin", "preview"};
+
+// 64 bit FNV-1a hash of the stage outputs.
+class output_hash {
+ public:
+  output_hash() : value_(14695981039346656037ULL) {}
+
+  template <typename T>
+  void add(const T* data, std::size_t count) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < count * sizeof(T); ++i) {
+      value_ = (value_ ^ bytes[i]) * 1099511628211ULL;
+    }
+  }
+
+  template <typename T>
+  void add(const std::vector<T>& values) {
+    add(values.data(), values.size());
+  }
+
+  boost::uint64_t value() const {
+    return value_;
+  }
+
+ private:
+  boost::uint64_t value_;
+};
+
+// Input and diagram shared by all the runs.
+struct check_input {
+  std::vector<point_type> points;
+  std::vector<segment_type> segments;
+  VD vd;
+  coordinate_type xl, yl, side;
+};
+
+// Sampled finite edges, samples stored back to back as in the visualizer.
+struct edge_polylines {
+  edge_polylines() : starts(1, 0) {}
+
+  std::vector<point_type> samples;
+  std::vector<std::size_t> starts;
+};
+
+static point_type retrieve_point(const check_input& input,
+                                 const VD::cell_type& cell) {
+  std::size_t index = cell.source_index();
+  if (cell.source_category() == SOURCE_CATEGORY_SINGLE_POINT) {
+    return input.points[index];
+  }
+  index -= input.points.size();
+  if (cell.source_category() == SOURCE_CATEGORY_SEGMENT_START_POINT) {
+    return low(input.segments[index]);
+  }
+  return high(input.segments[index]);
+}
+
+static void sample_edges(const check_input& input, edge_polylines* output) {
+  const VD::edge_container_type& edges = input.vd.edges();
+  coordinate_type max_dist = 1E-3 * input.side;
+  voronoi_parallel_reduce(edges.size(), 4096, output,
+      [&](std::size_t first, std::size_t last, edge_polylines* partial) {
+    std::vector<point_type> samples;
+    for (std::size_t i = first; i < last; ++i) {
+      const VD::edge_type& edge = edges[i];
+      if (!edge.is_finite() || edge.twin() < &edge) {
+        continue;
+      }
+      samples.clear();
+      samples.push_back(point_type(edge.vertex0()->x(), edge.vertex0()->y()));
+      samples.push_back(point_type(edge.vertex1()->x(), edge.vertex1()->y()));
+      if (edge.is_curved()) {
+        const VD::cell_type* point_cell = edge.cell()->contains_point() ?
+            edge.cell() : edge.twin()->cell();
+        const VD::cell_type* segment_cell = edge.cell()->contains_point() ?
+            edge.twin()->cell() : edge.cell();
+        voronoi_visual_utils<coordinate_type>::discretize(
+            retrieve_point(input, *point_cell),
+            input.segments[segment_cell->source_index() -
+                           input.points.size()],
+            max_dist, &samples);
+      }
+      partial->samples.insert(partial->samples.end(), samples.begin(),
+                              samples.end());
+      partial->starts.push_back(partial->samples.size());
+    }
+  }, [](edge_polylines* result, edge_polylines* partial) {
+    std::size_t offset = result->samples.size();
+    result->samples.insert(result->samples.end(), partial->samples.begin(),
+                           partial->samples.end());
+    for (std::size_t i = 1; i < partial->starts.size(); ++i) {
+      result->starts.push_back(offset + partial->starts[i]);
+    }
+  });
+}
+
+// Runs the stage once and returns the hash of its output.
+static boost::uint64_t run_stage(int stage, const check_input& input) {
+  output_hash hash;
+  switch (stage) {
+    case 0: {
+      std::vector<point_type> sites(input.points);
+      for (std::size_t i = 0; i < input.segments.size(); ++i) {
+        sites.push_back(low(input.segments[i]));
+        sites.push_back(high(input.segments[i]));
+      }
+      voronoi_parallel_sort(sites.begin(), sites.end(),
+                            [](const point_type& lhs, const point_type& rhs) {
+        return lhs.x() < rhs.x() || (lhs.x() == rhs.x() && lhs.y() < rhs.y());
+      });
+      sites.erase(std::unique(sites.begin(), sites.end()), sites.end());
+      hash.add(sites);
+      break;
+    }
+    case 1: {
+      typedef voronoi_interior_classifier<coordinate_type> classifier_type;
+      const classifier_type classifier(input.segments, 1E-9 * input.side);
+      const VD::vertex_container_type& vertices = input.vd.vertices();
+      std::vector<unsigned char> locations(vertices.size());
+      voronoi_parallel_for(vertices.size(), 4096,
+                           [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+          locations[i] = static_cast<unsigned char>(
+              classifier.locate(vertices[i].x(), vertices[i].y()));
+        }
+      });
+      hash.add(locations);
+      break;
+    }
+    case 2: {
+      edge_polylines polylines;
+      sample_edges(input, &polylines);
+      voronoi_quantized_layer<coordinate_type> layer(
+          input.side / 16384, input.xl - input.side, input.yl - input.side,
+          input.xl + 2 * input.side, input.yl + 2 * input.side);
+      for (std::size_t i = 0; i + 1 < polylines.starts.size(); ++i) {
+        layer.begin_strip();
+        for (std::size_t j = polylines.starts[i];
+             j < polylines.starts[i + 1]; ++j) {
+          layer.add_vertex(polylines.samples[j].x(),
+                           polylines.samples[j].y());
+        }
+      }
+      for (std::size_t i = 0; i < layer.tiles().size(); ++i) {
+        hash.add(&layer.tiles()[i].x, 1);
+        hash.add(&layer.tiles()[i].y, 1);
+        hash.add(layer.tiles()[i].offsets);
+        hash.add(layer.tiles()[i].strips);
+      }
+      break;
+    }
+    case 3: {
+      edge_polylines polylines;
+      sample_edges(input, &polylines);
+      voronoi_tile_pyramid<coordinate_type> pyramid(input.xl, input.yl,
+                                                    input.side);
+      for (std::size_t i = 0; i + 1 < polylines.starts.size(); ++i) {
+        pyramid.begin_polyline(0);
+        for (std::size_t j = polylines.starts[i];
+             j < polylines.starts[i + 1]; ++j) {
+          pyramid.add_vertex(polylines.samples[j].x(),
+                             polylines.samples[j].y());
+        }
+      }
+      voronoi_tile_pyramid<coordinate_type>::level level;
+      pyramid.bin(6, 0, &level);
+      for (std::size_t i = 0; i < level.tiles.size(); ++i) {
+        hash.add(&level.tiles[i], 1);
+      }
+      hash.add(level.item_start);
+      for (std::size_t i = 0; i < level.items.size(); ++i) {
+        // Items are numbered in the order of the polylines, hash their
+        // geometry instead.
+        hash.add(pyramid.item_coords(level.items[i]),
+                 2 * pyramid.item_size(level.items[i]));
+      }
+      break;
+    }
+    case 4: {
+      voronoi_raster_preview<coordinate_type> preview(
+          input.points, input.segments, input.xl, input.yl,
+          input.xl + input.side, input.yl + input.side);
+      std::vector<voronoi_raster_preview<coordinate_type>::label_type> labels;
+      preview.label(512, 512, &labels);
+      hash.add(labels);
+      break;
+    }
+  }
+  return hash.value();
+}
+
+int main(int argc, char* argv[]) {
+  int runs = 5;
+  std::size_t max_threads = (std::max)(std::size_t(4),
+                                       voronoi_thread_count());
+  int first_file = 1;
+  while (first_file + 1 < argc && argv[first_file][0] == '-') {
+    if (std::strcmp(argv[first_file], "-r") == 0) {
+      runs = (std::max)(1, std::atoi(argv[first_file + 1]));
+    } else if (std::strcmp(argv[first_file], "-t") == 0) {
+      max_threads = (std::max)(1, std::atoi(argv[first_file + 1]));
+    } else {
+      break;
+    }
+    first_file += 2;
+  }
+  if (first_file >= argc || argv[first_file][0] == '-') {
+    std::cerr << "Usage: " << argv[0] << " [-r runs] [-t max_threads] file..."
+              << std::endl;
+    return 1;
+  }
+  std::vector<std::size_t> thread_counts;
+  for (std::size_t t = 1; t < max_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(max_threads);
+
+  int failures = 0;
+  for (int i = first_file; i < argc; ++i) {
+    check_input input;
+    std::ifstream in(argv[i]);
+    if (!in || !read_voronoi_input(in, &input.points, &input.segments)) {
+      std::cerr << "Unable to read " << argv[i] << std::endl;
+      continue;
+    }
+    construct_voronoi(input.points.begin(), input.points.end(),
+                      input.segments.begin(), input.segments.end(),
+                      &input.vd);
+    std::vector<point_type> corners(input.points);
+    for (std::size_t j = 0; j < input.segments.size(); ++j) {
+      corners.push_back(low(input.segments[j]));
+      corners.push_back(high(input.segments[j]));
+    }
+    coordinate_type xh = 0, yh = 0;
+    input.xl = input.yl = 0;
+    for (std::size_t j = 0; j < corners.size(); ++j) {
+      if (j == 0) {
+        input.xl = xh = corners[j].x();
+        input.yl = yh = corners[j].y();
+      }
+      input.xl = (std::min)(input.xl, corners[j].x());
+      input.yl = (std::min)(input.yl, corners[j].y());
+      xh = (std::max)(xh, corners[j].x());
+      yh = (std::max)(yh, corners[j].y());
+    }
+    input.side = (std::max)(coordinate_type(1),
+                            (std::max)(xh - input.xl, yh - input.yl));
+
+    std::cout << argv[i] << std::endl;
+    std::cout << std::left << std::setw(12) << "stage"
+              << std::setw(16) << "mode"
+              << std::right << std::setw(8) << "threads"
+              << std::setw(12) << "best ms"
+              << std::setw(20) << "hash" << std::endl;
+    for (int stage = 0; stage < NUM_STAGES; ++stage) {
+      // best_ms[mode][thread count index]
+      std::vector<double> best_ms[2];
+      bool identical[2] = {true, true};
+      for (int mode = 0; mode < 2; ++mode) {
+        voronoi_parallel_config().deterministic = mode == 1;
+        boost::uint64_t first_hash = 0;
+        for (std::size_t t = 0; t < thread_counts.size(); ++t) {
+          voronoi_parallel_config().num_threads = thread_counts[t];
+          double best = 0.0;
+          boost::uint64_t hash = 0;
+          for (int run = 0; run < runs; ++run) {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            boost::uint64_t run_hash = run_stage(stage, input);
+            double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || ms < best) {
+              best = ms;
+            }
+            // Free running, different runs may differ as well.
+            if (run == 0) {
+              hash = run_hash;
+            } else if (run_hash != hash) {
+              identical[mode] = false;
+            }
+          }
+          if (t == 0) {
+            first_hash = hash;
+          } else if (hash != first_hash) {
+            identical[mode] = false;
+          }
+          best_ms[mode].push_back(best);
+          std::cout << std::left << std::setw(12) << stage_names[stage]
+                    << std::setw(16)
+                    << (mode ? "deterministic" : "free running")
+                    << std::right << std::setw(8) << thread_counts[t]
+                    << std::setw(12) << std::fixed << std::setprecision(3)
+                    << best << std::setw(4) << " " << std::hex
+                    << std::setfill('0') << std::setw(16) << hash
+                    << std::dec << std::setfill(' ') << std::endl;
+        }
+      }
+      double cost = best_ms[1].back() / best_ms[0].back();
+      std::cout << std::left << std::setw(12) << stage_names[stage]
+                << "free running " << (identical[0] ? "stable" : "VARIES")
+                << ", deterministic "
+                << (identical[1] ? "stable" : "VARIES")
+                << ", cost at " << thread_counts.back() << " threads "
+                << std::setprecision(2) << cost << "x" << std::endl;
+      if (!identical[1]) {
+        ++failures;
+      }
+    }
+  }
+  voronoi_parallel_config().deterministic = true;
+  voronoi_parallel_config().num_threads = 0;
+  return failures ? 2 : 0;
+}
@@ -0,0 +1,142 @@
+// Boost.Polygon library voronoi_edge_chains.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_EDGE_CHAINS
+#define BOOST_POLYGON_VORONOI_EDGE_CHAINS
+
+#include <cstddef>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Maximal chains of Voronoi edges joined at the vertices of degree two.
+//
+// Only the accepted edges count: a vertex continues a chain if exactly two
+// accepted edges meet there and their keys are equal, so chains break at
+// branching points, at the vertices where the accepted edges end and
+// where the style of the edges changes. Every accepted edge belongs to
+// exactly one chain, as one of its two half-edges; chains are oriented so
+// that the vertex1 of an edge is the vertex0 of the next one, and a
+// closed chain ends at the vertex it starts from.
+//
+// Accept and key are evaluated on one half-edge of every twin pair, so
+// they need not be symmetric. Stitching is linear in the number of edges,
+// every vertex is visited once per edge that ends there.
+template <typename VD>
+class voronoi_edge_chains {
+ public:
+  typedef typename VD::edge_type edge_type;
+  typedef typename VD::vertex_type vertex_type;
+
+  voronoi_edge_chains() : starts_(1, 0) {}
+
+  template <typename Accept, typename Key>
+  void stitch(const VD& vd, Accept accept, Key key) {
+    clear();
+    const typename VD::edge_container_type& edges = vd.edges();
+    if (edges.empty()) {
+      return;
+    }
+    const edge_type* first = &edges[0];
+    // Evaluate the predicates once per twin pair.
+    std::vector<char> accepted(edges.size(), 0);
+    std::vector<unsigned> keys(edges.size(), 0);
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+      const edge_type& edge = edges[i];
+      if (edge.twin() < &edge) {
+        std::size_t twin = edge.twin() - first;
+        accepted[i] = accepted[twin];
+        keys[i] = keys[twin];
+      } else if (accept(edge)) {
+        accepted[i] = 1;
+        keys[i] = static_cast<unsigned>(key(edge));
+      }
+    }
+    std::vector<char> visited(edges.size(), 0);
+    // Open chains start at the half-edges without a predecessor, closed
+    // ones at any edge left over.
+    for (int pass = 0; pass < 2; ++pass) {
+      for (std::size_t i = 0; i < edges.size(); ++i) {
+        if (!accepted[i] || visited[i]) {
+          continue;
+        }
+        const edge_type* edge = &edges[i];
+        if (pass == 0 &&
+            next(edge->twin(), first, accepted, keys) != NULL) {
+          continue;
+        }
+        while (edge != NULL && !visited[edge - first]) {
+          visited[edge - first] = 1;
+          visited[edge->twin() - first] = 1;
+          edges_.push_back(edge);
+          edge = next(edge, first, accepted, keys);
+        }
+        starts_.push_back(edges_.size());
+      }
+    }
+  }
+
+  void clear() {
+    edges_.clear();
+    starts_.resize(1);
+  }
+
+  std::size_t size() const {
+    return starts_.size() - 1;
+  }
+
+  // Half-edges of chain i, in order.
+  const edge_type* const* chain_begin(std::size_t i) const {
+    return edges_.data() + starts_[i];
+  }
+
+  const edge_type* const* chain_end(std::size_t i) const {
+    return edges_.data() + starts_[i + 1];
+  }
+
+  // Total number of edges in all the chains.
+  std::size_t num_edges() const {
+    return edges_.size();
+  }
+
+ private:
+  // The accepted edge continuing the chain past the vertex1 of the edge,
+  // or NULL if the chain ends there.
+  static const edge_type* next(const edge_type* edge, const edge_type* first,
+                               const std::vector<char>& accepted,
+                               const std::vector<unsigned>& keys) {
+    const vertex_type* vertex = edge->vertex1();
+    if (vertex == NULL) {
+      return NULL;
+    }
+    const edge_type* result = NULL;
+    const edge_type* it = vertex->incident_edge();
+    do {
+      if (it != edge->twin() && accepted[it - first]) {
+        if (result != NULL) {
+          return NULL;
+        }
+        result = it;
+      }
+      it = it->rot_next();
+    } while (it != vertex->incident_edge());
+    if (result == NULL || keys[result - first] != keys[edge - first]) {
+      return NULL;
+    }
+    return result;
+  }
+
+  std::vector<const edge_type*> edges_;
+  // Chain i is edges_[starts_[i]..starts_[i + 1]).
+  std::vector<std::size_t> starts_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_EDGE_CHAINS
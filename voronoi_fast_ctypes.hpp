@@ -0,0 +1,226 @@
+// Boost.Polygon library voronoi_fast_ctypes.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_FAST_CTYPES
+#define BOOST_POLYGON_VORONOI_FAST_CTYPES
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include <boost/polygon/detail/voronoi_ctypes.hpp>
+
+namespace boost {
+namespace polygon {
+// Drop-in replacement of detail::extended_exponent_fpt<fpt64>. The value is
+// kept as a significand in [0.5, 1) and an integer exponent, as in the
+// original, but the normalization and the alignment of the operands work on
+// the bits of the double instead of calling frexp and ldexp. The results
+// are bit identical to the original.
+class voronoi_fast_efpt {
+ public:
+  typedef detail::fpt64 fpt_type;
+  typedef int exp_type;
+
+  explicit voronoi_fast_efpt(fpt_type val) {
+    normalize(val, 0);
+  }
+
+  voronoi_fast_efpt(fpt_type val, exp_type exp) {
+    normalize(val, exp);
+  }
+
+  bool is_pos() const {
+    return val_ > 0;
+  }
+
+  bool is_neg() const {
+    return val_ < 0;
+  }
+
+  bool is_zero() const {
+    return val_ == 0;
+  }
+
+  voronoi_fast_efpt operator-() const {
+    return voronoi_fast_efpt(-val_, exp_);
+  }
+
+  voronoi_fast_efpt operator+(const voronoi_fast_efpt& that) const {
+    if (this->val_ == 0.0 ||
+        that.exp_ > this->exp_ + MAX_SIGNIFICANT_EXP_DIF) {
+      return that;
+    }
+    if (that.val_ == 0.0 ||
+        this->exp_ > that.exp_ + MAX_SIGNIFICANT_EXP_DIF) {
+      return *this;
+    }
+    if (this->exp_ >= that.exp_) {
+      fpt_type val = this->val_ * pow2(this->exp_ - that.exp_) + that.val_;
+      return voronoi_fast_efpt(val, that.exp_);
+    } else {
+      fpt_type val = that.val_ * pow2(that.exp_ - this->exp_) + this->val_;
+      return voronoi_fast_efpt(val, this->exp_);
+    }
+  }
+
+  voronoi_fast_efpt operator-(const voronoi_fast_efpt& that) const {
+    if (this->val_ == 0.0 ||
+        that.exp_ > this->exp_ + MAX_SIGNIFICANT_EXP_DIF) {
+      return voronoi_fast_efpt(-that.val_, that.exp_);
+    }
+    if (that.val_ == 0.0 ||
+        this->exp_ > that.exp_ + MAX_SIGNIFICANT_EXP_DIF) {
+      return *this;
+    }
+    if (this->exp_ >= that.exp_) {
+      fpt_type val = this->val_ * pow2(this->exp_ - that.exp_) - that.val_;
+      return voronoi_fast_efpt(val, that.exp_);
+    } else {
+      fpt_type val = -that.val_ * pow2(that.exp_ - this->exp_) + this->val_;
+      return voronoi_fast_efpt(val, this->exp_);
+    }
+  }
+
+  voronoi_fast_efpt operator*(const voronoi_fast_efpt& that) const {
+    return voronoi_fast_efpt(this->val_ * that.val_, this->exp_ + that.exp_);
+  }
+
+  voronoi_fast_efpt operator/(const voronoi_fast_efpt& that) const {
+    return voronoi_fast_efpt(this->val_ / that.val_, this->exp_ - that.exp_);
+  }
+
+  voronoi_fast_efpt& operator+=(const voronoi_fast_efpt& that) {
+    return *this = *this + that;
+  }
+
+  voronoi_fast_efpt& operator-=(const voronoi_fast_efpt& that) {
+    return *this = *this - that;
+  }
+
+  voronoi_fast_efpt& operator*=(const voronoi_fast_efpt& that) {
+    return *this = *this * that;
+  }
+
+  voronoi_fast_efpt& operator/=(const voronoi_fast_efpt& that) {
+    return *this = *this / that;
+  }
+
+  voronoi_fast_efpt sqrt() const {
+    fpt_type val = val_;
+    exp_type exp = exp_;
+    if (exp & 1) {
+      val *= 2.0;
+      --exp;
+    }
+    return voronoi_fast_efpt(std::sqrt(val), exp >> 1);
+  }
+
+  fpt_type d() const {
+    return std::ldexp(val_, exp_);
+  }
+
+ private:
+  enum {
+    MAX_SIGNIFICANT_EXP_DIF = 54
+  };
+
+  static const detail::uint64 EXP_MASK = 0x7ffULL << 52;
+  // Biased exponent of the values in [0.5, 1).
+  static const detail::uint64 HALF_EXP = 1022ULL;
+
+  // 2^exp for 0 <= exp <= MAX_SIGNIFICANT_EXP_DIF.
+  static fpt_type pow2(exp_type exp) {
+    detail::uint64 bits = static_cast<detail::uint64>(1023 + exp) << 52;
+    fpt_type result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  void normalize(fpt_type val, exp_type exp) {
+    detail::uint64 bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    int biased_exp = static_cast<int>((bits & EXP_MASK) >> 52);
+    if (biased_exp == 0 || biased_exp == 0x7ff) {
+      // Zero, subnormal, infinite and NaN values.
+      val_ = std::frexp(val, &exp_);
+      exp_ += exp;
+      return;
+    }
+    exp_ = biased_exp - static_cast<int>(HALF_EXP) + exp;
+    bits = (bits & ~EXP_MASK) | (HALF_EXP << 52);
+    std::memcpy(&val_, &bits, sizeof(val_));
+  }
+
+  fpt_type val_;
+  exp_type exp_;
+};
+
+inline voronoi_fast_efpt get_sqrt(const voronoi_fast_efpt& that) {
+  return that.sqrt();
+}
+
+inline bool is_pos(const voronoi_fast_efpt& that) {
+  return that.is_pos();
+}
+
+inline bool is_neg(const voronoi_fast_efpt& that) {
+  return that.is_neg();
+}
+
+inline bool is_zero(const voronoi_fast_efpt& that) {
+  return that.is_zero();
+}
+
+struct voronoi_fast_to_fpt_converter : public detail::type_converter_fpt {
+  using detail::type_converter_fpt::operator();
+
+  detail::fpt64 operator()(const voronoi_fast_efpt& that) const {
+    return that.d();
+  }
+};
+
+struct voronoi_fast_to_efpt_converter {
+  template <std::size_t N>
+  voronoi_fast_efpt operator()(const detail::extended_int<N>& that) const {
+    std::pair<detail::fpt64, int> p = that.p();
+    return voronoi_fast_efpt(p.first, p.second);
+  }
+};
+
+// Default traits of the 32 bit coordinates with voronoi_fast_efpt as the
+// extended exponent type. Valid for any input.
+struct voronoi_fast_efpt_ctype_traits :
+    public detail::voronoi_ctype_traits<detail::int32> {
+  typedef voronoi_fast_efpt efpt_type;
+  typedef voronoi_fast_to_fpt_converter to_fpt_converter_type;
+  typedef voronoi_fast_to_efpt_converter to_efpt_converter_type;
+};
+
+#ifdef __SIZEOF_INT128__
+// Traits of the 32 bit coordinates with the native 128 bit integer as the
+// big integer type. Only valid for point inputs with the coordinates in
+// [-MAX_COORDINATE, MAX_COORDINATE]: the largest intermediate value of the
+// exact circle event computation of three points is below 2^(6k + 11) for
+// coordinates below 2^k in magnitude. The segment predicates need far more
+// bits and must not be used with these traits. Values below 2^127 do not
+// need an extended exponent, so efpt is a plain double.
+struct voronoi_int128_ctype_traits :
+    public detail::voronoi_ctype_traits<detail::int32> {
+  __extension__ typedef __int128 big_int_type;
+  typedef detail::fpt64 efpt_type;
+  typedef detail::type_converter_fpt to_efpt_converter_type;
+
+  static const detail::int32 MAX_COORDINATE = (1 << 19) - 1;
+};
+#endif
+}  // polygon
+}  // boost
+
+#endif  // BOOST_POLYGON_VORONOI_FAST_CTYPES
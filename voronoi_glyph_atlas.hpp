@@ -0,0 +1,205 @@
+// Boost.Polygon library voronoi_glyph_atlas.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_GLYPH_ATLAS
+#define BOOST_POLYGON_VORONOI_GLYPH_ATLAS
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Squared Euclidean distance transform of a sampled function in one
+// dimension (Felzenszwalb and Huttenlocher): d[q] = min over p of
+// (q - p)^2 + f[p]. v and z are scratch space of n and n + 1 elements.
+inline void voronoi_distance_transform(const float* f, int n, float* d,
+                                       int* v, float* z) {
+  const float inf = std::numeric_limits<float>::infinity();
+  int k = 0;
+  v[0] = 0;
+  z[0] = -inf;
+  z[1] = inf;
+  for (int q = 1; q < n; ++q) {
+    if (f[q] == inf) {
+      continue;
+    }
+    for (;;) {
+      if (f[v[k]] == inf) {
+        // Only infinite parabolas so far, replace them.
+        v[k] = q;
+        break;
+      }
+      float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) /
+                (2.0f * (q - v[k]));
+      if (s <= z[k]) {
+        --k;
+        if (k < 0) {
+          k = 0;
+          v[0] = q;
+          break;
+        }
+        continue;
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = inf;
+      break;
+    }
+  }
+  k = 0;
+  for (int q = 0; q < n; ++q) {
+    while (z[k + 1] < q) {
+      ++k;
+    }
+    d[q] = f[v[k]] == inf ?
+        inf : (q - v[k]) * static_cast<float>(q - v[k]) + f[v[k]];
+  }
+}
+
+// Squared distance from every pixel of a width x height image to the
+// closest pixel for which feature is true, infinite if there is none.
+template <typename Feature>
+void voronoi_distance_transform(int width, int height, Feature feature,
+                                std::vector<float>* distances) {
+  const float inf = std::numeric_limits<float>::infinity();
+  int n = (std::max)(width, height);
+  std::vector<float> f(n), d(n), z(n + 1);
+  std::vector<int> v(n);
+  distances->resize(static_cast<std::size_t>(width) * height);
+  for (int i = 0; i < width; ++i) {
+    for (int j = 0; j < height; ++j) {
+      f[j] = feature(i, j) ? 0.0f : inf;
+    }
+    voronoi_distance_transform(f.data(), height, d.data(), v.data(),
+                               z.data());
+    for (int j = 0; j < height; ++j) {
+      (*distances)[static_cast<std::size_t>(j) * width + i] = d[j];
+    }
+  }
+  for (int j = 0; j < height; ++j) {
+    float* row = distances->data() + static_cast<std::size_t>(j) * width;
+    std::copy(row, row + width, f.begin());
+    voronoi_distance_transform(f.data(), width, row, v.data(), z.data());
+  }
+}
+
+// Signed distance field glyph atlas of the printable ASCII characters.
+// Every glyph takes a cell of cell_width x cell_height texels; a texel
+// holds 128 + 127 * distance / spread, clamped, with the distance to the
+// glyph outline in texels, positive inside. Drawn with a threshold at
+// half of the range, the glyphs stay sharp at any scale and an outline
+// is a second threshold.
+//
+// The glyphs are rasterized by the caller, e.g. with the fonts of a GUI
+// toolkit, at a multiple of the cell size for accurate distances.
+class voronoi_glyph_atlas {
+ public:
+  static const int FIRST_CHAR = 32;
+  static const int NUM_GLYPHS = 95;
+
+  voronoi_glyph_atlas(int cell_width, int cell_height, int columns,
+                      float spread) :
+      cell_width_(cell_width),
+      cell_height_(cell_height),
+      columns_(columns),
+      rows_((NUM_GLYPHS + columns - 1) / columns),
+      spread_(spread),
+      texels_(static_cast<std::size_t>(width()) * height(), 0) {}
+
+  // Index of the glyph of the character, or -1 if there is none.
+  static int glyph(char c) {
+    int index = static_cast<unsigned char>(c) - FIRST_CHAR;
+    return index >= 0 && index < NUM_GLYPHS ? index : -1;
+  }
+
+  // Sets the field of the character from its coverage, a grayscale image
+  // of downscale times the cell size with row 0 at the top. Coverage of
+  // half or more is inside the glyph.
+  void set_glyph(char c, const unsigned char* coverage, int downscale) {
+    int index = glyph(c);
+    if (index < 0) {
+      return;
+    }
+    const int width = cell_width_ * downscale;
+    const int height = cell_height_ * downscale;
+    std::vector<float> to_inside, to_outside;
+    voronoi_distance_transform(width, height, [&](int i, int j) {
+      return coverage[static_cast<std::size_t>(j) * width + i] >= 128;
+    }, &to_inside);
+    voronoi_distance_transform(width, height, [&](int i, int j) {
+      return coverage[static_cast<std::size_t>(j) * width + i] < 128;
+    }, &to_outside);
+    const int x0 = (index % columns_) * cell_width_;
+    const int y0 = (index / columns_) * cell_height_;
+    for (int j = 0; j < cell_height_; ++j) {
+      for (int i = 0; i < cell_width_; ++i) {
+        // The center pixel of the block of the texel.
+        std::size_t p = static_cast<std::size_t>(j * downscale + downscale / 2)
+            * width + i * downscale + downscale / 2;
+        // Distances between the pixel centers, half a pixel from the
+        // outline on both sides of it.
+        float distance = to_outside[p] > 0 ?
+            std::sqrt(to_outside[p]) - 0.5f :
+            0.5f - std::sqrt(to_inside[p]);
+        float value = 128.0f + 127.0f * distance / (downscale * spread_);
+        value = (std::max)(0.0f, (std::min)(255.0f, value));
+        texels_[static_cast<std::size_t>(y0 + j) * this->width() + x0 + i] =
+            static_cast<unsigned char>(value + 0.5f);
+      }
+    }
+  }
+
+  int cell_width() const {
+    return cell_width_;
+  }
+
+  int cell_height() const {
+    return cell_height_;
+  }
+
+  int columns() const {
+    return columns_;
+  }
+
+  int rows() const {
+    return rows_;
+  }
+
+  float spread() const {
+    return spread_;
+  }
+
+  int width() const {
+    return columns_ * cell_width_;
+  }
+
+  int height() const {
+    return rows_ * cell_height_;
+  }
+
+  // width() x height() texels, row 0 at the top.
+  const std::vector<unsigned char>& texels() const {
+    return texels_;
+  }
+
+ private:
+  int cell_width_;
+  int cell_height_;
+  int columns_;
+  int rows_;
+  float spread_;
+  std::vector<unsigned char> texels_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_GLYPH_ATLAS
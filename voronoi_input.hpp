@@ -0,0 +1,63 @@
+// Boost.Polygon library voronoi_input.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_INPUT
+#define BOOST_POLYGON_VORONOI_INPUT
+
+#include <cstddef>
+#include <istream>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Reads the input data in the format used by the files from input_data:
+//   number of points N
+//   N lines "x y"
+//   number of segments M
+//   M lines "x1 y1 x2 y2"
+//
+// Returns false if the stream ended prematurely; the containers then hold
+// the geometries read so far.
+//
+// Template arguments:
+//   Point: point type, should be constructible from two coordinates.
+//   Segment: segment type, should be constructible from two points.
+template <typename Point, typename Segment>
+bool read_voronoi_input(std::istream& in,
+                        std::vector<Point>* points,
+                        std::vector<Segment>* segments) {
+  std::size_t num_points = 0, num_segments = 0;
+  int x1, y1, x2, y2;
+  if (!(in >> num_points)) {
+    return false;
+  }
+  points->reserve(points->size() + num_points);
+  for (std::size_t i = 0; i < num_points; ++i) {
+    if (!(in >> x1 >> y1)) {
+      return false;
+    }
+    points->push_back(Point(x1, y1));
+  }
+  if (!(in >> num_segments)) {
+    // Files with points only may omit the segment count.
+    return in.eof();
+  }
+  segments->reserve(segments->size() + num_segments);
+  for (std::size_t i = 0; i < num_segments; ++i) {
+    if (!(in >> x1 >> y1 >> x2 >> y2)) {
+      return false;
+    }
+    segments->push_back(Segment(Point(x1, y1), Point(x2, y2)));
+  }
+  return true;
+}
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_INPUT
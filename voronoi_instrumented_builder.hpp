@@ -0,0 +1,763 @@
+// Boost.Polygon library voronoi_instrumented_builder.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_INSTRUMENTED_BUILDER
+#define BOOST_POLYGON_VORONOI_INSTRUMENTED_BUILDER
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <boost/polygon/detail/voronoi_ctypes.hpp>
+#include <boost/polygon/detail/voronoi_predicates.hpp>
+#include <boost/polygon/detail/voronoi_structures.hpp>
+#include <boost/polygon/voronoi_geometry_type.hpp>
+
+namespace boost {
+namespace polygon {
+// Counters of the predicate evaluations. Circle events are counted per
+// configuration of their sites: (point, point, point), (point, point,
+// segment), (point, segment, segment) and (segment, segment, segment).
+struct voronoi_predicate_counters {
+  enum circle_kind {
+    PPP = 0,
+    PPS = 1,
+    PSS = 2,
+    SSS = 3
+  };
+
+  // Beach line node comparisons, one per tree level visited.
+  std::size_t node_comparisons;
+  // Circles computed by the lazy (floating point) functor.
+  std::size_t lazy_circles[4];
+  // Circles that had to be recomputed with the exact arithmetic.
+  std::size_t exact_circles[4];
+  // Conversions of multiprecision values, a measure of the exact work.
+  std::size_t exact_evaluations;
+};
+
+// Statistics of a single construct call.
+struct voronoi_builder_telemetry {
+  std::size_t site_events;
+  // Circle events pushed into the queue and those that reached the top
+  // of it while still active.
+  std::size_t circle_events;
+  std::size_t processed_circle_events;
+  // Circle events deactivated because their arc was split or removed.
+  std::size_t invalidated_circle_events;
+  // Largest number of nodes of the beach line tree.
+  std::size_t max_beach_line_size;
+  voronoi_predicate_counters predicates;
+};
+
+// Predicate counters of the build running on the calling thread. The
+// predicates are created by the builder and the standard containers, so
+// they find their counters here instead of holding a pointer.
+inline voronoi_predicate_counters& voronoi_thread_predicate_counters() {
+  static thread_local voronoi_predicate_counters counters;
+  return counters;
+}
+
+// Conversion from the multiprecision types that counts its calls. The
+// lazy predicates only use it on their exact fallback path.
+template <typename Converter>
+struct voronoi_counting_converter {
+  template <typename T>
+  auto operator()(const T& that) const -> decltype(Converter()(that)) {
+    ++voronoi_thread_predicate_counters().exact_evaluations;
+    return converter_(that);
+  }
+
+  Converter converter_;
+};
+
+// Conversion to fpt that counts the conversions of the big integers only.
+// The exact circle computation of three points converts its results with
+// it and never goes through the extended exponent type.
+template <typename Converter, typename BigInt>
+struct voronoi_counting_fpt_converter {
+  template <typename T>
+  auto operator()(const T& that) const -> decltype(Converter()(that)) {
+    return converter_(that);
+  }
+
+  auto operator()(const BigInt& that) const -> decltype(Converter()(that)) {
+    ++voronoi_thread_predicate_counters().exact_evaluations;
+    return converter_(that);
+  }
+
+  Converter converter_;
+};
+
+// Coordinate traits of CTT with the counting exact conversions.
+template <typename CTT>
+struct voronoi_telemetry_ctype_traits : public CTT {
+  typedef voronoi_counting_fpt_converter<typename CTT::to_fpt_converter_type,
+                                         typename CTT::big_int_type>
+      to_fpt_converter_type;
+  typedef voronoi_counting_converter<typename CTT::to_efpt_converter_type>
+      to_efpt_converter_type;
+};
+
+// Default predicates with counters on the node comparison and the circle
+// formation.
+template <typename CTT>
+class voronoi_telemetry_predicates : public detail::voronoi_predicates<CTT> {
+  typedef detail::voronoi_predicates<CTT> base_type;
+
+ public:
+  template <typename Node>
+  class node_comparison_predicate :
+      public base_type::template node_comparison_predicate<Node> {
+   public:
+    bool operator()(const Node& node1, const Node& node2) const {
+      ++voronoi_thread_predicate_counters().node_comparisons;
+      return base_type::template node_comparison_predicate<Node>::
+          operator()(node1, node2);
+    }
+  };
+
+  // Lazy circle formation that records which computations fell back to
+  // the exact arithmetic.
+  template <typename Site, typename Circle>
+  class circle_formation_functor {
+   public:
+    void ppp(const Site& site1, const Site& site2, const Site& site3,
+             Circle& c_event) {
+      std::size_t before = begin(voronoi_predicate_counters::PPP);
+      lazy_.ppp(site1, site2, site3, c_event);
+      end(voronoi_predicate_counters::PPP, before);
+    }
+
+    void pps(const Site& site1, const Site& site2, const Site& site3,
+             int segment_index, Circle& c_event) {
+      std::size_t before = begin(voronoi_predicate_counters::PPS);
+      lazy_.pps(site1, site2, site3, segment_index, c_event);
+      end(voronoi_predicate_counters::PPS, before);
+    }
+
+    void pss(const Site& site1, const Site& site2, const Site& site3,
+             int point_index, Circle& c_event) {
+      std::size_t before = begin(voronoi_predicate_counters::PSS);
+      lazy_.pss(site1, site2, site3, point_index, c_event);
+      end(voronoi_predicate_counters::PSS, before);
+    }
+
+    void sss(const Site& site1, const Site& site2, const Site& site3,
+             Circle& c_event) {
+      std::size_t before = begin(voronoi_predicate_counters::SSS);
+      lazy_.sss(site1, site2, site3, c_event);
+      end(voronoi_predicate_counters::SSS, before);
+    }
+
+   private:
+    static std::size_t begin(int kind) {
+      voronoi_predicate_counters& counters =
+          voronoi_thread_predicate_counters();
+      ++counters.lazy_circles[kind];
+      return counters.exact_evaluations;
+    }
+
+    static void end(int kind, std::size_t before) {
+      voronoi_predicate_counters& counters =
+          voronoi_thread_predicate_counters();
+      if (counters.exact_evaluations != before) {
+        ++counters.exact_circles[kind];
+      }
+    }
+
+    typename base_type::template lazy_circle_formation_functor<Site, Circle>
+        lazy_;
+  };
+
+  template <typename Site, typename Circle>
+  class circle_formation_predicate :
+      public base_type::template circle_formation_predicate<
+          Site, Circle,
+          typename base_type::template circle_existence_predicate<Site>,
+          circle_formation_functor<Site, Circle> > {
+  };
+};
+
+// Copy of detail::ordered_queue whose list nodes come from Allocator.
+template <typename T, typename Predicate, typename Allocator>
+class voronoi_ordered_queue {
+ public:
+  explicit voronoi_ordered_queue(const Allocator& allocator) :
+      c_list_(list_allocator_type(allocator)) {}
+
+  bool empty() const {
+    return c_.empty();
+  }
+
+  const T &top() const {
+    return *c_.top();
+  }
+
+  void pop() {
+    list_iterator_type it = c_.top();
+    c_.pop();
+    c_list_.erase(it);
+  }
+
+  T &push(const T &e) {
+    c_list_.push_front(e);
+    c_.push(c_list_.begin());
+    return c_list_.front();
+  }
+
+  void clear() {
+    while (!c_.empty())
+        c_.pop();
+    c_list_.clear();
+  }
+
+ private:
+  typedef typename std::allocator_traits<Allocator>::
+    template rebind_alloc<T> list_allocator_type;
+  typedef std::list<T, list_allocator_type> list_type;
+  typedef typename list_type::iterator list_iterator_type;
+
+  struct comparison {
+    bool operator() (const list_iterator_type &it1,
+                     const list_iterator_type &it2) const {
+      return cmp_(*it1, *it2);
+    }
+    Predicate cmp_;
+  };
+
+  std::priority_queue< list_iterator_type,
+                       std::vector<list_iterator_type>,
+                       comparison > c_;
+  list_type c_list_;
+
+  // Disallow copy constructor and operator=
+  voronoi_ordered_queue(const voronoi_ordered_queue&);
+  void operator=(const voronoi_ordered_queue&);
+};
+
+// Copy of voronoi_builder that records the statistics of every construct
+// call, see telemetry(). The sweepline algorithm is unchanged; with the
+// default predicates the calls of the lazy and the exact arithmetic are
+// counted too.
+//
+// The nodes of the beach line tree and of the circle event list are
+// allocated with Allocator (rebound to the node types), for example a
+// voronoi_pool_allocator.
+template <typename T,
+          typename CTT =
+              voronoi_telemetry_ctype_traits<detail::voronoi_ctype_traits<T> >,
+          typename VP = voronoi_telemetry_predicates<CTT>,
+          typename Allocator = std::allocator<char> >
+class voronoi_instrumented_builder {
+ public:
+  typedef typename CTT::int_type int_type;
+  typedef typename CTT::fpt_type fpt_type;
+  typedef Allocator allocator_type;
+
+  explicit voronoi_instrumented_builder(
+      const allocator_type& allocator = allocator_type()) :
+      circle_events_(allocator),
+      beach_line_(node_comparer_type(), beach_line_allocator_type(allocator)),
+      index_(0),
+      telemetry_() {}
+
+  // Each point creates a single site event.
+  std::size_t insert_point(const int_type& x, const int_type& y) {
+    site_events_.push_back(site_event_type(x, y));
+    site_events_.back().initial_index(index_);
+    site_events_.back().source_category(SOURCE_CATEGORY_SINGLE_POINT);
+    return index_++;
+  }
+
+  // Each segment creates three site events that correspond to:
+  //   1) the start point of the segment;
+  //   2) the end point of the segment;
+  //   3) the segment itself defined by its start point.
+  std::size_t insert_segment(
+      const int_type& x1, const int_type& y1,
+      const int_type& x2, const int_type& y2) {
+    // Set up start point site.
+    point_type p1(x1, y1);
+    site_events_.push_back(site_event_type(p1));
+    site_events_.back().initial_index(index_);
+    site_events_.back().source_category(SOURCE_CATEGORY_SEGMENT_START_POINT);
+
+    // Set up end point site.
+    point_type p2(x2, y2);
+    site_events_.push_back(site_event_type(p2));
+    site_events_.back().initial_index(index_);
+    site_events_.back().source_category(SOURCE_CATEGORY_SEGMENT_END_POINT);
+
+    // Set up segment site.
+    if (point_comparison_(p1, p2)) {
+      site_events_.push_back(site_event_type(p1, p2));
+      site_events_.back().source_category(SOURCE_CATEGORY_INITIAL_SEGMENT);
+    } else {
+      site_events_.push_back(site_event_type(p2, p1));
+      site_events_.back().source_category(SOURCE_CATEGORY_REVERSE_SEGMENT);
+    }
+    site_events_.back().initial_index(index_);
+    return index_++;
+  }
+
+  // Run sweepline algorithm and fill output data structure.
+  template <typename OUTPUT>
+  void construct(OUTPUT* output) {
+    telemetry_ = voronoi_builder_telemetry();
+    voronoi_thread_predicate_counters() = voronoi_predicate_counters();
+
+    // Init structures.
+    output->_reserve(site_events_.size());
+    init_sites_queue();
+    init_beach_line(output);
+
+    // The algorithm stops when there are no events to process.
+    event_comparison_predicate event_comparison;
+    while (!circle_events_.empty() ||
+           !(site_event_iterator_ == site_events_.end())) {
+      if (circle_events_.empty()) {
+        process_site_event(output);
+      } else if (site_event_iterator_ == site_events_.end()) {
+        process_circle_event(output);
+      } else {
+        if (event_comparison(*site_event_iterator_,
+                             circle_events_.top().first)) {
+          process_site_event(output);
+        } else {
+          process_circle_event(output);
+        }
+      }
+      while (!circle_events_.empty() &&
+             !circle_events_.top().first.is_active()) {
+        circle_events_.pop();
+      }
+    }
+    beach_line_.clear();
+
+    // Finish construction.
+    output->_build();
+
+    telemetry_.site_events = site_events_.size();
+    telemetry_.predicates = voronoi_thread_predicate_counters();
+  }
+
+  void clear() {
+    index_ = 0;
+    site_events_.clear();
+  }
+
+  // Statistics of the last construct call.
+  const voronoi_builder_telemetry& telemetry() const {
+    return telemetry_;
+  }
+
+ private:
+  typedef detail::point_2d<int_type> point_type;
+  typedef detail::site_event<int_type> site_event_type;
+  typedef typename std::vector<site_event_type>::const_iterator
+    site_event_iterator_type;
+  typedef detail::circle_event<fpt_type> circle_event_type;
+  typedef typename VP::template point_comparison_predicate<point_type>
+    point_comparison_predicate;
+  typedef typename VP::
+    template event_comparison_predicate<site_event_type, circle_event_type>
+    event_comparison_predicate;
+  typedef typename VP::
+    template circle_formation_predicate<site_event_type, circle_event_type>
+    circle_formation_predicate_type;
+  typedef void edge_type;
+  typedef detail::beach_line_node_key<site_event_type> key_type;
+  typedef detail::beach_line_node_data<edge_type, circle_event_type>
+    value_type;
+  typedef typename VP::template node_comparison_predicate<key_type>
+    node_comparer_type;
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+    std::pair<const key_type, value_type> > beach_line_allocator_type;
+  typedef std::map< key_type, value_type, node_comparer_type,
+                    beach_line_allocator_type > beach_line_type;
+  typedef typename beach_line_type::iterator beach_line_iterator;
+  typedef std::pair<circle_event_type, beach_line_iterator> event_type;
+  typedef struct {
+    bool operator()(const event_type& lhs, const event_type& rhs) const {
+      return predicate(rhs.first, lhs.first);
+    }
+    event_comparison_predicate predicate;
+  } event_comparison_type;
+  typedef voronoi_ordered_queue<event_type, event_comparison_type, Allocator>
+    circle_event_queue_type;
+  typedef std::pair<point_type, beach_line_iterator> end_point_type;
+
+  void init_sites_queue() {
+    // Sort site events.
+    std::sort(site_events_.begin(), site_events_.end(),
+        event_comparison_predicate());
+
+    // Remove duplicates.
+    site_events_.erase(std::unique(
+        site_events_.begin(), site_events_.end()), site_events_.end());
+
+    // Index sites.
+    for (std::size_t cur = 0; cur < site_events_.size(); ++cur) {
+      site_events_[cur].sorted_index(cur);
+    }
+
+    // Init site iterator.
+    site_event_iterator_ = site_events_.begin();
+  }
+
+  template <typename OUTPUT>
+  void init_beach_line(OUTPUT* output) {
+    if (site_events_.empty())
+      return;
+    if (site_events_.size() == 1) {
+      // Handle single site event case.
+      output->_process_single_site(site_events_[0]);
+      ++site_event_iterator_;
+    } else {
+      int skip = 0;
+
+      while (site_event_iterator_ != site_events_.end() &&
+             VP::is_vertical(site_event_iterator_->point0(),
+                             site_events_.begin()->point0()) &&
+             VP::is_vertical(*site_event_iterator_)) {
+        ++site_event_iterator_;
+        ++skip;
+      }
+
+      if (skip == 1) {
+        // Init beach line with the first two sites.
+        init_beach_line_default(output);
+      } else {
+        // Init beach line with collinear vertical sites.
+        init_beach_line_collinear_sites(output);
+      }
+    }
+  }
+
+  // Init beach line with the two first sites.
+  // The first site is always a point.
+  template <typename OUTPUT>
+  void init_beach_line_default(OUTPUT* output) {
+    // Get the first and the second site event.
+    site_event_iterator_type it_first = site_events_.begin();
+    site_event_iterator_type it_second = site_events_.begin();
+    ++it_second;
+    insert_new_arc(
+        *it_first, *it_first, *it_second, beach_line_.end(), output);
+    // The second site was already processed. Move the iterator.
+    ++site_event_iterator_;
+  }
+
+  // Init beach line with collinear sites.
+  template <typename OUTPUT>
+  void init_beach_line_collinear_sites(OUTPUT* output) {
+    site_event_iterator_type it_first = site_events_.begin();
+    site_event_iterator_type it_second = site_events_.begin();
+    ++it_second;
+    while (it_second != site_event_iterator_) {
+      // Create a new beach line node.
+      key_type new_node(*it_first, *it_second);
+
+      // Update the output.
+      edge_type* edge = output->_insert_new_edge(*it_first, *it_second).first;
+
+      // Insert a new bisector into the beach line.
+      beach_line_.insert(beach_line_.end(),
+          std::pair<key_type, value_type>(new_node, value_type(edge)));
+
+      // Update iterators.
+      ++it_first;
+      ++it_second;
+    }
+    update_max_beach_line_size();
+  }
+
+  void deactivate_circle_event(value_type* value) {
+    if (value->circle_event()) {
+      value->circle_event()->deactivate();
+      value->circle_event(NULL);
+      ++telemetry_.invalidated_circle_events;
+    }
+  }
+
+  template <typename OUTPUT>
+  void process_site_event(OUTPUT* output) {
+    // Get next site event to process.
+    site_event_type site_event = *site_event_iterator_;
+
+    // Move site iterator.
+    site_event_iterator_type last = site_event_iterator_ + 1;
+
+    // If a new site is an end point of some segment,
+    // remove temporary nodes from the beach line data structure.
+    if (!site_event.is_segment()) {
+      while (!end_points_.empty() &&
+             end_points_.top().first == site_event.point0()) {
+        beach_line_iterator b_it = end_points_.top().second;
+        end_points_.pop();
+        beach_line_.erase(b_it);
+      }
+    } else {
+      while (last != site_events_.end() &&
+             last->is_segment() && last->point0() == site_event.point0())
+        ++last;
+    }
+
+    // Find the node in the binary search tree with left arc
+    // lying above the new site point.
+    key_type new_key(*site_event_iterator_);
+    beach_line_iterator right_it = beach_line_.lower_bound(new_key);
+
+    for (; site_event_iterator_ != last; ++site_event_iterator_) {
+      site_event = *site_event_iterator_;
+      beach_line_iterator left_it = right_it;
+
+      // Do further processing depending on the above node position.
+      // For any two neighboring nodes the second site of the first node
+      // is the same as the first site of the second node.
+      if (right_it == beach_line_.end()) {
+        // The above arc corresponds to the second arc of the last node.
+        // Move the iterator to the last node.
+        --left_it;
+
+        // Get the second site of the last node
+        const site_event_type& site_arc = left_it->first.right_site();
+
+        // Insert new nodes into the beach line. Update the output.
+        right_it = insert_new_arc(
+            site_arc, site_arc, site_event, right_it, output);
+
+        // Add a candidate circle to the circle event queue.
+        // There could be only one new circle event formed by
+        // a new bisector and the one on the left.
+        activate_circle_event(left_it->first.left_site(),
+                              left_it->first.right_site(),
+                              site_event, right_it);
+      } else if (right_it == beach_line_.begin()) {
+        // The above arc corresponds to the first site of the first node.
+        const site_event_type& site_arc = right_it->first.left_site();
+
+        // Insert new nodes into the beach line. Update the output.
+        left_it = insert_new_arc(
+            site_arc, site_arc, site_event, right_it, output);
+
+        // If the site event is a segment, update its direction.
+        if (site_event.is_segment()) {
+          site_event.inverse();
+        }
+
+        // Add a candidate circle to the circle event queue.
+        // There could be only one new circle event formed by
+        // a new bisector and the one on the right.
+        activate_circle_event(site_event, right_it->first.left_site(),
+            right_it->first.right_site(), right_it);
+        right_it = left_it;
+      } else {
+        // The above arc corresponds neither to the first,
+        // nor to the last site in the beach line.
+        const site_event_type& site_arc2 = right_it->first.left_site();
+        const site_event_type& site3 = right_it->first.right_site();
+
+        // Remove the candidate circle from the event queue.
+        deactivate_circle_event(&right_it->second);
+        --left_it;
+        const site_event_type& site_arc1 = left_it->first.right_site();
+        const site_event_type& site1 = left_it->first.left_site();
+
+        // Insert new nodes into the beach line. Update the output.
+        beach_line_iterator new_node_it =
+            insert_new_arc(site_arc1, site_arc2, site_event, right_it, output);
+
+        // Add candidate circles to the circle event queue.
+        // There could be up to two circle events formed by
+        // a new bisector and the one on the left or right.
+        activate_circle_event(site1, site_arc1, site_event, new_node_it);
+
+        // If the site event is a segment, update its direction.
+        if (site_event.is_segment()) {
+          site_event.inverse();
+        }
+        activate_circle_event(site_event, site_arc2, site3, right_it);
+        right_it = new_node_it;
+      }
+    }
+  }
+
+  // In general case circle event is made of the three consecutive sites
+  // that form two bisectors in the beach line data structure.
+  // Let circle event sites be A, B, C, two bisectors that define
+  // circle event are (A, B), (B, C). During circle event processing
+  // we remove (A, B), (B, C) and insert (A, C). As beach line comparison
+  // works correctly only if one of the nodes is a new one we remove
+  // (B, C) bisector and change (A, B) bisector to the (A, C). That's
+  // why we use const_cast there and take all the responsibility that
+  // map data structure keeps correct ordering.
+  template <typename OUTPUT>
+  void process_circle_event(OUTPUT* output) {
+    ++telemetry_.processed_circle_events;
+
+    // Get the topmost circle event.
+    const event_type& e = circle_events_.top();
+    const circle_event_type& circle_event = e.first;
+    beach_line_iterator it_first = e.second;
+    beach_line_iterator it_last = it_first;
+
+    // Get the C site.
+    site_event_type site3 = it_first->first.right_site();
+
+    // Get the half-edge corresponding to the second bisector - (B, C).
+    edge_type* bisector2 = it_first->second.edge();
+
+    // Get the half-edge corresponding to the first bisector - (A, B).
+    --it_first;
+    edge_type* bisector1 = it_first->second.edge();
+
+    // Get the A site.
+    site_event_type site1 = it_first->first.left_site();
+
+    if (!site1.is_segment() && site3.is_segment() &&
+        site3.point1() == site1.point0()) {
+      site3.inverse();
+    }
+
+    // Change the (A, B) bisector node to the (A, C) bisector node.
+    const_cast<key_type&>(it_first->first).right_site(site3);
+
+    // Insert the new bisector into the beach line.
+    it_first->second.edge(output->_insert_new_edge(
+        site1, site3, circle_event, bisector1, bisector2).first);
+
+    // Remove the (B, C) bisector node from the beach line.
+    beach_line_.erase(it_last);
+    it_last = it_first;
+
+    // Pop the topmost circle event from the event queue.
+    circle_events_.pop();
+
+    // Check new triplets formed by the neighboring arcs
+    // to the left for potential circle events.
+    if (it_first != beach_line_.begin()) {
+      deactivate_circle_event(&it_first->second);
+      --it_first;
+      const site_event_type& site_l1 = it_first->first.left_site();
+      activate_circle_event(site_l1, site1, site3, it_last);
+    }
+
+    // Check the new triplet formed by the neighboring arcs
+    // to the right for potential circle events.
+    ++it_last;
+    if (it_last != beach_line_.end()) {
+      deactivate_circle_event(&it_last->second);
+      const site_event_type& site_r1 = it_last->first.right_site();
+      activate_circle_event(site1, site3, site_r1, it_last);
+    }
+  }
+
+  // Insert new nodes into the beach line. Update the output.
+  template <typename OUTPUT>
+  beach_line_iterator insert_new_arc(
+      const site_event_type& site_arc1, const site_event_type &site_arc2,
+      const site_event_type& site_event, beach_line_iterator position,
+      OUTPUT* output) {
+    // Create two new bisectors with opposite directions.
+    key_type new_left_node(site_arc1, site_event);
+    key_type new_right_node(site_event, site_arc2);
+
+    // Set correct orientation for the first site of the second node.
+    if (site_event.is_segment()) {
+      new_right_node.left_site().inverse();
+    }
+
+    // Update the output.
+    std::pair<edge_type*, edge_type*> edges =
+        output->_insert_new_edge(site_arc2, site_event);
+    position = beach_line_.insert(position,
+        typename beach_line_type::value_type(
+            new_right_node, value_type(edges.second)));
+
+    if (site_event.is_segment()) {
+      // Update the beach line with temporary bisector, that will
+      // disappear after processing site event corresponding to the
+      // second endpoint of the segment site.
+      key_type new_node(site_event, site_event);
+      new_node.right_site().inverse();
+      position = beach_line_.insert(position,
+          typename beach_line_type::value_type(new_node, value_type(NULL)));
+
+      // Update the data structure that holds temporary bisectors.
+      end_points_.push(std::make_pair(site_event.point1(), position));
+    }
+
+    position = beach_line_.insert(position,
+        typename beach_line_type::value_type(
+            new_left_node, value_type(edges.first)));
+
+    update_max_beach_line_size();
+    return position;
+  }
+
+  // Add a new circle event to the event queue.
+  // bisector_node corresponds to the (site2, site3) bisector.
+  void activate_circle_event(const site_event_type& site1,
+                             const site_event_type& site2,
+                             const site_event_type& site3,
+                             beach_line_iterator bisector_node) {
+    circle_event_type c_event;
+    // Check if the three input sites create a circle event.
+    if (circle_formation_predicate_(site1, site2, site3, c_event)) {
+      // Add the new circle event to the circle events queue.
+      // Update bisector's circle event iterator to point to the
+      // new circle event in the circle event queue.
+      event_type& e = circle_events_.push(
+          std::pair<circle_event_type, beach_line_iterator>(
+              c_event, bisector_node));
+      bisector_node->second.circle_event(&e.first);
+      ++telemetry_.circle_events;
+    }
+  }
+
+  void update_max_beach_line_size() {
+    telemetry_.max_beach_line_size =
+        (std::max)(telemetry_.max_beach_line_size, beach_line_.size());
+  }
+
+ private:
+  point_comparison_predicate point_comparison_;
+  struct end_point_comparison {
+    bool operator() (const end_point_type& end1,
+                     const end_point_type& end2) const {
+      return point_comparison(end2.first, end1.first);
+    }
+    point_comparison_predicate point_comparison;
+  };
+
+  std::vector<site_event_type> site_events_;
+  site_event_iterator_type site_event_iterator_;
+  std::priority_queue< end_point_type, std::vector<end_point_type>,
+                       end_point_comparison > end_points_;
+  circle_event_queue_type circle_events_;
+  beach_line_type beach_line_;
+  circle_formation_predicate_type circle_formation_predicate_;
+  std::size_t index_;
+  voronoi_builder_telemetry telemetry_;
+
+  // Disallow copy constructor and operator=
+  voronoi_instrumented_builder(const voronoi_instrumented_builder&);
+  void operator=(const voronoi_instrumented_builder&);
+};
+}  // polygon
+}  // boost
+
+#endif  // BOOST_POLYGON_VORONOI_INSTRUMENTED_BUILDER
@@ -0,0 +1,213 @@
+// Boost.Polygon library voronoi_interior_classifier.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_INTERIOR_CLASSIFIER
+#define BOOST_POLYGON_VORONOI_INTERIOR_CLASSIFIER
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <boost/polygon/isotropy.hpp>
+#include <boost/polygon/point_concept.hpp>
+#include <boost/polygon/segment_concept.hpp>
+
+namespace boost {
+namespace polygon {
+// Point in polygon classification against the input segments, which are
+// treated as the edges of a set of closed polygons with any number of
+// nested holes.
+//
+// A point is inside if a ray cast from it in the positive x direction
+// crosses the segments an odd number of times (the winding number modulo
+// two). Unlike the nonzero winding rule this does not depend on the
+// orientation of the rings, which the input files do not guarantee.
+//
+// Segments are bucketed into horizontal bands, so a query only visits the
+// segments whose y range overlaps the band of the query point. The bands
+// form a hierarchy of levels, each level halving the number of bands of
+// the previous one; a segment is stored on the finest level where it
+// overlaps at most two bands. Long segments are thus stored a bounded
+// number of times, and a query visits one band per level. Queries are read
+// only and may run concurrently.
+template <typename CT>
+class voronoi_interior_classifier {
+ public:
+  enum location_type {
+    OUTSIDE = 0,
+    INSIDE = 1,
+    BOUNDARY = 2
+  };
+
+  // Args:
+  //   segments: input segments.
+  //   tolerance: points closer than that to a segment are on the boundary.
+  template <class Segment>
+  voronoi_interior_classifier(const std::vector<Segment>& segments,
+                              CT tolerance) : tolerance_(tolerance) {
+    segments_.reserve(4 * segments.size());
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      segments_.push_back(x(low(segments[i])));
+      segments_.push_back(y(low(segments[i])));
+      segments_.push_back(x(high(segments[i])));
+      segments_.push_back(y(high(segments[i])));
+    }
+    build_bands();
+  }
+
+  location_type locate(CT px, CT py) const {
+    if (level_start_.empty()) {
+      return OUTSIDE;
+    }
+    std::size_t band = band_index(py);
+    bool inside = false;
+    for (std::size_t level = 0; level + 1 < level_start_.size(); ++level) {
+      std::size_t b = level_start_[level] + (band >> level);
+      for (std::size_t i = band_start_[b]; i < band_start_[b + 1]; ++i) {
+        const CT* s = &segments_[4 * band_segments_[i]];
+        if (distance_below_tolerance(s, px, py)) {
+          return BOUNDARY;
+        }
+        // Half open rule, so that a ray through a shared endpoint counts
+        // exactly one of the two segments.
+        if ((s[1] > py) != (s[3] > py)) {
+          CT cross_x = s[0] + (py - s[1]) * (s[2] - s[0]) / (s[3] - s[1]);
+          if (cross_x > px) {
+            inside = !inside;
+          }
+        }
+      }
+    }
+    return inside ? INSIDE : OUTSIDE;
+  }
+
+ private:
+  std::size_t band_index(CT py) const {
+    CT band = std::floor((py - yl_) / band_height_);
+    if (band < 0) {
+      return 0;
+    }
+    return (std::min)(static_cast<std::size_t>(band), num_bands_ - 1);
+  }
+
+  void build_bands() {
+    std::size_t num = segments_.size() / 4;
+    if (num == 0) {
+      return;
+    }
+    yl_ = segments_[1];
+    CT yh = segments_[1];
+    for (std::size_t i = 0; i < num; ++i) {
+      const CT* s = &segments_[4 * i];
+      yl_ = (std::min)(yl_, (std::min)(s[1], s[3]));
+      yh = (std::max)(yh, (std::max)(s[1], s[3]));
+    }
+    // Aim at a handful of segments per band.
+    num_bands_ = (std::min)(num / 4, std::size_t(1) << 16);
+    num_bands_ = (std::max)(num_bands_, std::size_t(1));
+    band_height_ = (std::max)(yh - yl_, CT(1)) / num_bands_;
+
+    // Levels up to the one that has a single band, band b of level l
+    // covers the bands [b << l, (b + 1) << l) of level zero.
+    std::vector<std::size_t> level(num);
+    std::size_t num_levels = 1;
+    for (std::size_t i = 0; i < num; ++i) {
+      std::size_t first, last;
+      band_range(i, &first, &last);
+      std::size_t l = 0;
+      while ((last >> l) - (first >> l) > 1) {
+        ++l;
+      }
+      level[i] = l;
+      num_levels = (std::max)(num_levels, l + 1);
+    }
+    level_start_.assign(1, 0);
+    for (std::size_t l = 0; l < num_levels; ++l) {
+      std::size_t bands = ((num_bands_ - 1) >> l) + 1;
+      level_start_.push_back(level_start_.back() + bands);
+    }
+
+    // Counting sort of the segments into the bands of their level their
+    // y range (widened by the tolerance) overlaps.
+    band_start_.assign(level_start_.back() + 1, 0);
+    for (std::size_t i = 0; i < num; ++i) {
+      std::size_t first, last;
+      level_band_range(i, level[i], &first, &last);
+      for (std::size_t band = first; band <= last; ++band) {
+        ++band_start_[band + 1];
+      }
+    }
+    for (std::size_t i = 1; i < band_start_.size(); ++i) {
+      band_start_[i] += band_start_[i - 1];
+    }
+    band_segments_.resize(band_start_.back());
+    std::vector<std::size_t> fill(band_start_.begin(), band_start_.end() - 1);
+    for (std::size_t i = 0; i < num; ++i) {
+      std::size_t first, last;
+      level_band_range(i, level[i], &first, &last);
+      for (std::size_t band = first; band <= last; ++band) {
+        band_segments_[fill[band]++] = i;
+      }
+    }
+  }
+
+  // Bands of the given level the segment is stored in, as indices into
+  // band_start_.
+  void level_band_range(std::size_t segment, std::size_t level,
+                        std::size_t* first, std::size_t* last) const {
+    band_range(segment, first, last);
+    *first = level_start_[level] + (*first >> level);
+    *last = level_start_[level] + (*last >> level);
+  }
+
+  void band_range(std::size_t segment, std::size_t* first,
+                  std::size_t* last) const {
+    const CT* s = &segments_[4 * segment];
+    *first = band_index((std::min)(s[1], s[3]) - tolerance_);
+    *last = band_index((std::max)(s[1], s[3]) + tolerance_);
+  }
+
+  bool distance_below_tolerance(const CT* s, CT px, CT py) const {
+    if (px < (std::min)(s[0], s[2]) - tolerance_ ||
+        px > (std::max)(s[0], s[2]) + tolerance_ ||
+        py < (std::min)(s[1], s[3]) - tolerance_ ||
+        py > (std::max)(s[1], s[3]) + tolerance_) {
+      return false;
+    }
+    CT dx = s[2] - s[0];
+    CT dy = s[3] - s[1];
+    CT vx = px - s[0];
+    CT vy = py - s[1];
+    CT sqr_length = dx * dx + dy * dy;
+    if (sqr_length > 0) {
+      CT t = (vx * dx + vy * dy) / sqr_length;
+      t = (std::max)(CT(0), (std::min)(CT(1), t));
+      vx -= t * dx;
+      vy -= t * dy;
+    }
+    return vx * vx + vy * vy <= tolerance_ * tolerance_;
+  }
+
+  CT tolerance_;
+  // Segment geometry as (x0, y0, x1, y1) quadruples.
+  std::vector<CT> segments_;
+  CT yl_;
+  CT band_height_;
+  // Number of the bands of level zero.
+  std::size_t num_bands_;
+  // Level l owns the bands [level_start_[l], level_start_[l + 1]).
+  std::vector<std::size_t> level_start_;
+  std::vector<std::size_t> band_start_;
+  std::vector<std::size_t> band_segments_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_INTERIOR_CLASSIFIER
@@ -0,0 +1,111 @@
+// Boost.Polygon library voronoi_lru_cache.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_LRU_CACHE
+#define BOOST_POLYGON_VORONOI_LRU_CACHE
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Least recently used cache with a budget in bytes. The values typically
+// own resources the cache can not release itself, such as GL buffers, so
+// evicted values are handed back to the caller instead of being destroyed.
+//
+// Template arguments:
+//   Key: key type, should be less than comparable.
+//   Value: value type, should be movable.
+template <typename Key, typename Value>
+class voronoi_lru_cache {
+ public:
+  explicit voronoi_lru_cache(std::size_t budget) :
+      budget_(budget), bytes_(0) {}
+
+  // Returns the cached value and marks it as the most recently used one,
+  // or NULL if there is none.
+  Value* find(const Key& key) {
+    typename index_type::iterator it = index_.find(key);
+    if (it == index_.end()) {
+      return NULL;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->value;
+  }
+
+  bool contains(const Key& key) const {
+    return index_.count(key) != 0;
+  }
+
+  // Inserts a value that is not cached yet as the most recently used one.
+  // The least recently used values are moved to evicted until the cache
+  // fits the budget again; the new value itself is kept even if it exceeds
+  // the budget alone.
+  Value* insert(const Key& key, Value value, std::size_t bytes,
+                std::vector<Value>* evicted) {
+    entries_.push_front(entry(key, std::move(value), bytes));
+    index_[key] = entries_.begin();
+    bytes_ += bytes;
+    while (bytes_ > budget_ && entries_.size() > 1) {
+      entry& last = entries_.back();
+      bytes_ -= last.bytes;
+      index_.erase(last.key);
+      evicted->push_back(std::move(last.value));
+      entries_.pop_back();
+    }
+    return &entries_.front().value;
+  }
+
+  // Moves all the values to evicted.
+  void clear(std::vector<Value>* evicted) {
+    for (typename std::list<entry>::iterator it = entries_.begin();
+         it != entries_.end(); ++it) {
+      evicted->push_back(std::move(it->value));
+    }
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t size() const {
+    return entries_.size();
+  }
+
+  std::size_t bytes() const {
+    return bytes_;
+  }
+
+  std::size_t budget() const {
+    return budget_;
+  }
+
+ private:
+  struct entry {
+    entry(const Key& key, Value value, std::size_t bytes) :
+        key(key), value(std::move(value)), bytes(bytes) {}
+
+    Key key;
+    Value value;
+    std::size_t bytes;
+  };
+  typedef std::map<Key, typename std::list<entry>::iterator> index_type;
+
+  std::size_t budget_;
+  std::size_t bytes_;
+  // Most recently used first.
+  std::list<entry> entries_;
+  index_type index_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_LRU_CACHE
@@ -0,0 +1,135 @@
+// Boost.Polygon library voronoi_node_pool.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_NODE_POOL
+#define BOOST_POLYGON_VORONOI_NODE_POOL
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Storage for the nodes of the node based containers of the builder: the
+// beach line tree and the circle event list. Nodes are carved out of large
+// chunks and freed nodes are kept in a free list per size, so inserting
+// and erasing nodes does not go through the global allocator. Chunks are
+// kept until the pool is destroyed and are reused by the next build.
+//
+// The pool is not thread safe, a builder and its pool are used by one
+// thread at a time.
+class voronoi_node_pool {
+ public:
+  // Nodes larger than that go to the global allocator.
+  static const std::size_t MAX_NODE_SIZE = 256;
+
+  voronoi_node_pool() : chunk_used_(CHUNK_SIZE) {
+    std::fill(free_lists_, free_lists_ + NUM_SIZE_CLASSES, (free_node*)NULL);
+  }
+
+  void* allocate(std::size_t bytes) {
+    std::size_t size_class = (bytes + ALIGNMENT - 1) / ALIGNMENT;
+    free_node* node = free_lists_[size_class];
+    if (node) {
+      free_lists_[size_class] = node->next;
+      return node;
+    }
+    std::size_t size = size_class * ALIGNMENT;
+    if (chunk_used_ + size > CHUNK_SIZE) {
+      chunks_.push_back(std::unique_ptr<char[]>(new char[CHUNK_SIZE]));
+      chunk_used_ = 0;
+    }
+    void* block = chunks_.back().get() + chunk_used_;
+    chunk_used_ += size;
+    return block;
+  }
+
+  void deallocate(void* block, std::size_t bytes) {
+    std::size_t size_class = (bytes + ALIGNMENT - 1) / ALIGNMENT;
+    free_node* node = static_cast<free_node*>(block);
+    node->next = free_lists_[size_class];
+    free_lists_[size_class] = node;
+  }
+
+  std::size_t capacity() const {
+    return chunks_.size() * CHUNK_SIZE;
+  }
+
+ private:
+  static const std::size_t ALIGNMENT = 16;
+  static const std::size_t CHUNK_SIZE = 1 << 20;
+  static const std::size_t NUM_SIZE_CLASSES = MAX_NODE_SIZE / ALIGNMENT + 1;
+
+  struct free_node {
+    free_node* next;
+  };
+
+  std::vector<std::unique_ptr<char[]> > chunks_;
+  std::size_t chunk_used_;
+  free_node* free_lists_[NUM_SIZE_CLASSES];
+
+  // Disallow copy constructor and operator=
+  voronoi_node_pool(const voronoi_node_pool&);
+  void operator=(const voronoi_node_pool&);
+};
+
+// Standard allocator over a voronoi_node_pool. Single nodes come from the
+// pool, arrays (such as the storage of a vector) from the global
+// allocator.
+template <typename T>
+class voronoi_pool_allocator {
+ public:
+  typedef T value_type;
+
+  explicit voronoi_pool_allocator(voronoi_node_pool* pool) : pool_(pool) {}
+
+  template <typename U>
+  voronoi_pool_allocator(const voronoi_pool_allocator<U>& other) :
+      pool_(other.pool()) {}
+
+  T* allocate(std::size_t n) {
+    if (n == 1 && sizeof(T) <= voronoi_node_pool::MAX_NODE_SIZE) {
+      return static_cast<T*>(pool_->allocate(sizeof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    if (n == 1 && sizeof(T) <= voronoi_node_pool::MAX_NODE_SIZE) {
+      pool_->deallocate(p, sizeof(T));
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+  voronoi_node_pool* pool() const {
+    return pool_;
+  }
+
+ private:
+  voronoi_node_pool* pool_;
+};
+
+template <typename T, typename U>
+bool operator==(const voronoi_pool_allocator<T>& lhs,
+                const voronoi_pool_allocator<U>& rhs) {
+  return lhs.pool() == rhs.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const voronoi_pool_allocator<T>& lhs,
+                const voronoi_pool_allocator<U>& rhs) {
+  return lhs.pool() != rhs.pool();
+}
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_NODE_POOL
@@ -0,0 +1,230 @@
+// Boost.Polygon library voronoi_parallel_utils.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_PARALLEL_UTILS
+#define BOOST_POLYGON_VORONOI_PARALLEL_UTILS
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace boost {
+namespace polygon {
+// Process wide settings of the parallel routines. They may be changed at
+// any time and apply to the routines started afterwards.
+struct voronoi_parallel_settings {
+  // Number of worker threads, 0 stands for the hardware concurrency.
+  std::atomic<std::size_t> num_threads;
+  // In the deterministic mode the work is partitioned statically, the
+  // partial results are merged in the order of the chunks and the sorts
+  // are stable, so the outputs do not depend on the thread count or on
+  // the scheduling. The free running mode hands the chunks out on demand
+  // and merges the partial results as they complete; it is meant for the
+  // callers whose output does not depend on the order. On by default.
+  std::atomic<bool> deterministic;
+};
+
+inline voronoi_parallel_settings& voronoi_parallel_config() {
+  static voronoi_parallel_settings settings = {{0}, {true}};
+  return settings;
+}
+
+// Number of worker threads used by the parallel routines.
+inline std::size_t voronoi_thread_count() {
+  std::size_t count = voronoi_parallel_config().num_threads;
+  if (count) {
+    return count;
+  }
+  count = std::thread::hardware_concurrency();
+  return count ? count : 1;
+}
+
+// Runs worker(thread_index) on num_threads threads, one of them the
+// calling thread, and waits for all of them.
+template <typename Worker>
+void voronoi_run_workers(std::size_t num_threads, Worker worker) {
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.push_back(std::thread(worker, i));
+  }
+  worker(std::size_t(0));
+  for (std::size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+}
+
+// Calls fn(chunk, first, last) for the consecutive chunks of at most grain
+// items that together cover the range [0, size); the chunk bounds only
+// depend on size and grain. Free running, the chunks are handed out to the
+// worker threads on demand; in the deterministic mode every thread gets a
+// contiguous run of chunks. fn has to be safe to call concurrently for
+// disjoint ranges. Small ranges are processed on the calling thread.
+template <typename Function>
+void voronoi_parallel_chunks(std::size_t size, std::size_t grain,
+                             bool deterministic, Function fn) {
+  if (grain == 0) {
+    grain = 1;
+  }
+  std::size_t num_chunks = (size + grain - 1) / grain;
+  std::size_t num_threads = (std::min)(voronoi_thread_count(), num_chunks);
+  if (num_threads <= 1) {
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk) {
+      std::size_t first = chunk * grain;
+      fn(chunk, first, (std::min)(first + grain, size));
+    }
+    return;
+  }
+  if (deterministic) {
+    voronoi_run_workers(num_threads, [&](std::size_t thread) {
+      std::size_t chunk_last = num_chunks * (thread + 1) / num_threads;
+      for (std::size_t chunk = num_chunks * thread / num_threads;
+           chunk < chunk_last; ++chunk) {
+        std::size_t first = chunk * grain;
+        fn(chunk, first, (std::min)(first + grain, size));
+      }
+    });
+    return;
+  }
+  std::atomic<std::size_t> next_chunk(0);
+  voronoi_run_workers(num_threads, [&](std::size_t) {
+    for (std::size_t chunk = next_chunk++; chunk < num_chunks;
+         chunk = next_chunk++) {
+      std::size_t first = chunk * grain;
+      fn(chunk, first, (std::min)(first + grain, size));
+    }
+  });
+}
+
+// Same in the mode of voronoi_parallel_config.
+template <typename Function>
+void voronoi_parallel_chunks(std::size_t size, std::size_t grain,
+                             Function fn) {
+  voronoi_parallel_chunks(size, grain, voronoi_parallel_config().deterministic,
+                          fn);
+}
+
+// Calls fn(first, last) for the chunks of voronoi_parallel_chunks. Small
+// ranges are processed on the calling thread in a single call.
+template <typename Function>
+void voronoi_parallel_for(std::size_t size, std::size_t grain,
+                          Function fn) {
+  if (size <= grain || voronoi_thread_count() <= 1) {
+    if (size) {
+      fn(std::size_t(0), size);
+    }
+    return;
+  }
+  voronoi_parallel_chunks(size, grain,
+      [&](std::size_t, std::size_t first, std::size_t last) {
+    fn(first, last);
+  });
+}
+
+// Calls fn(first, last, &partial) with a default constructed partial
+// result for the chunks of voronoi_parallel_chunks and combines the partial
+// results into result with merge(result, &partial). Free running, every
+// partial is merged as soon as its chunk is done, in the order the chunks
+// complete. In the deterministic mode the partials are kept until all the
+// chunks are done and merged in the chunk order, so the result is the same
+// for any thread count even if merge is not commutative, such as appending
+// to a buffer, at the cost of holding all the partials at once.
+template <typename T, typename Function, typename Merge>
+void voronoi_parallel_reduce(std::size_t size, std::size_t grain,
+                             bool deterministic, T* result, Function fn,
+                             Merge merge) {
+  if (grain == 0) {
+    grain = 1;
+  }
+  if (deterministic) {
+    std::vector<T> partials((size + grain - 1) / grain);
+    voronoi_parallel_chunks(size, grain, true,
+        [&](std::size_t chunk, std::size_t first, std::size_t last) {
+      fn(first, last, &partials[chunk]);
+    });
+    for (std::size_t i = 0; i < partials.size(); ++i) {
+      merge(result, &partials[i]);
+    }
+    return;
+  }
+  std::mutex result_mutex;
+  voronoi_parallel_chunks(size, grain, false,
+      [&](std::size_t, std::size_t first, std::size_t last) {
+    T partial = T();
+    fn(first, last, &partial);
+    std::lock_guard<std::mutex> lock(result_mutex);
+    merge(result, &partial);
+  });
+}
+
+// Same in the mode of voronoi_parallel_config.
+template <typename T, typename Function, typename Merge>
+void voronoi_parallel_reduce(std::size_t size, std::size_t grain, T* result,
+                             Function fn, Merge merge) {
+  voronoi_parallel_reduce(size, grain, voronoi_parallel_config().deterministic,
+                          result, fn, merge);
+}
+
+// Sorts the range by sorting equal slices of it concurrently and merging
+// them pairwise. Falls back to std::sort for small ranges. The order of
+// the equivalent elements depends on the number of slices, unless the
+// deterministic mode is on: then the slices are sorted stably and the
+// result is the one of std::stable_sort.
+template <typename RandomIt, typename Compare>
+void voronoi_parallel_sort(RandomIt first, RandomIt last, Compare comp) {
+  const std::size_t min_slice = 1 << 15;
+  const bool stable = voronoi_parallel_config().deterministic;
+  std::size_t size = last - first;
+  std::size_t num_slices = (std::min)(voronoi_thread_count(),
+                                      size / min_slice);
+  if (num_slices <= 1) {
+    if (stable) {
+      std::stable_sort(first, last, comp);
+    } else {
+      std::sort(first, last, comp);
+    }
+    return;
+  }
+  std::vector<std::size_t> bounds(num_slices + 1);
+  for (std::size_t i = 0; i <= num_slices; ++i) {
+    bounds[i] = size * i / num_slices;
+  }
+  voronoi_parallel_for(num_slices, 1,
+                       [&](std::size_t slice_first, std::size_t slice_last) {
+    for (std::size_t i = slice_first; i < slice_last; ++i) {
+      if (stable) {
+        std::stable_sort(first + bounds[i], first + bounds[i + 1], comp);
+      } else {
+        std::sort(first + bounds[i], first + bounds[i + 1], comp);
+      }
+    }
+  });
+  for (std::size_t width = 1; width < num_slices; width *= 2) {
+    std::size_t num_merges = (num_slices + 2 * width - 1) / (2 * width);
+    voronoi_parallel_for(num_merges, 1,
+                         [&](std::size_t merge_first, std::size_t merge_last) {
+      for (std::size_t i = merge_first; i < merge_last; ++i) {
+        std::size_t lo = 2 * width * i;
+        std::size_t mid = (std::min)(lo + width, num_slices);
+        std::size_t hi = (std::min)(lo + 2 * width, num_slices);
+        if (mid < hi) {
+          std::inplace_merge(first + bounds[lo], first + bounds[mid],
+                             first + bounds[hi], comp);
+        }
+      }
+    });
+  }
+}
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_PARALLEL_UTILS
@@ -0,0 +1,217 @@
+// Boost.Polygon library voronoi_quantized_layer.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_QUANTIZED_LAYER
+#define BOOST_POLYGON_VORONOI_QUANTIZED_LAYER
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "voronoi_visual_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Render geometry with positions packed into 16 bit integers. The plane is
+// split into square tiles; every vertex is stored as a signed offset from
+// the center of its tile, measured in quantization steps, so that the
+// rounding error is at most half a step.
+//
+// Geometry is added as single points or as line strips. Strips are clipped
+// to the layer bounds and split where they leave a tile: the tiles overlap
+// by a quarter of their side, so the split point is representable in both
+// tiles and the two parts join without a gap.
+template <typename CT>
+class voronoi_quantized_layer {
+ public:
+  typedef boost::int16_t offset_type;
+  static const int MAX_OFFSET = 32767;
+
+  struct tile {
+    // Origin of the offsets.
+    CT x;
+    CT y;
+    // Vertex offsets as (x, y) pairs.
+    std::vector<offset_type> offsets;
+    // Index of the first vertex of every strip; points are strips made of
+    // a single vertex.
+    std::vector<std::size_t> strips;
+    // Style of every strip, as given to begin_strip. The parts of a split
+    // strip keep its style.
+    std::vector<int> styles;
+
+    std::size_t num_vertices() const {
+      return offsets.size() / 2;
+    }
+  };
+
+  voronoi_quantized_layer() : step_(1), tile_side_(MAX_OFFSET),
+                              xl_(0), yl_(0), xh_(0), yh_(0),
+                              grid_width_(0), grid_height_(0) {
+    begin_strip();
+  }
+
+  // Args:
+  //   step: size of the quantization step.
+  //   xl, yl, xh, yh: bounds of the layer, geometry outside is dropped.
+  voronoi_quantized_layer(CT step, CT xl, CT yl, CT xh, CT yh) :
+      step_(step), tile_side_(step * MAX_OFFSET),
+      xl_(xl), yl_(yl), xh_(xh), yh_(yh) {
+    grid_width_ = (std::max)(1, static_cast<int>(
+        std::ceil((xh_ - xl_) / tile_side_)));
+    grid_height_ = (std::max)(1, static_cast<int>(
+        std::ceil((yh_ - yl_) / tile_side_)));
+    begin_strip();
+  }
+
+  CT step() const {
+    return step_;
+  }
+
+  const std::vector<tile>& tiles() const {
+    return tiles_;
+  }
+
+  std::size_t num_vertices() const {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < tiles_.size(); ++i) {
+      count += tiles_[i].num_vertices();
+    }
+    return count;
+  }
+
+  void add_point(CT px, CT py) {
+    if (px < xl_ || px > xh_ || py < yl_ || py > yh_) {
+      return;
+    }
+    start_strip(tile_index(px, py), px, py);
+  }
+
+  // Starts a new line strip, the following add_vertex calls extend it.
+  // The style is an opaque value kept along with the strip.
+  void begin_strip(int style = 0) {
+    current_tile_ = NO_TILE;
+    has_last_ = false;
+    style_ = style;
+  }
+
+  void add_vertex(CT qx, CT qy) {
+    CT px = last_x_;
+    CT py = last_y_;
+    last_x_ = qx;
+    last_y_ = qy;
+    if (!has_last_) {
+      has_last_ = true;
+      return;
+    }
+    CT t0 = 0;
+    CT t1 = 1;
+    if (!voronoi_visual_utils<CT>::clip(px, py, qx, qy,
+                                        xl_, yl_, xh_, yh_, &t0, &t1)) {
+      current_tile_ = NO_TILE;
+      return;
+    }
+    CT ax = px + t0 * (qx - px);
+    CT ay = py + t0 * (qy - py);
+    CT bx = px + t1 * (qx - px);
+    CT by = py + t1 * (qy - py);
+    if (current_tile_ == NO_TILE || t0 > 0) {
+      current_tile_ = tile_index(ax, ay);
+      start_strip(current_tile_, ax, ay);
+    }
+    // Every vertex of a tile lies within its overlap region, walk over the
+    // tiles until the end of the segment is covered.
+    const CT half = CT(0.75) * tile_side_;
+    while (!covers(tiles_[current_tile_], bx, by)) {
+      const tile& t = tiles_[current_tile_];
+      CT s0 = 0;
+      CT s1 = 1;
+      voronoi_visual_utils<CT>::clip(ax, ay, bx, by, t.x - half, t.y - half,
+                                     t.x + half, t.y + half, &s0, &s1);
+      CT ex = ax + s1 * (bx - ax);
+      CT ey = ay + s1 * (by - ay);
+      push(tiles_[current_tile_], ex, ey);
+      current_tile_ = tile_index(ex, ey);
+      start_strip(current_tile_, ex, ey);
+      ax = ex;
+      ay = ey;
+    }
+    push(tiles_[current_tile_], bx, by);
+    if (t1 < 1) {
+      current_tile_ = NO_TILE;
+    }
+  }
+
+ private:
+  static const std::size_t NO_TILE = ~static_cast<std::size_t>(0);
+
+  // Whether the point lies within the overlap region of the tile, which is
+  // representable with some margin.
+  bool covers(const tile& t, CT px, CT py) const {
+    CT half = CT(0.75) * tile_side_;
+    return std::fabs(px - t.x) <= half && std::fabs(py - t.y) <= half;
+  }
+
+  std::size_t tile_index(CT px, CT py) {
+    int cx = static_cast<int>(std::floor((px - xl_) / tile_side_));
+    int cy = static_cast<int>(std::floor((py - yl_) / tile_side_));
+    cx = (std::max)(0, (std::min)(cx, grid_width_ - 1));
+    cy = (std::max)(0, (std::min)(cy, grid_height_ - 1));
+    std::pair<std::map<std::pair<int, int>, std::size_t>::iterator, bool>
+        it = tile_map_.insert(std::make_pair(std::make_pair(cx, cy),
+                                             tiles_.size()));
+    if (it.second) {
+      tiles_.push_back(tile());
+      tiles_.back().x = xl_ + (cx + CT(0.5)) * tile_side_;
+      tiles_.back().y = yl_ + (cy + CT(0.5)) * tile_side_;
+    }
+    return it.first->second;
+  }
+
+  void start_strip(std::size_t index, CT px, CT py) {
+    tile& t = tiles_[index];
+    t.strips.push_back(t.num_vertices());
+    t.styles.push_back(style_);
+    push(t, px, py);
+  }
+
+  void push(tile& t, CT px, CT py) const {
+    t.offsets.push_back(quantize(px - t.x));
+    t.offsets.push_back(quantize(py - t.y));
+  }
+
+  offset_type quantize(CT delta) const {
+    CT steps = std::floor(delta / step_ + CT(0.5));
+    steps = (std::max)(CT(-MAX_OFFSET), (std::min)(CT(MAX_OFFSET), steps));
+    return static_cast<offset_type>(steps);
+  }
+
+  CT step_;
+  CT tile_side_;
+  CT xl_, yl_, xh_, yh_;
+  int grid_width_;
+  int grid_height_;
+  std::vector<tile> tiles_;
+  std::map<std::pair<int, int>, std::size_t> tile_map_;
+  // State of the strip being added.
+  std::size_t current_tile_;
+  bool has_last_;
+  int style_;
+  CT last_x_;
+  CT last_y_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_QUANTIZED_LAYER
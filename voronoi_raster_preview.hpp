@@ -0,0 +1,352 @@
+// Boost.Polygon library voronoi_raster_preview.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_RASTER_PREVIEW
+#define BOOST_POLYGON_VORONOI_RASTER_PREVIEW
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include <boost/polygon/isotropy.hpp>
+#include <boost/polygon/point_concept.hpp>
+#include <boost/polygon/segment_concept.hpp>
+
+#include "voronoi_parallel_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Approximate Voronoi diagram on a raster. Every pixel is labeled with the
+// index of the closest input site, which gives a usable picture of the
+// diagram long before the exact construction finishes.
+//
+// Sites are indexed the same way as Voronoi cells report their source index:
+// points first, followed by the segments. Segment endpoints are not treated
+// as separate sites.
+//
+// The sites are bucketed into a uniform grid; the closest site to a pixel is
+// found by scanning grid rings around the pixel until no closer site can
+// exist. Pixels are processed in square tiles in parallel.
+template <typename CT>
+class voronoi_raster_preview {
+ public:
+  typedef unsigned int label_type;
+  static constexpr label_type NO_SITE = ~0u;
+
+  // Args:
+  //   points: input points.
+  //   segments: input segments.
+  //   xl, yl, xh, yh: area covered by the raster.
+  //   max_cells: upper bound on the number of grid cells; there is no point
+  //     in making the grid finer than the raster it is queried for.
+  template <class Point, class Segment>
+  voronoi_raster_preview(const std::vector<Point>& points,
+                         const std::vector<Segment>& segments,
+                         CT xl, CT yl, CT xh, CT yh,
+                         std::size_t max_cells = 1 << 20) :
+      xl_(xl), yl_(yl), xh_(xh), yh_(yh) {
+    sites_.reserve(4 * (points.size() + segments.size()));
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      add_site(x(points[i]), y(points[i]), x(points[i]), y(points[i]));
+    }
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      add_site(x(low(segments[i])), y(low(segments[i])),
+               x(high(segments[i])), y(high(segments[i])));
+    }
+    build_grid(max_cells);
+  }
+
+  std::size_t num_sites() const {
+    return sites_.size() / 4;
+  }
+
+  // Returns index of the site closest to the given point or NO_SITE if
+  // there are no sites.
+  label_type nearest_site(CT px, CT py) const {
+    return nearest_site(px, py, accept_all());
+  }
+
+  // Same among the sites the accept predicate holds for, NO_SITE if it
+  // holds for none.
+  template <typename Accept>
+  label_type nearest_site(CT px, CT py, Accept accept) const {
+    if (sites_.empty()) {
+      return NO_SITE;
+    }
+    int cx = cell_x(px);
+    int cy = cell_y(py);
+    CT cell_side = (std::min)(cell_width_, cell_height_);
+    CT best_dist = (std::numeric_limits<CT>::max)();
+    label_type best = NO_SITE;
+    int max_ring = (std::max)(grid_width_, grid_height_);
+    for (int ring = 0; ring <= max_ring; ++ring) {
+      int y_first = (std::max)(cy - ring, 0);
+      int y_last = (std::min)(cy + ring, grid_height_ - 1);
+      for (int gy = y_first; gy <= y_last; ++gy) {
+        if (gy == cy - ring || gy == cy + ring) {
+          int x_first = (std::max)(cx - ring, 0);
+          int x_last = (std::min)(cx + ring, grid_width_ - 1);
+          for (int gx = x_first; gx <= x_last; ++gx) {
+            scan_cell(gx, gy, px, py, accept, &best, &best_dist);
+          }
+        } else {
+          if (cx - ring >= 0) {
+            scan_cell(cx - ring, gy, px, py, accept, &best, &best_dist);
+          }
+          if (cx + ring < grid_width_) {
+            scan_cell(cx + ring, gy, px, py, accept, &best, &best_dist);
+          }
+        }
+      }
+      // Sites from the next ring are at least ring cells away.
+      CT ring_dist = cell_side * ring;
+      if (best != NO_SITE && best_dist <= ring_dist * ring_dist) {
+        break;
+      }
+    }
+    return best;
+  }
+
+  // Labels a width x height raster covering the area passed to the
+  // constructor. Row 0 of the output corresponds to the lowest y.
+  void label(int width, int height, std::vector<label_type>* labels) const {
+    label(width, height, true, labels);
+  }
+
+  // Same, on the calling thread only unless parallel is set, for the
+  // callers that run on worker threads of their own.
+  void label(int width, int height, bool parallel,
+             std::vector<label_type>* labels) const {
+    labels->assign(static_cast<std::size_t>(width) * height, NO_SITE);
+    if (sites_.empty() || width <= 0 || height <= 0) {
+      return;
+    }
+    const int tile_side = 64;
+    const int tiles_x = (width + tile_side - 1) / tile_side;
+    const int tiles_y = (height + tile_side - 1) / tile_side;
+    const CT pixel_width = (xh_ - xl_) / width;
+    const CT pixel_height = (yh_ - yl_) / height;
+    label_type* output = labels->data();
+    std::size_t num_tiles = static_cast<std::size_t>(tiles_x) * tiles_y;
+    auto label_tiles = [&](std::size_t first, std::size_t last) {
+      for (std::size_t tile = first; tile < last; ++tile) {
+        int x0 = static_cast<int>(tile % tiles_x) * tile_side;
+        int y0 = static_cast<int>(tile / tiles_x) * tile_side;
+        int x1 = (std::min)(x0 + tile_side, width);
+        int y1 = (std::min)(y0 + tile_side, height);
+        for (int j = y0; j < y1; ++j) {
+          CT py = yl_ + (j + CT(0.5)) * pixel_height;
+          label_type* row = output + static_cast<std::size_t>(j) * width;
+          for (int i = x0; i < x1; ++i) {
+            row[i] = nearest_site(xl_ + (i + CT(0.5)) * pixel_width, py);
+          }
+        }
+      }
+    };
+    if (parallel) {
+      voronoi_parallel_for(num_tiles, 1, label_tiles);
+    } else {
+      label_tiles(0, num_tiles);
+    }
+  }
+
+  // Sets sites to the sites with their anchor, the point or the segment
+  // midpoint, inside the given rectangle, in increasing order. Returns
+  // false if there are more than max_sites of them, sites being
+  // incomplete then. Only the grid cells overlapping the rectangle are
+  // scanned, so the cost depends on the number of sites around it.
+  bool sites_in_rect(CT rxl, CT ryl, CT rxh, CT ryh, std::size_t max_sites,
+                     std::vector<label_type>* sites) const {
+    return sites_in_rect(rxl, ryl, rxh, ryh, max_sites, accept_all(), sites);
+  }
+
+  // Same among the sites the accept predicate holds for, the rejected ones
+  // don't count against max_sites.
+  template <typename Accept>
+  bool sites_in_rect(CT rxl, CT ryl, CT rxh, CT ryh, std::size_t max_sites,
+                     Accept accept, std::vector<label_type>* sites) const {
+    sites->clear();
+    if (sites_.empty() || rxh < xl_ || rxl > xh_ || ryh < yl_ || ryl > yh_) {
+      return true;
+    }
+    // Segments are sampled at half of the cell size, the cell of the
+    // midpoint may be skipped but a neighbor of it is not.
+    int x_first = (std::max)(cell_x(rxl) - 1, 0);
+    int x_last = (std::min)(cell_x(rxh) + 1, grid_width_ - 1);
+    int y_first = (std::max)(cell_y(ryl) - 1, 0);
+    int y_last = (std::min)(cell_y(ryh) + 1, grid_height_ - 1);
+    for (int gy = y_first; gy <= y_last; ++gy) {
+      for (int gx = x_first; gx <= x_last; ++gx) {
+        std::size_t cell = static_cast<std::size_t>(gy) * grid_width_ + gx;
+        for (std::size_t i = cell_start_[cell]; i < cell_start_[cell + 1];
+             ++i) {
+          const CT* s = &sites_[4 * static_cast<std::size_t>(cell_sites_[i])];
+          CT ax = CT(0.5) * (s[0] + s[2]);
+          CT ay = CT(0.5) * (s[1] + s[3]);
+          if (ax >= rxl && ax <= rxh && ay >= ryl && ay <= ryh &&
+              accept(cell_sites_[i])) {
+            sites->push_back(cell_sites_[i]);
+          }
+        }
+        // Segments are listed in every cell they cross.
+        if (sites->size() > 2 * max_sites + 64) {
+          compact(sites);
+          if (sites->size() > max_sites) {
+            return false;
+          }
+        }
+      }
+    }
+    compact(sites);
+    return sites->size() <= max_sites;
+  }
+
+ private:
+  struct accept_all {
+    bool operator()(label_type) const {
+      return true;
+    }
+  };
+
+  static void compact(std::vector<label_type>* sites) {
+    std::sort(sites->begin(), sites->end());
+    sites->erase(std::unique(sites->begin(), sites->end()), sites->end());
+  }
+
+  void add_site(CT x0, CT y0, CT x1, CT y1) {
+    sites_.push_back(x0);
+    sites_.push_back(y0);
+    sites_.push_back(x1);
+    sites_.push_back(y1);
+  }
+
+  int cell_x(CT px) const {
+    int cx = static_cast<int>((px - xl_) / cell_width_);
+    return (std::max)(0, (std::min)(cx, grid_width_ - 1));
+  }
+
+  int cell_y(CT py) const {
+    int cy = static_cast<int>((py - yl_) / cell_height_);
+    return (std::max)(0, (std::min)(cy, grid_height_ - 1));
+  }
+
+  // Calls fn(cell_index) for the grid cells crossed by the site, sampling
+  // the site at half of the cell size. Consecutive duplicates are skipped.
+  template <typename Function>
+  void for_each_site_cell(std::size_t site, Function fn) const {
+    const CT* s = &sites_[4 * site];
+    CT dx = s[2] - s[0];
+    CT dy = s[3] - s[1];
+    if (dx == 0 && dy == 0) {
+      fn(cell_y(s[1]) * grid_width_ + cell_x(s[0]));
+      return;
+    }
+    CT step = CT(0.5) * (std::min)(cell_width_, cell_height_);
+    CT length = std::sqrt(dx * dx + dy * dy);
+    std::size_t num_steps = static_cast<std::size_t>(length / step) + 1;
+    int last_cell = -1;
+    for (std::size_t i = 0; i <= num_steps; ++i) {
+      CT t = static_cast<CT>(i) / num_steps;
+      int cell = cell_y(s[1] + dy * t) * grid_width_ + cell_x(s[0] + dx * t);
+      if (cell != last_cell) {
+        fn(cell);
+        last_cell = cell;
+      }
+    }
+  }
+
+  void build_grid(std::size_t max_cells) {
+    std::size_t num = num_sites();
+    CT width = (std::max)(xh_ - xl_, CT(1));
+    CT height = (std::max)(yh_ - yl_, CT(1));
+    // Aim at a couple of sites per cell.
+    CT num_cells = static_cast<CT>(
+        (std::max)((std::min)(num / 2, max_cells), std::size_t(1)));
+    grid_width_ = static_cast<int>(
+        std::ceil(std::sqrt(num_cells * width / height)));
+    grid_width_ = (std::max)(1, (std::min)(grid_width_, 4096));
+    grid_height_ = static_cast<int>(std::ceil(num_cells / grid_width_));
+    grid_height_ = (std::max)(1, (std::min)(grid_height_, 4096));
+    cell_width_ = width / grid_width_;
+    cell_height_ = height / grid_height_;
+
+    // Counting sort of the sites into the grid cells.
+    cell_start_.assign(
+        static_cast<std::size_t>(grid_width_) * grid_height_ + 1, 0);
+    for (std::size_t i = 0; i < num; ++i) {
+      for_each_site_cell(i, [&](int cell) { ++cell_start_[cell + 1]; });
+    }
+    for (std::size_t i = 1; i < cell_start_.size(); ++i) {
+      cell_start_[i] += cell_start_[i - 1];
+    }
+    cell_sites_.resize(cell_start_.back());
+    std::vector<std::size_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+    for (std::size_t i = 0; i < num; ++i) {
+      for_each_site_cell(i, [&](int cell) {
+        cell_sites_[fill[cell]++] = static_cast<label_type>(i);
+      });
+    }
+  }
+
+  template <typename Accept>
+  void scan_cell(int gx, int gy, CT px, CT py, Accept& accept,
+                 label_type* best, CT* best_dist) const {
+    std::size_t cell = static_cast<std::size_t>(gy) * grid_width_ + gx;
+    for (std::size_t i = cell_start_[cell]; i < cell_start_[cell + 1]; ++i) {
+      label_type site = cell_sites_[i];
+      if (!accept(site)) {
+        continue;
+      }
+      CT dist = site_distance(site, px, py);
+      // Ties go to the lower index to keep the output deterministic.
+      if (dist < *best_dist || (dist == *best_dist && site < *best)) {
+        *best_dist = dist;
+        *best = site;
+      }
+    }
+  }
+
+  // Squared distance from the point to the site.
+  CT site_distance(label_type site, CT px, CT py) const {
+    const CT* s = &sites_[4 * static_cast<std::size_t>(site)];
+    CT dx = s[2] - s[0];
+    CT dy = s[3] - s[1];
+    CT vx = px - s[0];
+    CT vy = py - s[1];
+    CT sqr_length = dx * dx + dy * dy;
+    if (sqr_length > 0) {
+      CT t = (vx * dx + vy * dy) / sqr_length;
+      t = (std::max)(CT(0), (std::min)(CT(1), t));
+      vx -= t * dx;
+      vy -= t * dy;
+    }
+    return vx * vx + vy * vy;
+  }
+
+  CT xl_, yl_, xh_, yh_;
+  // Site geometry as (x0, y0, x1, y1) quadruples; points are degenerate
+  // segments.
+  std::vector<CT> sites_;
+  int grid_width_;
+  int grid_height_;
+  CT cell_width_;
+  CT cell_height_;
+  std::vector<std::size_t> cell_start_;
+  std::vector<label_type> cell_sites_;
+};
+
+template <typename CT>
+constexpr typename voronoi_raster_preview<CT>::label_type
+    voronoi_raster_preview<CT>::NO_SITE;
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_RASTER_PREVIEW
@@ -0,0 +1,376 @@
+// Boost.Polygon library voronoi_region_index.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_REGION_INDEX
+#define BOOST_POLYGON_VORONOI_REGION_INDEX
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <boost/cstdint.hpp>
+
+namespace boost {
+namespace polygon {
+// Coarse spatial index of an input file, stored next to it as
+// <input>.vidx. The index maps the cells of a uniform grid to the byte
+// offsets of the input records (one point or one segment per line) that
+// fall into them, so that the sites of a rectangular region can be read
+// without parsing the whole file.
+//
+// Points are assigned to the cell containing them, segments to the cell
+// containing the center of their bounding box; the largest half extent of
+// a segment bounding box is stored to widen the cell lookup. Only the
+// inputs with every count and every record on a line of its own can be
+// indexed.
+//
+// Index layout (native endianness):
+//   char[4] magic "VIDX", uint32 version
+//   uint64 size and int64 modification time (seconds) of the input file,
+//     used to detect stale indices
+//   int32 xl, yl, xh, yh: bounding box of the sites
+//   int32 grid_width, grid_height, max_segment_extent
+//   uint64 cell_start[grid_width * grid_height + 1]
+//   uint64 records[]: (byte offset << 1) | is_segment
+class voronoi_region_index {
+ public:
+  voronoi_region_index() : grid_width_(0), grid_height_(0), max_extent_(0),
+                           num_records_(0) {}
+
+  static std::string index_path(const std::string& input_path) {
+    return input_path + ".vidx";
+  }
+
+  // Opens the index of the given input file, building and storing it if
+  // it does not exist yet or does not match the file. Building the index
+  // requires a single pass over the input. Returns false if the file can
+  // not be indexed.
+  bool open(const std::string& input_path) {
+    input_path_ = input_path;
+    file_stamp stamp;
+    if (!stat_file(input_path, &stamp)) {
+      return false;
+    }
+    if (read_index(stamp)) {
+      return true;
+    }
+    return build_index(stamp) && read_index(stamp);
+  }
+
+  // Loads the sites intersecting the given rectangle: points lying inside
+  // it and segments whose bounding box intersects it. Records are read in
+  // file order.
+  template <class Point, class Segment>
+  bool load(int xl, int yl, int xh, int yh,
+            std::vector<Point>* points,
+            std::vector<Segment>* segments) const {
+    std::ifstream index(index_path(input_path_).c_str(), std::ios::binary);
+    std::ifstream input(input_path_.c_str(), std::ios::binary);
+    if (!index || !input || grid_width_ == 0) {
+      return false;
+    }
+    int cx1 = cell_x(static_cast<double>(xl) - max_extent_);
+    int cx2 = cell_x(static_cast<double>(xh) + max_extent_);
+    int cy1 = cell_y(static_cast<double>(yl) - max_extent_);
+    int cy2 = cell_y(static_cast<double>(yh) + max_extent_);
+
+    // Cells of a grid row are stored contiguously, read them in one go.
+    std::vector<boost::uint64_t> records;
+    for (int cy = cy1; cy <= cy2; ++cy) {
+      std::size_t first = cell_start_[cell_index(cx1, cy)];
+      std::size_t last = cell_start_[cell_index(cx2, cy) + 1];
+      std::size_t old_size = records.size();
+      records.resize(old_size + (last - first));
+      if (last == first) {
+        continue;
+      }
+      index.seekg(records_offset_ + first * sizeof(boost::uint64_t));
+      index.read(reinterpret_cast<char*>(&records[old_size]),
+                 (last - first) * sizeof(boost::uint64_t));
+    }
+    if (!index) {
+      return false;
+    }
+    std::sort(records.begin(), records.end());
+
+    std::string line;
+    int c[4];
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      bool is_segment = (records[i] & 1) != 0;
+      input.seekg(static_cast<std::streamoff>(records[i] >> 1));
+      std::getline(input, line);
+      if (parse_ints(line, c, is_segment ? 4 : 2) != (is_segment ? 4 : 2)) {
+        return false;
+      }
+      if (is_segment) {
+        if ((std::max)(c[0], c[2]) < xl || (std::min)(c[0], c[2]) > xh ||
+            (std::max)(c[1], c[3]) < yl || (std::min)(c[1], c[3]) > yh) {
+          continue;
+        }
+        segments->push_back(Segment(Point(c[0], c[1]), Point(c[2], c[3])));
+      } else {
+        if (c[0] < xl || c[0] > xh || c[1] < yl || c[1] > yh) {
+          continue;
+        }
+        points->push_back(Point(c[0], c[1]));
+      }
+    }
+    return true;
+  }
+
+  std::size_t num_records() const {
+    return num_records_;
+  }
+
+ private:
+  static const boost::uint32_t VERSION = 2;
+
+  struct record {
+    boost::uint64_t offset;
+    int x;
+    int y;
+  };
+
+  // Size and modification time of the input file.
+  struct file_stamp {
+    boost::uint64_t size;
+    boost::int64_t mtime;
+  };
+
+  static bool stat_file(const std::string& path, file_stamp* stamp) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      return false;
+    }
+    stamp->size = static_cast<boost::uint64_t>(st.st_size);
+    stamp->mtime = static_cast<boost::int64_t>(st.st_mtime);
+    return true;
+  }
+
+  // Parses up to count integers from the line, returns how many were read.
+  static int parse_ints(const std::string& line, int* values, int count) {
+    const char* cur = line.c_str();
+    for (int i = 0; i < count; ++i) {
+      char* end;
+      long value = std::strtol(cur, &end, 10);
+      if (end == cur) {
+        return i;
+      }
+      values[i] = static_cast<int>(value);
+      cur = end;
+    }
+    return count;
+  }
+
+  // Parses exactly count integers that make up the whole line.
+  static bool parse_line(const std::string& line, int* values, int count) {
+    const char* cur = line.c_str();
+    for (int i = 0; i < count; ++i) {
+      char* end;
+      long value = std::strtol(cur, &end, 10);
+      if (end == cur) {
+        return false;
+      }
+      values[i] = static_cast<int>(value);
+      cur = end;
+    }
+    return std::strspn(cur, " \t\r") == std::strlen(cur);
+  }
+
+  std::size_t cell_index(int cx, int cy) const {
+    return static_cast<std::size_t>(cy) * grid_width_ + cx;
+  }
+
+  int cell_x(double px) const {
+    int cx = static_cast<int>(std::floor((px - xl_) / cell_width_));
+    return (std::max)(0, (std::min)(cx, grid_width_ - 1));
+  }
+
+  int cell_y(double py) const {
+    int cy = static_cast<int>(std::floor((py - yl_) / cell_height_));
+    return (std::max)(0, (std::min)(cy, grid_height_ - 1));
+  }
+
+  void set_grid(int xl, int yl, int xh, int yh, int width, int height) {
+    xl_ = xl;
+    yl_ = yl;
+    xh_ = xh;
+    yh_ = yh;
+    grid_width_ = width;
+    grid_height_ = height;
+    cell_width_ = (std::max)(static_cast<double>(xh) - xl + 1, 1.0) / width;
+    cell_height_ = (std::max)(static_cast<double>(yh) - yl + 1, 1.0) / height;
+  }
+
+  bool read_index(const file_stamp& source) {
+    std::ifstream in(index_path(input_path_).c_str(), std::ios::binary);
+    char magic[4];
+    boost::uint32_t version;
+    file_stamp stamp;
+    boost::int32_t header[7];
+    if (!in.read(magic, 4) ||
+        !in.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+        !in.read(reinterpret_cast<char*>(&stamp.size), sizeof(stamp.size)) ||
+        !in.read(reinterpret_cast<char*>(&stamp.mtime), sizeof(stamp.mtime)) ||
+        !in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+      return false;
+    }
+    if (std::memcmp(magic, "VIDX", 4) != 0 || version != VERSION ||
+        stamp.size != source.size || stamp.mtime != source.mtime ||
+        header[4] <= 0 || header[5] <= 0) {
+      return false;
+    }
+    set_grid(header[0], header[1], header[2], header[3], header[4], header[5]);
+    max_extent_ = header[6];
+    cell_start_.resize(
+        static_cast<std::size_t>(grid_width_) * grid_height_ + 1);
+    if (!in.read(reinterpret_cast<char*>(cell_start_.data()),
+                 cell_start_.size() * sizeof(boost::uint64_t))) {
+      return false;
+    }
+    records_offset_ = in.tellg();
+    num_records_ = cell_start_.back();
+    return true;
+  }
+
+  bool build_index(const file_stamp& source) {
+    std::ifstream in(input_path_.c_str(), std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    // Collect the byte offset and the representative position of every
+    // record. The input has one count line followed by the point lines,
+    // then one count line followed by the segment lines. Any other layout
+    // that read_voronoi_input accepts, such as several records on a line,
+    // fails here.
+    std::vector<record> points, segments;
+    std::string line;
+    boost::uint64_t offset = 0;
+    long pending = -1;
+    int section = 0;
+    int max_extent = 0;
+    int c[4];
+    while (std::getline(in, line)) {
+      boost::uint64_t line_offset = offset;
+      offset += line.size() + 1;
+      if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+      if (pending <= 0) {
+        if (section == 2) {
+          break;
+        }
+        if (!parse_line(line, c, 1) || c[0] < 0) {
+          return false;
+        }
+        pending = c[0];
+        ++section;
+        continue;
+      }
+      --pending;
+      record r;
+      r.offset = line_offset;
+      if (section == 1) {
+        if (!parse_line(line, c, 2)) {
+          return false;
+        }
+        r.x = c[0];
+        r.y = c[1];
+        points.push_back(r);
+      } else {
+        if (!parse_line(line, c, 4)) {
+          return false;
+        }
+        r.x = static_cast<int>((static_cast<long long>(c[0]) + c[2]) / 2);
+        r.y = static_cast<int>((static_cast<long long>(c[1]) + c[3]) / 2);
+        max_extent = (std::max)(max_extent, (std::max)(
+            std::abs(c[2] - c[0]), std::abs(c[3] - c[1])) / 2 + 1);
+        segments.push_back(r);
+      }
+    }
+    // Files with points only may omit the segment count.
+    if (pending > 0 || section == 0) {
+      return false;
+    }
+
+    std::size_t num = points.size() + segments.size();
+    int xl = 0, yl = 0, xh = 0, yh = 0;
+    for (std::size_t i = 0; i < num; ++i) {
+      const record& r = i < points.size() ? points[i] :
+                                            segments[i - points.size()];
+      if (i == 0 || r.x < xl) xl = r.x;
+      if (i == 0 || r.y < yl) yl = r.y;
+      if (i == 0 || r.x > xh) xh = r.x;
+      if (i == 0 || r.y > yh) yh = r.y;
+    }
+    // A few hundred records per cell keep the index coarse and small.
+    int side = static_cast<int>(std::sqrt(num / 256.0));
+    side = (std::max)(1, (std::min)(side, 1024));
+    set_grid(xl, yl, xh, yh, side, side);
+    max_extent_ = max_extent;
+
+    // Counting sort of the records into the cells.
+    cell_start_.assign(static_cast<std::size_t>(side) * side + 1, 0);
+    for (std::size_t i = 0; i < num; ++i) {
+      const record& r = i < points.size() ? points[i] :
+                                            segments[i - points.size()];
+      ++cell_start_[cell_index(cell_x(r.x), cell_y(r.y)) + 1];
+    }
+    for (std::size_t i = 1; i < cell_start_.size(); ++i) {
+      cell_start_[i] += cell_start_[i - 1];
+    }
+    std::vector<boost::uint64_t> records(num);
+    std::vector<boost::uint64_t> fill(cell_start_.begin(),
+                                      cell_start_.end() - 1);
+    for (std::size_t i = 0; i < num; ++i) {
+      bool is_segment = i >= points.size();
+      const record& r = is_segment ? segments[i - points.size()] : points[i];
+      records[fill[cell_index(cell_x(r.x), cell_y(r.y))]++] =
+          (r.offset << 1) | (is_segment ? 1 : 0);
+    }
+
+    std::ofstream out(index_path(input_path_).c_str(),
+                      std::ios::binary | std::ios::trunc);
+    boost::uint32_t version = VERSION;
+    boost::int32_t header[7] = {xl, yl, xh, yh, side, side, max_extent};
+    out.write("VIDX", 4);
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&source.size),
+              sizeof(source.size));
+    out.write(reinterpret_cast<const char*>(&source.mtime),
+              sizeof(source.mtime));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(cell_start_.data()),
+              cell_start_.size() * sizeof(boost::uint64_t));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              records.size() * sizeof(boost::uint64_t));
+    return static_cast<bool>(out);
+  }
+
+  std::string input_path_;
+  int xl_, yl_, xh_, yh_;
+  int grid_width_;
+  int grid_height_;
+  double cell_width_;
+  double cell_height_;
+  int max_extent_;
+  std::size_t num_records_;
+  std::vector<boost::uint64_t> cell_start_;
+  std::streamoff records_offset_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_REGION_INDEX
@@ -0,0 +1,94 @@
+// Boost.Polygon library voronoi_retirement_queue.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_RETIREMENT_QUEUE
+#define BOOST_POLYGON_VORONOI_RETIREMENT_QUEUE
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace boost {
+namespace polygon {
+// Destroys objects that are no longer needed on a background thread.
+// Freeing the containers of a large diagram takes long enough to be
+// noticeable, the owner hands them over instead and carries on.
+//
+// The thread is started with the first retired object. The destructor
+// waits until everything retired so far has been destroyed.
+class voronoi_retirement_queue {
+ public:
+  voronoi_retirement_queue() : stop_(false) {}
+
+  ~voronoi_retirement_queue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_one();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Takes over the object, which is typically moved in.
+  template <typename T>
+  void retire(T&& object) {
+    std::unique_ptr<retired_object> holder(
+        new retired_holder<typename std::decay<T>::type>(
+            std::forward<T>(object)));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(holder));
+      if (!thread_.joinable()) {
+        thread_ = std::thread(&voronoi_retirement_queue::run, this);
+      }
+    }
+    condition_.notify_one();
+  }
+
+ private:
+  struct retired_object {
+    virtual ~retired_object() {}
+  };
+
+  template <typename T>
+  struct retired_holder : public retired_object {
+    explicit retired_holder(T&& object) : object_(std::move(object)) {}
+    T object_;
+  };
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      std::unique_ptr<retired_object> object = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      object.reset();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::unique_ptr<retired_object> > queue_;
+  bool stop_;
+  std::thread thread_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_RETIREMENT_QUEUE
@@ -0,0 +1,474 @@
+// Boost.Polygon library voronoi_scaling_study.cpp file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+// Runs the stages of the visualizer pipeline that do not need a window on
+// generated inputs of geometrically increasing size and measures their
+// time and peak heap usage. For every stage both measurements are fitted
+// against the n, n log n and n^2 models; stages that grow faster than the
+// complexity they are expected to have are flagged.
+//
+// Two inputs are generated: random points, and small triangles laid out
+// on a grid, whose segments make closed rings for the classification.
+// The sizes go from 10^3 up to 10^max_exponent sites in steps of sqrt(10).
+//
+// Usage: voronoi_scaling_study [-m max_exponent] [-r runs]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/polygon/polygon.hpp>
+#include <boost/polygon/voronoi.hpp>
+using namespace boost::polygon;
+
+#include "voronoi_input.hpp"
+#include "voronoi_interior_classifier.hpp"
+#include "voronoi_quantized_layer.hpp"
+#include "voronoi_raster_preview.hpp"
+#include "voronoi_tile_pyramid.hpp"
+
+typedef double coordinate_type;
+typedef point_data<coordinate_type> point_type;
+typedef segment_data<coordinate_type> segment_type;
+typedef voronoi_diagram<coordinate_type> VD;
+
+// Heap accounting: every allocation carries its size in a header, so the
+// live and the peak number of bytes can be tracked across threads.
+static std::atomic<std::size_t> live_bytes(0);
+static std::atomic<std::size_t> peak_bytes(0);
+static const std::size_t HEADER_SIZE = 16;
+
+void* operator new(std::size_t size) {
+  char* block = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<std::size_t*>(block) = size;
+  std::size_t live = live_bytes += size;
+  std::size_t peak = peak_bytes.load();
+  while (live > peak && !peak_bytes.compare_exchange_weak(peak, live)) {
+  }
+  return block + HEADER_SIZE;
+}
+
+void operator delete(void* pointer) noexcept {
+  if (!pointer) {
+    return;
+  }
+  // The header address goes through an integer, otherwise the compiler
+  // may take free for a mismatched release of operator new memory.
+  std::uintptr_t block = reinterpret_cast<std::uintptr_t>(pointer) -
+                         HEADER_SIZE;
+  live_bytes -= *reinterpret_cast<std::size_t*>(block);
+  std::free(reinterpret_cast<void*>(block));
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+enum complexity_model {
+  LINEAR = 0,
+  LINEARITHMIC = 1,
+  QUADRATIC = 2
+};
+
+static const char* model_name(complexity_model model) {
+  switch (model) {
+    case LINEAR:
+      return "n";
+    case LINEARITHMIC:
+      return "n log n";
+    default:
+      return "n^2";
+  }
+}
+
+static double model_value(complexity_model model, double n) {
+  switch (model) {
+    case LINEAR:
+      return n;
+    case LINEARITHMIC:
+      return n * std::log2(n);
+    default:
+      return n * n;
+  }
+}
+
+struct sample {
+  double n;
+  double ms;
+  double bytes;
+};
+
+// Measurements of one stage on one input family.
+struct stage_series {
+  std::string name;
+  complexity_model expected_time;
+  complexity_model expected_memory;
+  std::vector<sample> samples;
+};
+
+struct fit_result {
+  complexity_model model;
+  // Exponent of the power law fitted in log-log space.
+  double exponent;
+};
+
+// Picks the model with the lowest relative error after scaling it to the
+// measurements by least squares. Values below the noise floor are left
+// out, as they mostly measure the fixed overhead.
+static fit_result fit(const std::vector<sample>& samples, bool memory) {
+  std::vector<double> ns, values;
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    double value = memory ? samples[i].bytes : samples[i].ms;
+    if (value > (memory ? 4096.0 : 0.05)) {
+      ns.push_back(samples[i].n);
+      values.push_back(value);
+    }
+  }
+  fit_result result = {LINEAR, 0.0};
+  if (ns.size() < 2) {
+    return result;
+  }
+  double best_error = 0;
+  for (int m = LINEAR; m <= QUADRATIC; ++m) {
+    complexity_model model = static_cast<complexity_model>(m);
+    // Minimizes sum ((value - c * f) / value)^2 over c.
+    double num = 0, den = 0;
+    for (std::size_t i = 0; i < ns.size(); ++i) {
+      double r = model_value(model, ns[i]) / values[i];
+      num += r;
+      den += r * r;
+    }
+    double c = num / den;
+    double error = 0;
+    for (std::size_t i = 0; i < ns.size(); ++i) {
+      double e = c * model_value(model, ns[i]) / values[i] - 1;
+      error += e * e;
+    }
+    if (m == LINEAR || error < best_error) {
+      best_error = error;
+      result.model = model;
+    }
+  }
+  double mean_x = 0, mean_y = 0;
+  for (std::size_t i = 0; i < ns.size(); ++i) {
+    mean_x += std::log(ns[i]) / ns.size();
+    mean_y += std::log(values[i]) / ns.size();
+  }
+  double sxy = 0, sxx = 0;
+  for (std::size_t i = 0; i < ns.size(); ++i) {
+    double dx = std::log(ns[i]) - mean_x;
+    sxy += dx * (std::log(values[i]) - mean_y);
+    sxx += dx * dx;
+  }
+  result.exponent = sxx > 0 ? sxy / sxx : 0;
+  return result;
+}
+
+// Whether the fit shows faster growth than expected: an unexpected
+// quadratic model, or an exponent clearly above that of the expected
+// model. Cache effects alone easily tip n against n log n, so that choice
+// is not flagged by itself.
+static bool exceeds(const fit_result& result, complexity_model expected) {
+  double max_exponent = expected == QUADRATIC ? 2.0 : 1.0;
+  return (result.model == QUADRATIC && expected != QUADRATIC) ||
+         result.exponent > max_exponent + 0.25;
+}
+
+class stage_timer {
+ public:
+  explicit stage_timer(sample* output) : output_(output) {
+    base_bytes_ = live_bytes.load();
+    peak_bytes = base_bytes_;
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  ~stage_timer() {
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_).count();
+    double bytes = static_cast<double>(peak_bytes.load() - base_bytes_);
+    // Keep the best time; the memory use does not depend on the run.
+    if (output_->ms == 0 || ms < output_->ms) {
+      output_->ms = ms;
+    }
+    output_->bytes = (std::max)(output_->bytes, bytes);
+  }
+
+ private:
+  sample* output_;
+  std::size_t base_bytes_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+static void generate_points(std::size_t n, std::mt19937* random,
+                            std::vector<point_type>* points) {
+  std::uniform_int_distribution<int> coordinate(0, (1 << 30) - 1);
+  points->reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    points->push_back(point_type(coordinate(*random), coordinate(*random)));
+  }
+}
+
+// One triangle per grid cell, so that no two segments cross. Every
+// segment counts as three sites, its endpoints and its interior.
+static void generate_triangles(std::size_t n, std::mt19937* random,
+                               std::vector<segment_type>* segments) {
+  const int cell = 1024;
+  std::size_t num_triangles = (std::max)(std::size_t(1), n / 9);
+  std::size_t side = static_cast<std::size_t>(
+      std::ceil(std::sqrt(static_cast<double>(num_triangles))));
+  std::uniform_int_distribution<int> offset(1, cell - 2);
+  segments->reserve(3 * num_triangles);
+  for (std::size_t i = 0; i < num_triangles; ++i) {
+    double cx = static_cast<double>(i % side) * cell;
+    double cy = static_cast<double>(i / side) * cell;
+    point_type a(cx + offset(*random), cy + offset(*random));
+    point_type b(cx + offset(*random), cy + offset(*random));
+    point_type c(cx + offset(*random), cy + offset(*random));
+    // Degenerate triangles would make overlapping segments.
+    double area = (x(b) - x(a)) * (y(c) - y(a)) - (y(b) - y(a)) * (x(c) - x(a));
+    if (area == 0) {
+      a = point_type(cx + 1, cy + 1);
+      b = point_type(cx + cell - 2, cy + 1);
+      c = point_type(cx + 1, cy + cell - 2);
+    }
+    segments->push_back(segment_type(a, b));
+    segments->push_back(segment_type(b, c));
+    segments->push_back(segment_type(c, a));
+  }
+}
+
+// Runs all the stages on one input and appends the measurements.
+static void run_stages(const std::vector<point_type>& input_points,
+                       const std::vector<segment_type>& input_segments,
+                       int runs, std::vector<stage_series>* series) {
+  double n = static_cast<double>(input_points.size() +
+                                 3 * input_segments.size());
+  std::vector<sample> samples(series->size());
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    samples[i].n = n;
+    samples[i].ms = 0;
+    samples[i].bytes = 0;
+  }
+  std::string text;
+  {
+    std::ostringstream out;
+    out << input_points.size() << "\n";
+    for (std::size_t i = 0; i < input_points.size(); ++i) {
+      out << static_cast<long long>(x(input_points[i])) << " "
+          << static_cast<long long>(y(input_points[i])) << "\n";
+    }
+    out << input_segments.size() << "\n";
+    for (std::size_t i = 0; i < input_segments.size(); ++i) {
+      const segment_type& s = input_segments[i];
+      out << static_cast<long long>(x(low(s))) << " "
+          << static_cast<long long>(y(low(s))) << " "
+          << static_cast<long long>(x(high(s))) << " "
+          << static_cast<long long>(y(high(s))) << "\n";
+    }
+    text = out.str();
+  }
+  for (int run = 0; run < runs; ++run) {
+    std::vector<point_type> points;
+    std::vector<segment_type> segments;
+    {
+      stage_timer timer(&samples[0]);
+      std::istringstream in(text);
+      read_voronoi_input(in, &points, &segments);
+    }
+    coordinate_type xl = 0, yl = 0, xh = 1, yh = 1;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      xh = (std::max)(xh, x(points[i]));
+      yh = (std::max)(yh, y(points[i]));
+    }
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+      xh = (std::max)(xh, (std::max)(x(low(segments[i])),
+                                     x(high(segments[i]))));
+      yh = (std::max)(yh, (std::max)(y(low(segments[i])),
+                                     y(high(segments[i]))));
+    }
+    coordinate_type side = (std::max)(xh - xl, yh - yl);
+
+    VD vd;
+    {
+      stage_timer timer(&samples[1]);
+      construct_voronoi(points.begin(), points.end(),
+                        segments.begin(), segments.end(), &vd);
+    }
+    {
+      // Classification of the diagram vertices, as done by the winding
+      // number coloring of the visualizer.
+      stage_timer timer(&samples[2]);
+      voronoi_interior_classifier<coordinate_type> classifier(segments, 0.5);
+      std::size_t inside = 0;
+      for (VD::const_vertex_iterator it = vd.vertices().begin();
+           it != vd.vertices().end(); ++it) {
+        inside += classifier.locate(it->x(), it->y()) ==
+                  voronoi_interior_classifier<coordinate_type>::INSIDE;
+      }
+      (void)inside;
+    }
+    {
+      stage_timer timer(&samples[3]);
+      voronoi_raster_preview<coordinate_type> preview(
+          points, segments, xl, yl, xl + side, yl + side);
+      std::vector<voronoi_raster_preview<coordinate_type>::label_type> labels;
+      preview.label(512, 512, &labels);
+    }
+    {
+      // CPU side of the edge upload: quantization of the finite edges,
+      // with the step of the visualizer layers.
+      stage_timer timer(&samples[4]);
+      voronoi_quantized_layer<coordinate_type> layer(
+          side / (32 * 4096), xl, yl, xl + side, yl + side);
+      for (VD::const_edge_iterator it = vd.edges().begin();
+           it != vd.edges().end(); ++it) {
+        if (it->is_finite() && it->twin() > &(*it)) {
+          layer.begin_strip();
+          layer.add_vertex(it->vertex0()->x(), it->vertex0()->y());
+          layer.add_vertex(it->vertex1()->x(), it->vertex1()->y());
+        }
+      }
+    }
+    {
+      stage_timer timer(&samples[5]);
+      voronoi_tile_pyramid<coordinate_type> pyramid(xl, yl, side);
+      for (VD::const_edge_iterator it = vd.edges().begin();
+           it != vd.edges().end(); ++it) {
+        if (it->is_finite() && it->twin() > &(*it)) {
+          pyramid.begin_polyline(0);
+          pyramid.add_vertex(it->vertex0()->x(), it->vertex0()->y());
+          pyramid.add_vertex(it->vertex1()->x(), it->vertex1()->y());
+        }
+      }
+      voronoi_tile_pyramid<coordinate_type>::level level;
+      pyramid.bin(8, 0, &level);
+    }
+  }
+  for (std::size_t i = 0; i < samples.size(); ++i) {
+    (*series)[i].samples.push_back(samples[i]);
+  }
+}
+
+static std::vector<stage_series> make_series() {
+  const char* names[] = {"parse", "construct", "classify", "preview",
+                         "quantize", "tile bin"};
+  const complexity_model time_models[] = {LINEAR, LINEARITHMIC, LINEAR,
+                                          LINEAR, LINEAR, LINEARITHMIC};
+  std::vector<stage_series> series(6);
+  for (std::size_t i = 0; i < series.size(); ++i) {
+    series[i].name = names[i];
+    series[i].expected_time = time_models[i];
+    series[i].expected_memory = LINEAR;
+  }
+  return series;
+}
+
+int main(int argc, char* argv[]) {
+  int max_exponent = 6;
+  int runs = 3;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 < argc && std::strcmp(argv[i], "-m") == 0) {
+      max_exponent = (std::max)(3, std::atoi(argv[i + 1]));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "-r") == 0) {
+      runs = (std::max)(1, std::atoi(argv[i + 1]));
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-m max_exponent] [-r runs]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  const char* families[] = {"points", "triangles"};
+  int flagged = 0;
+  for (int family = 0; family < 2; ++family) {
+    std::vector<stage_series> series = make_series();
+    std::cout << families[family] << std::endl;
+    std::cout << std::left << std::setw(12) << "stage"
+              << std::right << std::setw(12) << "n"
+              << std::setw(12) << "ms"
+              << std::setw(12) << "ns/site"
+              << std::setw(12) << "peak MB" << std::endl;
+    for (int step = 6; step <= 2 * max_exponent; ++step) {
+      std::size_t n = static_cast<std::size_t>(
+          std::pow(10.0, step / 2.0) + 0.5);
+      std::mt19937 random(step);
+      std::vector<point_type> points;
+      std::vector<segment_type> segments;
+      if (family == 0) {
+        generate_points(n, &random, &points);
+      } else {
+        generate_triangles(n, &random, &segments);
+      }
+      // Large inputs take long enough to measure in one run.
+      run_stages(points, segments, n < 1000000 ? runs : 1, &series);
+      for (std::size_t i = 0; i < series.size(); ++i) {
+        const sample& s = series[i].samples.back();
+        std::cout << std::left << std::setw(12) << series[i].name
+                  << std::right << std::setw(12)
+                  << static_cast<std::size_t>(s.n)
+                  << std::setw(12) << std::fixed << std::setprecision(3)
+                  << s.ms
+                  << std::setw(12) << std::setprecision(1)
+                  << 1e6 * s.ms / s.n
+                  << std::setw(12) << std::setprecision(2)
+                  << s.bytes / (1 << 20) << std::endl;
+      }
+    }
+    std::cout << std::left << std::setw(12) << "stage"
+              << std::setw(10) << "expected"
+              << std::setw(10) << "time"
+              << std::right << std::setw(10) << "exponent"
+              << std::left << "  " << std::setw(10) << "memory"
+              << std::right << std::setw(10) << "exponent" << std::endl;
+    for (std::size_t i = 0; i < series.size(); ++i) {
+      fit_result time_fit = fit(series[i].samples, false);
+      fit_result memory_fit = fit(series[i].samples, true);
+      bool flag = exceeds(time_fit, series[i].expected_time) ||
+                  exceeds(memory_fit, series[i].expected_memory);
+      flagged += flag;
+      std::cout << std::left << std::setw(12) << series[i].name
+                << std::setw(10) << model_name(series[i].expected_time)
+                << std::setw(10) << model_name(time_fit.model)
+                << std::right << std::setw(10) << std::setprecision(2)
+                << time_fit.exponent
+                << std::left << "  " << std::setw(10)
+                << model_name(memory_fit.model)
+                << std::right << std::setw(10) << memory_fit.exponent
+                << (flag ? "  exceeds expected growth" : "") << std::endl;
+    }
+    std::cout << std::endl;
+  }
+  return flagged ? 2 : 0;
+}
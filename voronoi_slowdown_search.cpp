@@ -0,0 +1,465 @@
+// Boost.Polygon library voronoi_slowdown_search.cpp file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+// Searches for inputs that take much longer to construct than their size
+// suggests. Starting from the given files, the search repeatedly picks one
+// of the slowest inputs found so far and mutates it: coordinates are
+// perturbed by a unit, points are inserted on lines through existing sites
+// and on circles through lattice points, and segments are added that pass
+// within a unit of existing ones. Such configurations push the builder
+// into its high precision predicates.
+//
+// The slowdown of an input is its construction time per site relative to
+// the file it was derived from. The slowest inputs are kept and written to
+// the output directory as slow_NNN.txt in the input_data format.
+//
+// Usage: voronoi_slowdown_search [-i iterations] [-k keep] [-n max_sites]
+//                                [-s seed] [-o directory] file...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/polygon/polygon.hpp>
+#include <boost/polygon/voronoi.hpp>
+using namespace boost::polygon;
+
+#include "voronoi_input.hpp"
+
+typedef double coordinate_type;
+typedef point_data<coordinate_type> point_type;
+typedef segment_data<coordinate_type> segment_type;
+typedef voronoi_diagram<coordinate_type> VD;
+
+struct search_input {
+  std::vector<point_type> points;
+  std::vector<segment_type> segments;
+  // File the input was derived from and its time per site.
+  std::string origin;
+  double origin_us_per_site;
+  // Mutations applied to the origin, in order.
+  std::string history;
+  double us_per_site;
+
+  std::size_t num_sites() const {
+    return points.size() + 3 * segments.size();
+  }
+
+  double slowdown() const {
+    return origin_us_per_site > 0 ? us_per_site / origin_us_per_site : 0;
+  }
+};
+
+// Best construction time per site in microseconds. Small inputs are built
+// repeatedly until the batch takes a few milliseconds, so that the timer
+// resolution does not matter.
+static double measure(const search_input& input) {
+  const double min_batch_ms = 5.0;
+  double best_ms = 0;
+  for (int batch = 0; batch < 3; ++batch) {
+    std::size_t builds = 0;
+    double elapsed_ms = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    do {
+      VD vd;
+      construct_voronoi(input.points.begin(), input.points.end(),
+                        input.segments.begin(), input.segments.end(), &vd);
+      ++builds;
+      elapsed_ms = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start).count();
+    } while (elapsed_ms < min_batch_ms);
+    double ms = elapsed_ms / builds;
+    if (batch == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  std::size_t num_sites = input.num_sites();
+  return num_sites ? 1000.0 * best_ms / num_sites : 0.0;
+}
+
+// Exact orientation of c relative to the line ab: 1 left, -1 right,
+// 0 collinear. Input coordinates are integers well within 32 bits.
+static int orientation(const point_type& a, const point_type& b,
+                       const point_type& c) {
+  boost::int64_t dx1 = static_cast<boost::int64_t>(x(b) - x(a));
+  boost::int64_t dy1 = static_cast<boost::int64_t>(y(b) - y(a));
+  boost::int64_t dx2 = static_cast<boost::int64_t>(x(c) - x(a));
+  boost::int64_t dy2 = static_cast<boost::int64_t>(y(c) - y(a));
+  boost::int64_t cross = dx1 * dy2 - dy1 * dx2;
+  return cross > 0 ? 1 : (cross < 0 ? -1 : 0);
+}
+
+// Whether c lies on the segment ab, endpoints excluded.
+static bool in_interior(const point_type& a, const point_type& b,
+                        const point_type& c) {
+  if (orientation(a, b, c) != 0 || c == a || c == b) {
+    return false;
+  }
+  return (std::min)(x(a), x(b)) <= x(c) && x(c) <= (std::max)(x(a), x(b)) &&
+         (std::min)(y(a), y(b)) <= y(c) && y(c) <= (std::max)(y(a), y(b));
+}
+
+// Segments may only touch at common endpoints.
+static bool segments_conflict(const segment_type& s1,
+                              const segment_type& s2) {
+  point_type a = low(s1), b = high(s1), c = low(s2), d = high(s2);
+  if (in_interior(a, b, c) || in_interior(a, b, d) ||
+      in_interior(c, d, a) || in_interior(c, d, b)) {
+    return true;
+  }
+  int o1 = orientation(a, b, c);
+  int o2 = orientation(a, b, d);
+  int o3 = orientation(c, d, a);
+  int o4 = orientation(c, d, b);
+  if (o1 == 0 && o2 == 0) {
+    // Collinear segments that overlap partially have an endpoint in the
+    // interior of the other one, caught above; the only overlap left is
+    // the same segment twice. Disjoint or end to end ones are fine.
+    return (a == c && b == d) || (a == d && b == c);
+  }
+  return o1 * o2 < 0 && o3 * o4 < 0;
+}
+
+// Checks the constraints of the builder on the changed site: segments
+// must not be degenerate, intersect other segments or pass through points.
+static bool valid_after_change(const search_input& input,
+                               std::size_t changed_point,
+                               std::size_t changed_segment) {
+  if (changed_point < input.points.size()) {
+    const point_type& p = input.points[changed_point];
+    for (std::size_t i = 0; i < input.segments.size(); ++i) {
+      if (in_interior(low(input.segments[i]), high(input.segments[i]), p)) {
+        return false;
+      }
+    }
+  }
+  if (changed_segment < input.segments.size()) {
+    const segment_type& s = input.segments[changed_segment];
+    if (low(s) == high(s)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < input.segments.size(); ++i) {
+      if (i != changed_segment && segments_conflict(s, input.segments[i])) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < input.points.size(); ++i) {
+      if (in_interior(low(s), high(s), input.points[i])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static boost::int64_t gcd(boost::int64_t a, boost::int64_t b) {
+  a = a < 0 ? -a : a;
+  b = b < 0 ? -b : b;
+  while (b) {
+    boost::int64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+class input_mutator {
+ public:
+  explicit input_mutator(unsigned seed) : random_(seed) {}
+
+  // Applies a random mutation, returns its name or an empty string if the
+  // mutation produced an invalid input.
+  std::string mutate(search_input* input) {
+    switch (uniform(0, 4)) {
+      case 0:
+        return perturb(input) ? "perturb" : "";
+      case 1:
+        return insert_collinear(input) ? "collinear" : "";
+      case 2:
+        return insert_cocircular(input) ? "cocircular" : "";
+      case 3:
+        return insert_near_touching(input) ? "touching" : "";
+      default:
+        return insert_near_parallel(input) ? "parallel" : "";
+    }
+  }
+
+  int uniform(int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(random_);
+  }
+
+  // Bounds derived from coordinate differences may not fit an int.
+  boost::int64_t uniform(boost::int64_t lo, boost::int64_t hi) {
+    return std::uniform_int_distribution<boost::int64_t>(lo, hi)(random_);
+  }
+
+ private:
+  static const std::size_t NONE = ~static_cast<std::size_t>(0);
+
+  // Random point of the input: a point site or a segment endpoint.
+  point_type any_site_point(const search_input& input) {
+    std::size_t count = input.points.size() + 2 * input.segments.size();
+    std::size_t index = uniform(0, static_cast<int>(count) - 1);
+    if (index < input.points.size()) {
+      return input.points[index];
+    }
+    index -= input.points.size();
+    const segment_type& s = input.segments[index / 2];
+    return (index & 1) ? high(s) : low(s);
+  }
+
+  // Moves a point or one segment endpoint by a unit in each direction.
+  bool perturb(search_input* input) {
+    point_type delta(uniform(-1, 1), uniform(-1, 1));
+    std::size_t count = input->points.size() + 2 * input->segments.size();
+    std::size_t index = uniform(0, static_cast<int>(count) - 1);
+    if (index < input->points.size()) {
+      point_type& p = input->points[index];
+      p = point_type(x(p) + x(delta), y(p) + y(delta));
+      return valid_after_change(*input, index, NONE);
+    }
+    index -= input->points.size();
+    segment_type& s = input->segments[index / 2];
+    point_type p = (index & 1) ? high(s) : low(s);
+    p = point_type(x(p) + x(delta), y(p) + y(delta));
+    s = (index & 1) ? segment_type(low(s), p) : segment_type(p, high(s));
+    return valid_after_change(*input, NONE, index / 2);
+  }
+
+  // Adds lattice points on the line through two site points, inside and
+  // beyond them.
+  bool insert_collinear(search_input* input) {
+    point_type a = any_site_point(*input);
+    point_type b = any_site_point(*input);
+    boost::int64_t dx = static_cast<boost::int64_t>(x(b) - x(a));
+    boost::int64_t dy = static_cast<boost::int64_t>(y(b) - y(a));
+    boost::int64_t g = gcd(dx, dy);
+    if (g == 0) {
+      return false;
+    }
+    dx /= g;
+    dy /= g;
+    int count = uniform(1, 8);
+    for (int i = 0; i < count; ++i) {
+      boost::int64_t t = uniform(-g, 2 * g);
+      input->points.push_back(point_type(x(a) + t * dx, y(a) + t * dy));
+      if (!valid_after_change(*input, input->points.size() - 1, NONE)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Adds lattice points on a circle around a site point, the radii are
+  // hypotenuses with several integer decompositions.
+  bool insert_cocircular(search_input* input) {
+    // Pairs (a, b) with a^2 + b^2 = 65^2.
+    static const int legs[][2] = {{0, 65}, {16, 63}, {25, 60}, {33, 56},
+                                  {39, 52}};
+    int scale = uniform(1, 4);
+    point_type center = any_site_point(*input);
+    int count = uniform(3, 8);
+    for (int i = 0; i < count; ++i) {
+      const int* leg = legs[uniform(0, 4)];
+      int a = leg[0] * scale * (uniform(0, 1) ? 1 : -1);
+      int b = leg[1] * scale * (uniform(0, 1) ? 1 : -1);
+      if (uniform(0, 1)) {
+        std::swap(a, b);
+      }
+      input->points.push_back(point_type(x(center) + a, y(center) + b));
+      if (!valid_after_change(*input, input->points.size() - 1, NONE)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Adds a segment that ends a unit away from the interior of an existing
+  // segment, pointing away from it.
+  bool insert_near_touching(search_input* input) {
+    if (input->segments.empty()) {
+      return false;
+    }
+    const segment_type s =
+        input->segments[uniform(0, static_cast<int>(input->segments.size()) -
+                                       1)];
+    boost::int64_t dx = static_cast<boost::int64_t>(x(high(s)) - x(low(s)));
+    boost::int64_t dy = static_cast<boost::int64_t>(y(high(s)) - y(low(s)));
+    boost::int64_t g = gcd(dx, dy);
+    if (g < 2) {
+      return false;
+    }
+    // Lattice point of the segment interior, moved off the line by one
+    // unit of the normal direction.
+    boost::int64_t t = uniform(boost::int64_t(1), g - 1);
+    int side = uniform(0, 1) ? 1 : -1;
+    boost::int64_t nx = -dy / g * side;
+    boost::int64_t ny = dx / g * side;
+    point_type near_point(x(low(s)) + t * dx / g + (nx > 0) - (nx < 0),
+                          y(low(s)) + t * dy / g + (ny > 0) - (ny < 0));
+    int length = uniform(1, 100);
+    point_type far_point(x(near_point) + nx * length,
+                         y(near_point) + ny * length);
+    input->segments.push_back(segment_type(near_point, far_point));
+    return valid_after_change(*input, NONE, input->segments.size() - 1);
+  }
+
+  // Adds a copy of an existing segment shifted by a unit, with one
+  // endpoint moved by another unit so that it is almost parallel.
+  bool insert_near_parallel(search_input* input) {
+    if (input->segments.empty()) {
+      return false;
+    }
+    const segment_type s =
+        input->segments[uniform(0, static_cast<int>(input->segments.size()) -
+                                       1)];
+    int sx = uniform(-1, 1);
+    int sy = uniform(-1, 1);
+    point_type a(x(low(s)) + sx, y(low(s)) + sy);
+    point_type b(x(high(s)) + sx + uniform(-1, 1),
+                 y(high(s)) + sy + uniform(-1, 1));
+    input->segments.push_back(segment_type(a, b));
+    return valid_after_change(*input, NONE, input->segments.size() - 1);
+  }
+
+  std::mt19937 random_;
+};
+
+static bool slower(const search_input& a, const search_input& b) {
+  return a.slowdown() > b.slowdown();
+}
+
+static void write_input(const search_input& input, const std::string& path) {
+  std::ofstream out(path.c_str());
+  out << input.points.size() << "\n";
+  for (std::size_t i = 0; i < input.points.size(); ++i) {
+    out << x(input.points[i]) << " " << y(input.points[i]) << "\n";
+  }
+  out << input.segments.size() << "\n";
+  for (std::size_t i = 0; i < input.segments.size(); ++i) {
+    const segment_type& s = input.segments[i];
+    out << x(low(s)) << " " << y(low(s)) << " "
+        << x(high(s)) << " " << y(high(s)) << "\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 1000;
+  std::size_t keep = 16;
+  std::size_t max_sites = 2000;
+  unsigned seed = 1;
+  std::string output_directory = ".";
+  int first_file = 1;
+  while (first_file + 1 < argc && argv[first_file][0] == '-') {
+    const char* option = argv[first_file];
+    const char* value = argv[first_file + 1];
+    if (std::strcmp(option, "-i") == 0) {
+      iterations = std::max(1, std::atoi(value));
+    } else if (std::strcmp(option, "-k") == 0) {
+      keep = std::max(1, std::atoi(value));
+    } else if (std::strcmp(option, "-n") == 0) {
+      max_sites = std::max(1, std::atoi(value));
+    } else if (std::strcmp(option, "-s") == 0) {
+      seed = static_cast<unsigned>(std::atoi(value));
+    } else if (std::strcmp(option, "-o") == 0) {
+      output_directory = value;
+    } else {
+      break;
+    }
+    first_file += 2;
+  }
+  if (first_file >= argc) {
+    std::cerr << "Usage: " << argv[0] << " [-i iterations] [-k keep]"
+              << " [-n max_sites] [-s seed] [-o directory] file..."
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<search_input> corpus;
+  for (int i = first_file; i < argc; ++i) {
+    std::ifstream in(argv[i]);
+    search_input input;
+    if (!in || !read_voronoi_input(in, &input.points, &input.segments)) {
+      std::cerr << "Unable to read " << argv[i] << std::endl;
+      continue;
+    }
+    if (input.num_sites() == 0) {
+      continue;
+    }
+    input.origin = argv[i];
+    input.us_per_site = measure(input);
+    input.origin_us_per_site = input.us_per_site;
+    corpus.push_back(input);
+  }
+  if (corpus.empty()) {
+    return 1;
+  }
+
+  // The seeds stay in the pool until slower inputs push them out.
+  std::sort(corpus.begin(), corpus.end(), slower);
+  input_mutator mutator(seed);
+  int accepted = 0;
+  for (int i = 0; i < iterations; ++i) {
+    // Tournament of two: prefer mutating the slower of two random inputs.
+    std::size_t a = mutator.uniform(0, static_cast<int>(corpus.size()) - 1);
+    std::size_t b = mutator.uniform(0, static_cast<int>(corpus.size()) - 1);
+    search_input candidate = corpus[(std::min)(a, b)];
+    std::string mutation = mutator.mutate(&candidate);
+    if (mutation.empty() || candidate.num_sites() > max_sites) {
+      continue;
+    }
+    candidate.history += candidate.history.empty() ? mutation :
+                                                     "," + mutation;
+    candidate.us_per_site = measure(candidate);
+    if (corpus.size() < keep) {
+      corpus.push_back(candidate);
+    } else if (slower(candidate, corpus.back())) {
+      corpus.back() = candidate;
+    } else {
+      continue;
+    }
+    std::stable_sort(corpus.begin(), corpus.end(), slower);
+    ++accepted;
+  }
+
+  if (corpus.size() > keep) {
+    corpus.resize(keep);
+  }
+  std::cout << "Accepted " << accepted << " of " << iterations
+            << " mutations." << std::endl;
+  std::cout << std::left << std::setw(16) << "output"
+            << std::setw(40) << "origin"
+            << std::right << std::setw(10) << "sites"
+            << std::setw(12) << "us/site"
+            << std::setw(12) << "slowdown" << "  mutations" << std::endl;
+  for (std::size_t i = 0; i < corpus.size(); ++i) {
+    std::ostringstream name;
+    name << "slow_" << std::setw(3) << std::setfill('0') << i + 1 << ".txt";
+    write_input(corpus[i], output_directory + "/" + name.str());
+    std::cout << std::left << std::setw(16) << name.str()
+              << std::setw(40) << corpus[i].origin
+              << std::right << std::setw(10) << corpus[i].num_sites()
+              << std::setw(12) << std::fixed << std::setprecision(3)
+              << corpus[i].us_per_site
+              << std::setw(12) << std::setprecision(2)
+              << corpus[i].slowdown() << "  " << corpus[i].history
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,341 @@
+// Boost.Polygon library voronoi_thumbnail_queue.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_THUMBNAIL_QUEUE
+#define BOOST_POLYGON_VORONOI_THUMBNAIL_QUEUE
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#include <unistd.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/polygon/point_data.hpp>
+#include <boost/polygon/segment_data.hpp>
+
+#include "voronoi_input.hpp"
+#include "voronoi_raster_preview.hpp"
+
+namespace boost {
+namespace polygon {
+// 64 bit FNV-1a hash of the file contents, the key of the thumbnail cache.
+inline boost::uint64_t voronoi_content_hash(const std::string& contents) {
+  boost::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < contents.size(); ++i) {
+    hash = (hash ^ static_cast<unsigned char>(contents[i])) *
+        1099511628211ULL;
+  }
+  return hash;
+}
+
+// Renders a side x side grayscale thumbnail of the input with the raster
+// preview: white cells, gray cell boundaries and black sites, the input
+// bounding square fit to the image. Row 0 of the output is the top row.
+template <typename Point, typename Segment>
+void voronoi_render_thumbnail(const std::vector<Point>& points,
+                              const std::vector<Segment>& segments,
+                              int side, std::vector<unsigned char>* pixels) {
+  typedef typename point_traits<Point>::coordinate_type coordinate_type;
+  typedef voronoi_raster_preview<coordinate_type> preview_type;
+  pixels->assign(static_cast<std::size_t>(side) * side, 255);
+  std::vector<Point> corners(points);
+  for (std::size_t i = 0; i < segments.size(); ++i) {
+    corners.push_back(low(segments[i]));
+    corners.push_back(high(segments[i]));
+  }
+  if (corners.empty()) {
+    return;
+  }
+  coordinate_type x0 = x(corners[0]), y0 = y(corners[0]);
+  coordinate_type x1 = x0, y1 = y0;
+  for (std::size_t i = 1; i < corners.size(); ++i) {
+    x0 = (std::min)(x0, x(corners[i]));
+    y0 = (std::min)(y0, y(corners[i]));
+    x1 = (std::max)(x1, x(corners[i]));
+    y1 = (std::max)(y1, y(corners[i]));
+  }
+  // Square area with a margin, so that the sites on the bounding box are
+  // not drawn on the border.
+  coordinate_type half = (std::max)((std::max)(x1 - x0, y1 - y0),
+                                    coordinate_type(1)) * 0.55;
+  coordinate_type cx = (x0 + x1) / 2, cy = (y0 + y1) / 2;
+  coordinate_type xl = cx - half, yl = cy - half;
+  preview_type preview(points, segments, xl, yl, cx + half, cy + half,
+                       static_cast<std::size_t>(side) * side);
+  std::vector<typename preview_type::label_type> labels;
+  // The callers render several thumbnails concurrently already.
+  preview.label(side, side, false, &labels);
+  for (int j = 0; j < side; ++j) {
+    for (int i = 0; i < side; ++i) {
+      std::size_t index = static_cast<std::size_t>(j) * side + i;
+      bool boundary =
+          (i + 1 < side && labels[index] != labels[index + 1]) ||
+          (j + 1 < side && labels[index] != labels[index + side]);
+      if (boundary) {
+        (*pixels)[static_cast<std::size_t>(side - 1 - j) * side + i] = 160;
+      }
+    }
+  }
+  coordinate_type scale = side / (2 * half);
+  for (std::size_t i = 0; i < corners.size(); ++i) {
+    int px = static_cast<int>((x(corners[i]) - xl) * scale);
+    int py = static_cast<int>((y(corners[i]) - yl) * scale);
+    if (px >= 0 && px < side && py >= 0 && py < side) {
+      (*pixels)[static_cast<std::size_t>(side - 1 - py) * side + px] = 0;
+    }
+  }
+}
+
+// Generates the thumbnails of the input files on low priority background
+// threads. The owner requests the files currently on screen; requests that
+// have not been started when the next request arrives are dropped, so
+// scrolling through a large directory only renders what was shown.
+// Finished thumbnails are collected by polling take_result. Files that
+// can not be read, e.g. while they are being written, are tried again
+// after the other pending files, up to MAX_ATTEMPTS times; then they may
+// be requested anew.
+//
+// Thumbnails are cached in cache_directory under the hash of the file
+// contents, so renamed or copied files hit the cache and edited files
+// do not. Cache files are written to a temporary name and renamed, several
+// processes may share the directory.
+class voronoi_thumbnail_queue {
+ public:
+  typedef std::vector<unsigned char> pixel_container_type;
+
+  // Args:
+  //   cache_directory: existing directory of the cache, or empty to
+  //     disable the cache.
+  //   side: side of the thumbnails in pixels.
+  //   num_threads: number of the worker threads.
+  voronoi_thumbnail_queue(const std::string& cache_directory, int side,
+                          std::size_t num_threads) :
+      cache_directory_(cache_directory),
+      side_(side),
+      num_threads_((std::max)(num_threads, std::size_t(1))),
+      stop_(false) {}
+
+  ~voronoi_thumbnail_queue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      pending_.clear();
+    }
+    condition_.notify_all();
+    for (std::size_t i = 0; i < threads_.size(); ++i) {
+      threads_[i].join();
+    }
+  }
+
+  int side() const {
+    return side_;
+  }
+
+  // Replaces the pending requests with the given files, in the order of
+  // priority. Files requested before are skipped unless forget was called
+  // in between.
+  void request(const std::vector<std::string>& paths) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t i = 0; i < pending_.size(); ++i) {
+        requested_.erase(pending_[i]);
+      }
+      pending_.clear();
+      for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (requested_.insert(paths[i]).second) {
+          pending_.push_back(paths[i]);
+        }
+      }
+      if (pending_.empty()) {
+        return;
+      }
+      while (threads_.size() < num_threads_) {
+        threads_.push_back(
+            std::thread(&voronoi_thumbnail_queue::run, this));
+      }
+    }
+    condition_.notify_all();
+  }
+
+  // Drops the pending requests and the finished results, and lets the
+  // files be requested again, e.g. after the directory was reloaded.
+  void forget() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    requested_.clear();
+    failures_.clear();
+    results_.clear();
+  }
+
+  // Moves out a finished thumbnail. Returns false if there is none. Files
+  // that could not be read give no result.
+  bool take_result(std::string* path, pixel_container_type* pixels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (results_.empty()) {
+      return false;
+    }
+    path->swap(results_.front().first);
+    pixels->swap(results_.front().second);
+    results_.pop_front();
+    return true;
+  }
+
+ private:
+  static const int MAX_ATTEMPTS = 3;
+
+  typedef point_data<double> point_type;
+  typedef segment_data<double> segment_type;
+
+  void run() {
+#if defined(__linux__)
+    // Only runs when the cores are otherwise idle; the threads of the
+    // raster preview inherit the policy.
+    sched_param param = sched_param();
+    sched_setscheduler(0, SCHED_IDLE, &param);
+#endif
+    for (;;) {
+      std::string path;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() {
+          return stop_ || !pending_.empty();
+        });
+        if (stop_) {
+          return;
+        }
+        path.swap(pending_.front());
+        pending_.pop_front();
+      }
+      pixel_container_type pixels;
+      bool done = make_thumbnail(path, &pixels);
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Files forgotten meanwhile are dropped.
+      if (!requested_.count(path)) {
+        continue;
+      }
+      if (!done) {
+        if (++failures_[path] < MAX_ATTEMPTS) {
+          pending_.push_back(path);
+        } else {
+          failures_.erase(path);
+          requested_.erase(path);
+        }
+        continue;
+      }
+      failures_.erase(path);
+      results_.push_back(std::make_pair(path, pixel_container_type()));
+      results_.back().second.swap(pixels);
+    }
+  }
+
+  bool make_thumbnail(const std::string& path, pixel_container_type* pixels) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    std::string cache_path = cache_file(voronoi_content_hash(contents));
+    if (!cache_path.empty() && load(cache_path, pixels)) {
+      return true;
+    }
+    std::istringstream input(contents);
+    std::vector<point_type> points;
+    std::vector<segment_type> segments;
+    if (!read_voronoi_input(input, &points, &segments)) {
+      return false;
+    }
+    voronoi_render_thumbnail(points, segments, side_, pixels);
+    if (!cache_path.empty()) {
+      store(cache_path, *pixels);
+    }
+    return true;
+  }
+
+  std::string cache_file(boost::uint64_t hash) const {
+    if (cache_directory_.empty()) {
+      return std::string();
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%016llx-%d.thumb",
+                  static_cast<unsigned long long>(hash), side_);
+    return cache_directory_ + name;
+  }
+
+  bool load(const std::string& cache_path,
+            pixel_container_type* pixels) const {
+    std::ifstream in(cache_path.c_str(), std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    pixels->resize(static_cast<std::size_t>(side_) * side_);
+    in.read(reinterpret_cast<char*>(pixels->data()), pixels->size());
+    // Truncated files are rendered again.
+    return in.gcount() == static_cast<std::streamsize>(pixels->size());
+  }
+
+  void store(const std::string& cache_path,
+             const pixel_container_type& pixels) const {
+    // Unique across the processes sharing the cache and their threads.
+    std::random_device random;
+    std::ostringstream temporary_path;
+    temporary_path << cache_path << "." << getpid() << "." << std::hex
+                   << random() << random() << ".tmp";
+    {
+      std::ofstream out(temporary_path.str().c_str(), std::ios::binary);
+      out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+      if (!out) {
+        out.close();
+        std::remove(temporary_path.str().c_str());
+        return;
+      }
+    }
+    if (std::rename(temporary_path.str().c_str(), cache_path.c_str()) != 0) {
+      std::remove(temporary_path.str().c_str());
+    }
+  }
+
+  std::string cache_directory_;
+  int side_;
+  std::size_t num_threads_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::string> pending_;
+  // Files pending, in flight or done since the last forget.
+  std::set<std::string> requested_;
+  // Failed attempts of the files to be tried again.
+  std::map<std::string, int> failures_;
+  std::deque<std::pair<std::string, pixel_container_type> > results_;
+  std::vector<std::thread> threads_;
+  bool stop_;
+
+  // Disallow copy constructor and operator=
+  voronoi_thumbnail_queue(const voronoi_thumbnail_queue&);
+  void operator=(const voronoi_thumbnail_queue&);
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_THUMBNAIL_QUEUE
@@ -0,0 +1,578 @@
+// Boost.Polygon library voronoi_tile_pack.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_TILE_PACK
+#define BOOST_POLYGON_VORONOI_TILE_PACK
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/cstdint.hpp>
+
+#include "voronoi_parallel_utils.hpp"
+#include "voronoi_tile_pyramid.hpp"
+#include "voronoi_visual_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Render geometry of a tile pyramid packed into a single file, so that a
+// viewer maps the file and pages in the tiles it shows instead of holding
+// the whole diagram. Every tile stores a fixed number of layers (e.g. the
+// sites, the segments and the edges) as strips of 16 bit vertices, in
+// steps of 1 / extent of the tile side from the lower left tile corner.
+// The polylines are clipped to the tile widened by a border; strips that
+// span less than min_strip_extent steps are dropped and one point site is
+// kept per min_strip_extent cell, so the coarse levels only keep the
+// geometry visible at their scale.
+//
+// File layout (native endianness):
+//   char[4] magic "VTPK", uint32 version
+//   double xl, yl, side: area covered by the pyramid, see
+//     voronoi_tile_pyramid
+//   int32 max_zoom, extent, num_layers, reserved
+//   uint64 index_offset, num_tiles
+//   tile blobs, 8 byte aligned
+//   tile_entry index[num_tiles], sorted by (z, y, x)
+// Tile blob, for every layer:
+//   uint32 num_vertices, num_strips
+//   int16 coords[2 * num_vertices]
+//   uint32 strip_first[num_strips]
+struct voronoi_tile_pack_format {
+  static const boost::uint32_t VERSION = 1;
+
+  struct header {
+    char magic[4];
+    boost::uint32_t version;
+    double xl;
+    double yl;
+    double side;
+    boost::int32_t max_zoom;
+    boost::int32_t extent;
+    boost::int32_t num_layers;
+    boost::int32_t reserved;
+    boost::uint64_t index_offset;
+    boost::uint64_t num_tiles;
+  };
+
+  struct tile_entry {
+    boost::int32_t z;
+    boost::int32_t x;
+    boost::int32_t y;
+    boost::uint32_t size;
+    boost::uint64_t offset;
+  };
+
+  static bool key_less(const tile_entry& lhs, const tile_entry& rhs) {
+    if (lhs.z != rhs.z) {
+      return lhs.z < rhs.z;
+    }
+    if (lhs.y != rhs.y) {
+      return lhs.y < rhs.y;
+    }
+    return lhs.x < rhs.x;
+  }
+};
+
+// Writes a tile pack from a voronoi_tile_pyramid, level by level. The
+// tiles of a level are encoded in parallel.
+template <typename CT>
+class voronoi_tile_pack_writer {
+ public:
+  typedef voronoi_tile_pyramid<CT> pyramid_type;
+  typedef voronoi_tile_pack_format::tile_entry tile_entry;
+
+  // Args:
+  //   extent: quantization steps per tile side.
+  //   border: width of the border kept around the tiles, in steps.
+  //   min_strip_extent: strips smaller than that are dropped, in steps.
+  //   num_layers: number of the layers of every tile.
+  voronoi_tile_pack_writer(int extent, int border, int min_strip_extent,
+                           int num_layers) :
+      extent_(extent), border_(border), min_strip_extent_(min_strip_extent),
+      num_layers_(num_layers), max_zoom_(-1), offset_(0) {}
+
+  bool open(const std::string& path, const pyramid_type& pyramid) {
+    out_.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    xl_ = pyramid_xl(pyramid);
+    yl_ = pyramid_yl(pyramid);
+    side_ = pyramid.tile_side(0);
+    index_.clear();
+    max_zoom_ = -1;
+    write_header(0);
+    offset_ = sizeof(voronoi_tile_pack_format::header);
+    return static_cast<bool>(out_);
+  }
+
+  // Adds the tiles of zoom level z, which has to be above the levels
+  // added so far. layer_of(style) returns the layer of the items of the
+  // style or -1 to skip them.
+  template <typename LayerOf>
+  bool add_level(const pyramid_type& pyramid, int z, LayerOf layer_of) {
+    typename pyramid_type::level level;
+    pyramid.bin(z, CT(border_) * pyramid.tile_side(z) / extent_, &level);
+    // Encode a batch of tiles at a time to bound the memory.
+    const std::size_t batch = 4096;
+    std::vector<std::string> blobs;
+    for (std::size_t first = 0; first < level.tiles.size(); first += batch) {
+      std::size_t last = (std::min)(first + batch, level.tiles.size());
+      blobs.assign(last - first, std::string());
+      voronoi_parallel_for(last - first, 16,
+                           [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+          encode_tile(pyramid, level, first + i, layer_of, &blobs[i]);
+        }
+      });
+      for (std::size_t i = 0; i < blobs.size(); ++i) {
+        if (blobs[i].empty()) {
+          continue;
+        }
+        const typename pyramid_type::tile_key& key = level.tiles[first + i];
+        tile_entry entry = {key.z, key.x, key.y,
+                            static_cast<boost::uint32_t>(blobs[i].size()),
+                            offset_};
+        index_.push_back(entry);
+        blobs[i].resize((blobs[i].size() + 7) & ~std::size_t(7), '\0');
+        out_.write(blobs[i].data(), blobs[i].size());
+        offset_ += blobs[i].size();
+      }
+    }
+    max_zoom_ = z;
+    return static_cast<bool>(out_);
+  }
+
+  // Writes the index and completes the header.
+  bool close() {
+    out_.write(reinterpret_cast<const char*>(index_.data()),
+               index_.size() * sizeof(tile_entry));
+    out_.seekp(0);
+    write_header(offset_);
+    out_.close();
+    return !out_.fail();
+  }
+
+  std::size_t num_tiles() const {
+    return index_.size();
+  }
+
+  boost::uint64_t num_bytes() const {
+    return offset_ + index_.size() * sizeof(tile_entry);
+  }
+
+ private:
+  // The pyramid does not expose its origin, the bounds of the top level
+  // tile have it.
+  static CT pyramid_xl(const pyramid_type& pyramid) {
+    typename pyramid_type::tile_key key = {0, 0, 0};
+    CT xl, yl, xh, yh;
+    pyramid.tile_bounds(key, &xl, &yl, &xh, &yh);
+    return xl;
+  }
+
+  static CT pyramid_yl(const pyramid_type& pyramid) {
+    typename pyramid_type::tile_key key = {0, 0, 0};
+    CT xl, yl, xh, yh;
+    pyramid.tile_bounds(key, &xl, &yl, &xh, &yh);
+    return yl;
+  }
+
+  void write_header(boost::uint64_t index_offset) {
+    voronoi_tile_pack_format::header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "VTPK", 4);
+    header.version = voronoi_tile_pack_format::VERSION;
+    header.xl = xl_;
+    header.yl = yl_;
+    header.side = side_;
+    header.max_zoom = max_zoom_;
+    header.extent = extent_;
+    header.num_layers = num_layers_;
+    header.index_offset = index_offset;
+    header.num_tiles = index_.size();
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  struct layer_data {
+    std::vector<boost::int16_t> coords;
+    std::vector<boost::uint32_t> strips;
+    // Points as (cell << 32) | (u << 16) | v, one point is kept per cell
+    // of min_strip_extent steps.
+    std::vector<boost::uint64_t> points;
+  };
+
+  template <typename LayerOf>
+  void encode_tile(const pyramid_type& pyramid,
+                   const typename pyramid_type::level& level,
+                   std::size_t tile, LayerOf layer_of,
+                   std::string* blob) const {
+    CT txl, tyl, txh, tyh;
+    pyramid.tile_bounds(level.tiles[tile], &txl, &tyl, &txh, &tyh);
+    const CT step = (txh - txl) / extent_;
+    const CT lo = -CT(border_);
+    const CT hi = CT(extent_ + border_);
+    std::vector<layer_data> layers(num_layers_);
+    bool empty = true;
+    for (std::size_t j = level.item_start[tile];
+         j < level.item_start[tile + 1]; ++j) {
+      std::size_t item = level.items[j];
+      int layer = layer_of(pyramid.item_style(item));
+      if (layer < 0 || layer >= num_layers_) {
+        continue;
+      }
+      const CT* c = pyramid.item_coords(item);
+      std::size_t size = pyramid.item_size(item);
+      if (size == 1) {
+        // Points are kept by the tile containing them only.
+        CT u = std::floor((c[0] - txl) / step);
+        CT v = std::floor((c[1] - tyl) / step);
+        if (u >= 0 && u < extent_ && v >= 0 && v < extent_) {
+          boost::uint64_t cu = static_cast<boost::uint64_t>(u) /
+                               min_strip_extent_;
+          boost::uint64_t cv = static_cast<boost::uint64_t>(v) /
+                               min_strip_extent_;
+          layers[layer].points.push_back(
+              (((cu << 16) | cv) << 32) |
+              (static_cast<boost::uint64_t>(u) << 16) |
+              static_cast<boost::uint64_t>(v));
+          empty = false;
+        }
+        continue;
+      }
+      layer_data& data = layers[layer];
+      std::size_t strip_start = data.coords.size();
+      bool open = false;
+      for (std::size_t k = 0; k + 1 < size; ++k) {
+        CT u0 = (c[2 * k] - txl) / step, v0 = (c[2 * k + 1] - tyl) / step;
+        CT u1 = (c[2 * k + 2] - txl) / step, v1 = (c[2 * k + 3] - tyl) / step;
+        CT t0 = 0, t1 = 1;
+        if (!voronoi_visual_utils<CT>::clip(u0, v0, u1, v1, lo, lo, hi, hi,
+                                            &t0, &t1)) {
+          close_strip(strip_start, &data);
+          strip_start = data.coords.size();
+          open = false;
+          continue;
+        }
+        boost::int16_t a[2] = {round(u0 + t0 * (u1 - u0)),
+                               round(v0 + t0 * (v1 - v0))};
+        boost::int16_t b[2] = {round(u0 + t1 * (u1 - u0)),
+                               round(v0 + t1 * (v1 - v0))};
+        if (!open || data.coords[data.coords.size() - 2] != a[0] ||
+            data.coords.back() != a[1]) {
+          close_strip(strip_start, &data);
+          strip_start = data.coords.size();
+          data.coords.push_back(a[0]);
+          data.coords.push_back(a[1]);
+          open = true;
+        }
+        if (data.coords[data.coords.size() - 2] != b[0] ||
+            data.coords.back() != b[1]) {
+          data.coords.push_back(b[0]);
+          data.coords.push_back(b[1]);
+        }
+        // The rest of a polyline leaving the tile starts a new strip.
+        if (t1 < 1) {
+          close_strip(strip_start, &data);
+          strip_start = data.coords.size();
+          open = false;
+        }
+      }
+      close_strip(strip_start, &data);
+      empty = empty && data.strips.empty();
+    }
+    if (empty) {
+      return;
+    }
+    for (int l = 0; l < num_layers_; ++l) {
+      layer_data& data = layers[l];
+      std::sort(data.points.begin(), data.points.end());
+      for (std::size_t i = 0; i < data.points.size(); ++i) {
+        if (i > 0 && (data.points[i] >> 32) == (data.points[i - 1] >> 32)) {
+          continue;
+        }
+        data.strips.push_back(
+            static_cast<boost::uint32_t>(data.coords.size() / 2));
+        data.coords.push_back(static_cast<boost::int16_t>(
+            (data.points[i] >> 16) & 0xffff));
+        data.coords.push_back(static_cast<boost::int16_t>(
+            data.points[i] & 0xffff));
+      }
+      boost::uint32_t counts[2] = {
+          static_cast<boost::uint32_t>(data.coords.size() / 2),
+          static_cast<boost::uint32_t>(data.strips.size())};
+      blob->append(reinterpret_cast<const char*>(counts), sizeof(counts));
+      blob->append(reinterpret_cast<const char*>(data.coords.data()),
+                   2 * counts[0] * sizeof(boost::int16_t));
+      blob->append(reinterpret_cast<const char*>(data.strips.data()),
+                   data.strips.size() * sizeof(boost::uint32_t));
+    }
+  }
+
+  // Ends the strip starting at vertex coordinate strip_start; strips too
+  // small to be seen at the level are removed. Returns true if the strip
+  // was kept.
+  bool close_strip(std::size_t strip_start, layer_data* data) const {
+    if (data->coords.size() - strip_start < 4) {
+      data->coords.resize(strip_start);
+      return false;
+    }
+    boost::int16_t ul = data->coords[strip_start], uh = ul;
+    boost::int16_t vl = data->coords[strip_start + 1], vh = vl;
+    for (std::size_t i = strip_start; i < data->coords.size(); i += 2) {
+      ul = (std::min)(ul, data->coords[i]);
+      uh = (std::max)(uh, data->coords[i]);
+      vl = (std::min)(vl, data->coords[i + 1]);
+      vh = (std::max)(vh, data->coords[i + 1]);
+    }
+    if ((std::max)(uh - ul, vh - vl) < min_strip_extent_) {
+      data->coords.resize(strip_start);
+      return false;
+    }
+    data->strips.push_back(static_cast<boost::uint32_t>(strip_start / 2));
+    return true;
+  }
+
+  static boost::int16_t round(CT value) {
+    return static_cast<boost::int16_t>(std::floor(value + CT(0.5)));
+  }
+
+  int extent_;
+  int border_;
+  int min_strip_extent_;
+  int num_layers_;
+  int max_zoom_;
+  CT xl_;
+  CT yl_;
+  CT side_;
+  boost::uint64_t offset_;
+  std::vector<tile_entry> index_;
+  std::ofstream out_;
+};
+
+// Read only memory mapping of a tile pack. The tiles are not read when
+// the pack is opened: the pages of a tile are faulted in when its layers
+// are first touched. prefetch starts reading the pages of a tile ahead
+// in the background, release gives them back, so the resident size stays
+// with the tiles in use.
+class voronoi_tile_pack {
+ public:
+  typedef voronoi_tile_pack_format::tile_entry tile_entry;
+
+  struct layer_view {
+    const boost::int16_t* coords;
+    boost::uint32_t num_vertices;
+    const boost::uint32_t* strip_first;
+    boost::uint32_t num_strips;
+  };
+
+  voronoi_tile_pack() : data_(NULL), size_(0), index_(NULL) {
+    std::memset(&header_, 0, sizeof(header_));
+  }
+
+  ~voronoi_tile_pack() {
+    close();
+  }
+
+  bool open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        st.st_size < static_cast<off_t>(sizeof(header_))) {
+      ::close(fd);
+      return false;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* data = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      size_ = 0;
+      return false;
+    }
+    data_ = static_cast<const char*>(data);
+    std::memcpy(&header_, data_, sizeof(header_));
+    if (!valid_header()) {
+      close();
+      return false;
+    }
+    index_ = reinterpret_cast<const tile_entry*>(data_ + header_.index_offset);
+    // The index is searched on every frame, keep it resident. The range
+    // starts at a page boundary and ends within the mapping.
+    const char* index_start = data_ + header_.index_offset;
+    char* start = page_start(index_start);
+    madvise(start, (std::min)(
+                index_start + header_.num_tiles * sizeof(tile_entry) - start,
+                data_ + size_ - start),
+            MADV_WILLNEED);
+    return true;
+  }
+
+  void close() {
+    if (data_) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = NULL;
+    size_ = 0;
+    index_ = NULL;
+  }
+
+  bool is_open() const {
+    return data_ != NULL;
+  }
+
+  double xl() const {
+    return header_.xl;
+  }
+
+  double yl() const {
+    return header_.yl;
+  }
+
+  double side() const {
+    return header_.side;
+  }
+
+  int max_zoom() const {
+    return header_.max_zoom;
+  }
+
+  int extent() const {
+    return header_.extent;
+  }
+
+  int num_layers() const {
+    return header_.num_layers;
+  }
+
+  std::size_t num_tiles() const {
+    return static_cast<std::size_t>(header_.num_tiles);
+  }
+
+  std::size_t file_size() const {
+    return size_;
+  }
+
+  // Returns the tile or NULL if the pack has no geometry there.
+  const tile_entry* find(int z, int x, int y) const {
+    tile_entry key = {z, x, y, 0, 0};
+    const tile_entry* last = index_ + header_.num_tiles;
+    const tile_entry* it = std::lower_bound(
+        index_, last, key, &voronoi_tile_pack_format::key_less);
+    if (it == last || it->z != z || it->x != x || it->y != y) {
+      return NULL;
+    }
+    return it;
+  }
+
+  // Layer l of the tile; empty if the tile data is malformed.
+  layer_view layer(const tile_entry& tile, int l) const {
+    layer_view view = {NULL, 0, NULL, 0};
+    const char* cur = data_ + tile.offset;
+    const char* end = cur + tile.size;
+    for (int i = 0; i <= l; ++i) {
+      boost::uint32_t counts[2];
+      if (end - cur < static_cast<std::ptrdiff_t>(sizeof(counts))) {
+        return layer_view();
+      }
+      std::memcpy(counts, cur, sizeof(counts));
+      cur += sizeof(counts);
+      std::size_t coords_bytes =
+          2 * static_cast<std::size_t>(counts[0]) * sizeof(boost::int16_t);
+      std::size_t strips_bytes = counts[1] * sizeof(boost::uint32_t);
+      if (static_cast<std::size_t>(end - cur) < coords_bytes + strips_bytes) {
+        return layer_view();
+      }
+      view.coords = reinterpret_cast<const boost::int16_t*>(cur);
+      view.num_vertices = counts[0];
+      view.strip_first =
+          reinterpret_cast<const boost::uint32_t*>(cur + coords_bytes);
+      view.num_strips = counts[1];
+      cur += coords_bytes + strips_bytes;
+    }
+    return view;
+  }
+
+  // Starts reading the tile in the background.
+  void prefetch(const tile_entry& tile) const {
+    advise(tile, MADV_WILLNEED);
+  }
+
+  // Drops the resident pages of the tile; they are read again from the
+  // file when touched.
+  void release(const tile_entry& tile) const {
+    advise(tile, MADV_DONTNEED);
+  }
+
+ private:
+  static std::size_t page_size() {
+    static const std::size_t size = static_cast<std::size_t>(
+        sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  static char* page_start(const char* p) {
+    return reinterpret_cast<char*>(
+        reinterpret_cast<std::size_t>(p) & ~(page_size() - 1));
+  }
+
+  void advise(const tile_entry& tile, int advice) const {
+    const char* first = data_ + tile.offset;
+    char* start = page_start(first);
+    madvise(start, first + tile.size - start, advice);
+  }
+
+  bool valid_header() const {
+    if (std::memcmp(header_.magic, "VTPK", 4) != 0 ||
+        header_.version != voronoi_tile_pack_format::VERSION ||
+        header_.extent <= 0 || header_.num_layers <= 0 ||
+        header_.max_zoom < 0 || header_.max_zoom > 30 ||
+        !(header_.side > 0) ||
+        header_.index_offset < sizeof(header_) ||
+        header_.index_offset > size_ ||
+        header_.num_tiles > (size_ - header_.index_offset) /
+                            sizeof(tile_entry)) {
+      return false;
+    }
+    const tile_entry* index =
+        reinterpret_cast<const tile_entry*>(data_ + header_.index_offset);
+    for (boost::uint64_t i = 0; i < header_.num_tiles; ++i) {
+      if (index[i].offset % 8 != 0 || index[i].offset < sizeof(header_) ||
+          index[i].offset > header_.index_offset ||
+          index[i].size > header_.index_offset - index[i].offset) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  voronoi_tile_pack_format::header header_;
+  const char* data_;
+  std::size_t size_;
+  const tile_entry* index_;
+
+  // Disallow copy constructor and operator=
+  voronoi_tile_pack(const voronoi_tile_pack&);
+  void operator=(const voronoi_tile_pack&);
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_TILE_PACK
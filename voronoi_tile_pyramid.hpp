@@ -0,0 +1,195 @@
+// Boost.Polygon library voronoi_tile_pyramid.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_TILE_PYRAMID
+#define BOOST_POLYGON_VORONOI_TILE_PYRAMID
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "voronoi_parallel_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Geometry to be cut into XYZ map tiles. The pyramid covers a square
+// area: zoom level z splits it into 2^z x 2^z tiles, tile (x, y) = (0, 0)
+// is the top left one, following the web map convention.
+//
+// Items are points and polylines with a caller defined style. For every
+// zoom level the items are binned into the tiles they cross, so a tile
+// only visits its own items and tiles without items are never produced.
+template <typename CT>
+class voronoi_tile_pyramid {
+ public:
+  struct tile_key {
+    int z;
+    int x;
+    int y;
+  };
+
+  // Non-empty tiles of a zoom level with their items in compressed row
+  // form: the items of tiles[i] are items[item_start[i]..item_start[i+1]).
+  struct level {
+    std::vector<tile_key> tiles;
+    std::vector<std::size_t> item_start;
+    std::vector<std::size_t> items;
+  };
+
+  // Args:
+  //   xl, yl: lower left corner of the covered area.
+  //   side: side of the covered area.
+  voronoi_tile_pyramid(CT xl, CT yl, CT side) :
+      xl_(xl), yl_(yl), side_(side) {
+    item_start_.push_back(0);
+  }
+
+  void add_point(CT px, CT py, int style) {
+    begin_polyline(style);
+    add_vertex(px, py);
+  }
+
+  void begin_polyline(int style) {
+    styles_.push_back(style);
+    item_start_.push_back(item_start_.back());
+  }
+
+  void add_vertex(CT px, CT py) {
+    coords_.push_back(px);
+    coords_.push_back(py);
+    item_start_.back() += 1;
+  }
+
+  std::size_t num_items() const {
+    return styles_.size();
+  }
+
+  int item_style(std::size_t item) const {
+    return styles_[item];
+  }
+
+  std::size_t item_size(std::size_t item) const {
+    return item_start_[item + 1] - item_start_[item];
+  }
+
+  // Coordinates of the item vertices as (x, y) pairs.
+  const CT* item_coords(std::size_t item) const {
+    return &coords_[2 * item_start_[item]];
+  }
+
+  static int tiles_per_side(int z) {
+    return 1 << z;
+  }
+
+  CT tile_side(int z) const {
+    return side_ / tiles_per_side(z);
+  }
+
+  void tile_bounds(const tile_key& tile, CT* xl, CT* yl,
+                   CT* xh, CT* yh) const {
+    CT side = tile_side(tile.z);
+    *xl = xl_ + tile.x * side;
+    *xh = *xl + side;
+    *yh = yl_ + side_ - tile.y * side;
+    *yl = *yh - side;
+  }
+
+  // Bins the items into the tiles of the zoom level. Every polyline
+  // segment is assigned to the tiles it crosses, widened by pad on every
+  // side to account for the line widths.
+  void bin(int z, CT pad, level* output) const {
+    const int n = tiles_per_side(z);
+    const CT side = tile_side(z);
+    const CT tile_pad = pad / side;
+    std::vector<std::pair<boost::uint64_t, std::size_t> > pairs;
+    for (std::size_t i = 0; i < num_items(); ++i) {
+      const CT* c = item_coords(i);
+      std::size_t size = item_size(i);
+      for (std::size_t j = 0; j == 0 || j + 1 < size; ++j) {
+        std::size_t k = (std::min)(j + 1, size - 1);
+        // Segment in tile units, v grows downwards.
+        CT u0 = (c[2 * j] - xl_) / side;
+        CT v0 = (yl_ + side_ - c[2 * j + 1]) / side;
+        CT u1 = (c[2 * k] - xl_) / side;
+        CT v1 = (yl_ + side_ - c[2 * k + 1]) / side;
+        add_segment_tiles(u0, v0, u1, v1, tile_pad, n, i, &pairs);
+      }
+    }
+    voronoi_parallel_sort(pairs.begin(), pairs.end(),
+                          std::less<std::pair<boost::uint64_t,
+                                              std::size_t> >());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    output->tiles.clear();
+    output->item_start.clear();
+    output->items.resize(pairs.size());
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+      if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+        tile_key tile = {z, static_cast<int>(pairs[i].first % n),
+                         static_cast<int>(pairs[i].first / n)};
+        output->tiles.push_back(tile);
+        output->item_start.push_back(i);
+      }
+      output->items[i] = pairs[i].second;
+    }
+    output->item_start.push_back(pairs.size());
+  }
+
+ private:
+  // Walks over the tile columns the padded segment spans and adds the
+  // rows covered by the part of the segment within every column.
+  static void add_segment_tiles(
+      CT u0, CT v0, CT u1, CT v1, CT pad, int n, std::size_t item,
+      std::vector<std::pair<boost::uint64_t, std::size_t> >* pairs) {
+    if (u0 > u1) {
+      std::swap(u0, u1);
+      std::swap(v0, v1);
+    }
+    int x1 = (std::max)(0, tile_coordinate(u0 - pad, n));
+    int x2 = (std::min)(n - 1, tile_coordinate(u1 + pad, n));
+    for (int x = x1; x <= x2; ++x) {
+      CT ua = (std::max)(u0, CT(x) - pad);
+      CT ub = (std::min)(u1, CT(x + 1) + pad);
+      CT va = v0;
+      CT vb = v1;
+      if (u1 > u0) {
+        va = v0 + (v1 - v0) * ((std::max)(ua, u0) - u0) / (u1 - u0);
+        vb = v0 + (v1 - v0) * ((std::min)(ub, u1) - u0) / (u1 - u0);
+      }
+      int y1 = (std::max)(0, tile_coordinate((std::min)(va, vb) - pad, n));
+      int y2 = (std::min)(n - 1,
+                          tile_coordinate((std::max)(va, vb) + pad, n));
+      for (int y = y1; y <= y2; ++y) {
+        pairs->push_back(std::make_pair(
+            static_cast<boost::uint64_t>(y) * n + x, item));
+      }
+    }
+  }
+
+  // Tile index of the position measured in tiles, clamped to [-1, n].
+  static int tile_coordinate(CT position, int n) {
+    position = (std::max)(CT(-1), (std::min)(std::floor(position), CT(n)));
+    return static_cast<int>(position);
+  }
+
+  CT xl_;
+  CT yl_;
+  CT side_;
+  std::vector<CT> coords_;
+  std::vector<std::size_t> item_start_;
+  std::vector<int> styles_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_TILE_PYRAMID
@@ -0,0 +1,268 @@
+// Boost.Polygon library voronoi_traits_benchmark.cpp file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+// Builds every input with the default coordinate traits and with the
+// alternatives of voronoi_fast_ctypes.hpp on the same builder, and reports
+// the best construction time out of several runs together with the number
+// of exact (multiprecision) evaluations the input needs. The alternatives
+// only differ on the exact path, so inputs rich in degeneracies, such as
+// those found by voronoi_slowdown_search, show the difference best.
+//
+// Every diagram is cross checked against the one of the default traits:
+// the topology has to be identical and the vertex coordinates are compared
+// in ulps.
+//
+// Usage: voronoi_traits_benchmark [-r runs] file...
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <boost/polygon/polygon.hpp>
+#include <boost/polygon/voronoi.hpp>
+using namespace boost::polygon;
+
+#include "voronoi_fast_ctypes.hpp"
+#include "voronoi_input.hpp"
+#include "voronoi_instrumented_builder.hpp"
+
+typedef double coordinate_type;
+typedef point_data<coordinate_type> point_type;
+typedef segment_data<coordinate_type> segment_type;
+typedef voronoi_diagram<coordinate_type> VD;
+
+typedef detail::voronoi_ctype_traits<int> default_traits;
+typedef voronoi_instrumented_builder<
+    int, default_traits, detail::voronoi_predicates<default_traits> >
+    default_builder_type;
+typedef voronoi_instrumented_builder<
+    int, voronoi_fast_efpt_ctype_traits,
+    detail::voronoi_predicates<voronoi_fast_efpt_ctype_traits> >
+    fast_efpt_builder_type;
+#ifdef __SIZEOF_INT128__
+typedef voronoi_instrumented_builder<
+    int, voronoi_int128_ctype_traits,
+    detail::voronoi_predicates<voronoi_int128_ctype_traits> >
+    int128_builder_type;
+#endif
+// Default traits with the counters of the exact evaluations.
+typedef voronoi_instrumented_builder<int> telemetry_builder_type;
+
+// Constructs the diagram on a long lived builder of any traits.
+template <typename VB>
+static void construct_with(VB* builder,
+                           const std::vector<point_type>& points,
+                           const std::vector<segment_type>& segments,
+                           VD* vd) {
+  builder->clear();
+  insert(points.begin(), points.end(), builder);
+  insert(segments.begin(), segments.end(), builder);
+  builder->construct(vd);
+  builder->clear();
+}
+
+template <typename VB>
+static double run_builder(VB* builder,
+                          const std::vector<point_type>& points,
+                          const std::vector<segment_type>& segments,
+                          int runs, VD* vd) {
+  double best_ms = 0.0;
+  for (int i = 0; i < runs; ++i) {
+    vd->clear();
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    construct_with(builder, points, segments, vd);
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    if (i == 0 || ms < best_ms) {
+      best_ms = ms;
+    }
+  }
+  return best_ms;
+}
+
+// Whether the input has no segments and all the point coordinates within
+// [-max_coordinate, max_coordinate], the range of the traits that are
+// exact in a limited range only.
+static bool bounded_points(const std::vector<point_type>& points,
+                           const std::vector<segment_type>& segments,
+                           coordinate_type max_coordinate) {
+  if (!segments.empty()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    if (!(x(points[i]) >= -max_coordinate && x(points[i]) <= max_coordinate &&
+          y(points[i]) >= -max_coordinate && y(points[i]) <= max_coordinate)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Distance between two doubles in units in the last place.
+static long long ulp_distance(double a, double b) {
+  long long ia, ib;
+  std::memcpy(&ia, &a, sizeof(a));
+  std::memcpy(&ib, &b, sizeof(b));
+  if (ia < 0) {
+    ia = LLONG_MIN - ia;
+  }
+  if (ib < 0) {
+    ib = LLONG_MIN - ib;
+  }
+  return ia > ib ? ia - ib : ib - ia;
+}
+
+// Returns -1 if the topology of the diagrams differs, otherwise the largest
+// distance of the vertex coordinates in ulps.
+static long long compare_diagrams(const VD& expected, const VD& actual) {
+  if (expected.num_cells() != actual.num_cells() ||
+      expected.num_vertices() != actual.num_vertices() ||
+      expected.num_edges() != actual.num_edges()) {
+    return -1;
+  }
+  for (std::size_t i = 0; i < expected.num_cells(); ++i) {
+    const VD::cell_type& c1 = expected.cells()[i];
+    const VD::cell_type& c2 = actual.cells()[i];
+    if (c1.source_index() != c2.source_index() ||
+        c1.source_category() != c2.source_category()) {
+      return -1;
+    }
+  }
+  const VD::edge_type* e1 = &expected.edges()[0];
+  const VD::edge_type* e2 = &actual.edges()[0];
+  const VD::vertex_type* v1 = expected.num_vertices() ?
+      &expected.vertices()[0] : NULL;
+  const VD::vertex_type* v2 = actual.num_vertices() ?
+      &actual.vertices()[0] : NULL;
+  for (std::size_t i = 0; i < expected.num_edges(); ++i) {
+    const VD::edge_type& edge1 = expected.edges()[i];
+    const VD::edge_type& edge2 = actual.edges()[i];
+    if (edge1.next() - e1 != edge2.next() - e2 ||
+        edge1.twin() - e1 != edge2.twin() - e2 ||
+        (edge1.vertex0() ? edge1.vertex0() - v1 : -1) !=
+        (edge2.vertex0() ? edge2.vertex0() - v2 : -1) ||
+        edge1.is_curved() != edge2.is_curved()) {
+      return -1;
+    }
+  }
+  long long max_ulps = 0;
+  for (std::size_t i = 0; i < expected.num_vertices(); ++i) {
+    const VD::vertex_type& vertex1 = expected.vertices()[i];
+    const VD::vertex_type& vertex2 = actual.vertices()[i];
+    max_ulps = (std::max)(max_ulps, ulp_distance(vertex1.x(), vertex2.x()));
+    max_ulps = (std::max)(max_ulps, ulp_distance(vertex1.y(), vertex2.y()));
+  }
+  return max_ulps;
+}
+
+// Prints the row of the alternative traits and returns false if their
+// diagram differs from the expected one.
+static bool report(const char* file, const char* traits,
+                   const voronoi_builder_telemetry& telemetry,
+                   double default_ms, double ms,
+                   const VD& expected, const VD& vd) {
+  long long max_ulps = compare_diagrams(expected, vd);
+  std::cout << std::left << std::setw(40) << file
+            << std::setw(12) << traits
+            << std::right << std::setw(10) << telemetry.site_events
+            << std::setw(14) << telemetry.predicates.exact_evaluations
+            << std::setw(12) << ms
+            << std::setw(10) << default_ms / ms;
+  if (max_ulps < 0) {
+    std::cout << std::setw(12) << "MISMATCH" << std::endl;
+    std::cerr << file << ": the topology of " << traits
+              << " differs from the default traits" << std::endl;
+    return false;
+  }
+  std::cout << std::setw(12) << max_ulps << std::endl;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  int runs = 5;
+  int first_file = 1;
+  if (argc > 2 && std::strcmp(argv[1], "-r") == 0) {
+    runs = std::max(1, std::atoi(argv[2]));
+    first_file = 3;
+  }
+  if (first_file >= argc) {
+    std::cerr << "Usage: " << argv[0] << " [-r runs] file..." << std::endl;
+    return 1;
+  }
+
+  default_builder_type default_builder;
+  fast_efpt_builder_type fast_efpt_builder;
+#ifdef __SIZEOF_INT128__
+  int128_builder_type int128_builder;
+#endif
+  telemetry_builder_type telemetry_builder;
+
+  int mismatches = 0;
+  std::cout << std::left << std::setw(40) << "file"
+            << std::setw(12) << "traits"
+            << std::right << std::setw(10) << "sites"
+            << std::setw(14) << "exact evals"
+            << std::setw(12) << "best ms"
+            << std::setw(10) << "speedup"
+            << std::setw(12) << "max ulps" << std::endl;
+  for (int i = first_file; i < argc; ++i) {
+    std::ifstream in(argv[i]);
+    std::vector<point_type> points;
+    std::vector<segment_type> segments;
+    if (!in || !read_voronoi_input(in, &points, &segments)) {
+      std::cerr << "Unable to read " << argv[i] << std::endl;
+      continue;
+    }
+
+    VD telemetry_vd;
+    construct_with(&telemetry_builder, points, segments, &telemetry_vd);
+    const voronoi_builder_telemetry& telemetry =
+        telemetry_builder.telemetry();
+
+    VD expected;
+    double default_ms =
+        run_builder(&default_builder, points, segments, runs, &expected);
+    std::cout << std::left << std::setw(40) << argv[i]
+              << std::setw(12) << "default"
+              << std::right << std::setw(10) << telemetry.site_events
+              << std::setw(14) << telemetry.predicates.exact_evaluations
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << default_ms
+              << std::setw(10) << 1.0
+              << std::setw(12) << "-" << std::endl;
+
+    {
+      VD vd;
+      double ms = run_builder(&fast_efpt_builder, points, segments, runs, &vd);
+      if (!report(argv[i], "fast efpt", telemetry, default_ms, ms, expected,
+                  vd)) {
+        ++mismatches;
+      }
+    }
+#ifdef __SIZEOF_INT128__
+    if (bounded_points(points, segments,
+                       voronoi_int128_ctype_traits::MAX_COORDINATE)) {
+      VD vd;
+      double ms = run_builder(&int128_builder, points, segments, runs, &vd);
+      if (!report(argv[i], "int128", telemetry, default_ms, ms, expected,
+                  vd)) {
+        ++mismatches;
+      }
+    }
+#endif
+  }
+  return mismatches ? 2 : 0;
+}
@@ -0,0 +1,327 @@
+// Boost.Polygon library voronoi_vector_tile.hpp header file
+
+//          Copyright Andrii Sydorchuk 2010-2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org for updates, documentation, and revision history.
+
+#ifndef BOOST_POLYGON_VORONOI_VECTOR_TILE
+#define BOOST_POLYGON_VORONOI_VECTOR_TILE
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "voronoi_visual_utils.hpp"
+
+namespace boost {
+namespace polygon {
+// Encoder of a single Mapbox Vector Tile (specification version 2).
+//
+// Geometry is given in the coordinates of the diagram together with the
+// area the tile covers. It is transformed to the integer tile grid of the
+// given extent (y pointing down), clipped to the tile widened by a buffer
+// and simplified by the Douglas-Peucker algorithm with a tolerance of half
+// a grid unit, so that the simplification follows the zoom level.
+//
+// Every layer declares a list of boolean properties; features pass the
+// set properties as a bit mask and get a tag for each of them.
+template <typename CT>
+class voronoi_vector_tile {
+ public:
+  // Args:
+  //   xl, yl, xh, yh: area covered by the tile; a non-square area is
+  //     scaled separately along each axis.
+  //   extent: size of the tile grid.
+  //   buffer: width of the border kept around the tile, in grid units.
+  voronoi_vector_tile(CT xl, CT yl, CT xh, CT yh,
+                      unsigned extent = 4096, unsigned buffer = 64) :
+      xl_(xl), yh_(yh),
+      scale_x_(extent / (xh - xl)),
+      scale_y_(extent / (yh - yl)),
+      extent_(extent),
+      buffer_(buffer) {}
+
+  void begin_layer(const std::string& name,
+                   const std::vector<std::string>& properties) {
+    layers_.push_back(layer());
+    layers_.back().name = name;
+    layers_.back().properties = properties;
+  }
+
+  // Adds a point feature; points outside of the buffered tile are dropped.
+  void add_point(CT px, CT py, unsigned properties) {
+    CT u = to_grid_x(px);
+    CT v = to_grid_y(py);
+    if (u < -CT(buffer_) || u > CT(extent_ + buffer_) ||
+        v < -CT(buffer_) || v > CT(extent_ + buffer_)) {
+      return;
+    }
+    std::vector<boost::int32_t> vertices;
+    vertices.push_back(round(u));
+    vertices.push_back(round(v));
+    add_feature(POINT, vertices, properties);
+  }
+
+  // Adds the parts of the polyline inside the buffered tile, every part as
+  // a separate line string feature.
+  // Args:
+  //   coords: polyline vertices as (x, y) pairs.
+  //   size: number of the vertices.
+  void add_polyline(const CT* coords, std::size_t size, unsigned properties) {
+    const CT lo = -CT(buffer_);
+    const CT hi = CT(extent_ + buffer_);
+    std::vector<CT> part;
+    for (std::size_t i = 0; i + 1 < size; ++i) {
+      CT u0 = to_grid_x(coords[2 * i]);
+      CT v0 = to_grid_y(coords[2 * i + 1]);
+      CT u1 = to_grid_x(coords[2 * i + 2]);
+      CT v1 = to_grid_y(coords[2 * i + 3]);
+      CT t0 = 0;
+      CT t1 = 1;
+      if (!voronoi_visual_utils<CT>::clip(u0, v0, u1, v1, lo, lo, hi, hi,
+                                          &t0, &t1)) {
+        flush_part(&part, properties);
+        continue;
+      }
+      if (part.empty() || t0 > 0) {
+        flush_part(&part, properties);
+        part.push_back(u0 + t0 * (u1 - u0));
+        part.push_back(v0 + t0 * (v1 - v0));
+      }
+      part.push_back(u0 + t1 * (u1 - u0));
+      part.push_back(v0 + t1 * (v1 - v0));
+      if (t1 < 1) {
+        flush_part(&part, properties);
+      }
+    }
+    flush_part(&part, properties);
+  }
+
+  bool empty() const {
+    for (std::size_t i = 0; i < layers_.size(); ++i) {
+      if (!layers_[i].features.empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Serializes the tile, layers without features are left out.
+  std::string encode() const {
+    std::string tile;
+    for (std::size_t i = 0; i < layers_.size(); ++i) {
+      if (!layers_[i].features.empty()) {
+        write_message(&tile, 3, encode_layer(layers_[i]));
+      }
+    }
+    return tile;
+  }
+
+ private:
+  enum geometry_type {
+    POINT = 1,
+    LINESTRING = 2
+  };
+
+  struct feature {
+    geometry_type type;
+    unsigned properties;
+    // Grid coordinates as (x, y) pairs.
+    std::vector<boost::int32_t> vertices;
+  };
+
+  struct layer {
+    std::string name;
+    std::vector<std::string> properties;
+    std::vector<feature> features;
+  };
+
+  CT to_grid_x(CT px) const {
+    return (px - xl_) * scale_x_;
+  }
+
+  CT to_grid_y(CT py) const {
+    return (yh_ - py) * scale_y_;
+  }
+
+  static boost::int32_t round(CT value) {
+    return static_cast<boost::int32_t>(std::floor(value + CT(0.5)));
+  }
+
+  void flush_part(std::vector<CT>* part, unsigned properties) {
+    if (part->size() >= 4) {
+      std::vector<bool> keep(part->size() / 2, false);
+      keep.front() = keep.back() = true;
+      simplify(*part, 0, part->size() / 2 - 1, &keep);
+      std::vector<boost::int32_t> vertices;
+      for (std::size_t i = 0; i < keep.size(); ++i) {
+        if (!keep[i]) {
+          continue;
+        }
+        boost::int32_t u = round((*part)[2 * i]);
+        boost::int32_t v = round((*part)[2 * i + 1]);
+        // Drop the vertices that coincide on the grid.
+        if (vertices.empty() || u != vertices[vertices.size() - 2] ||
+            v != vertices.back()) {
+          vertices.push_back(u);
+          vertices.push_back(v);
+        }
+      }
+      if (vertices.size() >= 4) {
+        add_feature(LINESTRING, vertices, properties);
+      }
+    }
+    part->clear();
+  }
+
+  // Douglas-Peucker: keeps the vertex farthest from the chord between the
+  // first and the last vertex of the range if it deviates by more than
+  // half a grid unit, then recurses into both halves.
+  static void simplify(const std::vector<CT>& part, std::size_t first,
+                       std::size_t last, std::vector<bool>* keep) {
+    if (last <= first + 1) {
+      return;
+    }
+    CT ax = part[2 * first];
+    CT ay = part[2 * first + 1];
+    CT dx = part[2 * last] - ax;
+    CT dy = part[2 * last + 1] - ay;
+    CT length = std::sqrt(dx * dx + dy * dy);
+    CT max_dist = -1;
+    std::size_t farthest = first;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      CT vx = part[2 * i] - ax;
+      CT vy = part[2 * i + 1] - ay;
+      CT dist = length > 0 ? std::fabs(vx * dy - vy * dx) / length :
+                             std::sqrt(vx * vx + vy * vy);
+      if (dist > max_dist) {
+        max_dist = dist;
+        farthest = i;
+      }
+    }
+    if (max_dist <= CT(0.5)) {
+      return;
+    }
+    (*keep)[farthest] = true;
+    simplify(part, first, farthest, keep);
+    simplify(part, farthest, last, keep);
+  }
+
+  void add_feature(geometry_type type,
+                   const std::vector<boost::int32_t>& vertices,
+                   unsigned properties) {
+    layers_.back().features.push_back(feature());
+    feature& f = layers_.back().features.back();
+    f.type = type;
+    f.properties = properties;
+    f.vertices = vertices;
+  }
+
+  std::string encode_layer(const layer& l) const {
+    std::string message;
+    write_varint_field(&message, 15, 2);
+    write_bytes(&message, 1, l.name);
+    for (std::size_t i = 0; i < l.features.size(); ++i) {
+      write_message(&message, 2, encode_feature(l.features[i],
+                                                l.properties.size()));
+    }
+    for (std::size_t i = 0; i < l.properties.size(); ++i) {
+      write_bytes(&message, 3, l.properties[i]);
+    }
+    // Value table: index 0 is false, index 1 is true.
+    for (int value = 0; value < 2; ++value) {
+      std::string bool_value;
+      write_varint_field(&bool_value, 7, value);
+      write_message(&message, 4, bool_value);
+    }
+    write_varint_field(&message, 5, extent_);
+    return message;
+  }
+
+  static std::string encode_feature(const feature& f,
+                                    std::size_t num_properties) {
+    std::string tags;
+    for (std::size_t i = 0; i < num_properties; ++i) {
+      write_varint(&tags, i);
+      write_varint(&tags, (f.properties >> i) & 1);
+    }
+    std::string geometry;
+    std::size_t num_vertices = f.vertices.size() / 2;
+    boost::int32_t cursor_x = 0;
+    boost::int32_t cursor_y = 0;
+    for (std::size_t i = 0; i < num_vertices; ++i) {
+      if (i == 0) {
+        write_varint(&geometry, command(1, f.type == POINT ? num_vertices : 1));
+      } else if (i == 1 && f.type == LINESTRING) {
+        write_varint(&geometry, command(2, num_vertices - 1));
+      }
+      write_varint(&geometry, zigzag(f.vertices[2 * i] - cursor_x));
+      write_varint(&geometry, zigzag(f.vertices[2 * i + 1] - cursor_y));
+      cursor_x = f.vertices[2 * i];
+      cursor_y = f.vertices[2 * i + 1];
+    }
+    std::string message;
+    if (!tags.empty()) {
+      write_bytes(&message, 2, tags);
+    }
+    write_varint_field(&message, 3, f.type);
+    write_bytes(&message, 4, geometry);
+    return message;
+  }
+
+  static boost::uint64_t command(boost::uint64_t id, boost::uint64_t count) {
+    return (id & 0x7) | (count << 3);
+  }
+
+  // Shifts the unsigned value, left shifting a negative int is undefined.
+  static boost::uint64_t zigzag(boost::int32_t value) {
+    return (static_cast<boost::uint32_t>(value) << 1) ^
+           static_cast<boost::uint32_t>(value >> 31);
+  }
+
+  static void write_varint(std::string* out, boost::uint64_t value) {
+    while (value >= 0x80) {
+      out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+  }
+
+  static void write_varint_field(std::string* out, int field,
+                                 boost::uint64_t value) {
+    write_varint(out, static_cast<boost::uint64_t>(field) << 3);
+    write_varint(out, value);
+  }
+
+  // Length delimited field: strings, embedded messages, packed arrays.
+  static void write_bytes(std::string* out, int field,
+                          const std::string& bytes) {
+    write_varint(out, (static_cast<boost::uint64_t>(field) << 3) | 2);
+    write_varint(out, bytes.size());
+    out->append(bytes);
+  }
+
+  static void write_message(std::string* out, int field,
+                            const std::string& message) {
+    write_bytes(out, field, message);
+  }
+
+  CT xl_;
+  CT yh_;
+  CT scale_x_;
+  CT scale_y_;
+  unsigned extent_;
+  unsigned buffer_;
+  std::vector<layer> layers_;
+};
+}
+}
+
+#endif  // BOOST_POLYGON_VORONOI_VECTOR_TILE
@@ -10,7 +10,9 @@
 #ifndef BOOST_POLYGON_VORONOI_VISUAL_UTILS
 #define BOOST_POLYGON_VORONOI_VISUAL_UTILS
 
+#include <algorithm>
 #include <stack>
+#include <utility>
 #include <vector>
 
 #include <boost/polygon/isotropy.hpp>
@@ -132,6 +134,38 @@ class voronoi_visual_utils {
     discretization->back() = last_point;
   }
 
+  // Clip the segment (x0, y0) - (x1, y1) to the rectangle using the
+  // Liang-Barsky algorithm.
+  //
+  // Args:
+  //   xl, yl, xh, yh: clipping rectangle.
+  //   t0, t1: parameter range of the segment, narrowed to its part inside
+  //     the rectangle; should be initialized to [0, 1].
+  //
+  // Returns false if the segment does not intersect the rectangle.
+  static bool clip(CT x0, CT y0, CT x1, CT y1,
+                   CT xl, CT yl, CT xh, CT yh, CT* t0, CT* t1) {
+    CT d[2] = {x1 - x0, y1 - y0};
+    CT lo[2] = {xl - x0, yl - y0};
+    CT hi[2] = {xh - x0, yh - y0};
+    for (int i = 0; i < 2; ++i) {
+      if (d[i] == 0) {
+        if (lo[i] > 0 || hi[i] < 0) {
+          return false;
+        }
+        continue;
+      }
+      CT ta = lo[i] / d[i];
+      CT tb = hi[i] / d[i];
+      if (ta > tb) {
+        std::swap(ta, tb);
+      }
+      *t0 = (std::max)(*t0, ta);
+      *t1 = (std::min)(*t1, tb);
+    }
+    return *t0 <= *t1;
+  }
+
  private:
   // Compute y(x) = ((x - a) * (x - a) + b * b) / (2 * b).
   static CT parabola_y(CT x, CT a, CT b) {
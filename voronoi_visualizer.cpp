@@ -8,31 +8,73 @@
 // See http://www.boost.org for updates, documentation, and revision history.
 
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <QApplication>
 #include <QCheckBox>
 #include <QFileDialog>
+#include <QFont>
+#include <QFontMetricsF>
 #include <QHBoxLayout>
+#include <QImageWriter>
+#include <QInputDialog>
 #include <QLabel>
+#include <QLineEdit>
 #include <QListWidget>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QMouseEvent>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions>
 #include <QOpenGLWidget>
+#include <QPainter>
 #include <QPushButton>
+#include <QScrollBar>
+#include <QStandardPaths>
 #include <QTextStream>
+#include <QTimer>
 
 #include <boost/polygon/polygon.hpp>
 #include <boost/polygon/voronoi.hpp>
 using namespace boost::polygon;
 
+#include "voronoi_attribute_filter.hpp"
+#include "voronoi_edge_chains.hpp"
+#include "voronoi_glyph_atlas.hpp"
+#include "voronoi_input.hpp"
+#include "voronoi_instrumented_builder.hpp"
+#include "voronoi_interior_classifier.hpp"
+#include "voronoi_lru_cache.hpp"
+#include "voronoi_node_pool.hpp"
+#include "voronoi_raster_preview.hpp"
+#include "voronoi_region_index.hpp"
+#include "voronoi_parallel_utils.hpp"
+#include "voronoi_quantized_layer.hpp"
+#include "voronoi_retirement_queue.hpp"
+#include "voronoi_thumbnail_queue.hpp"
+#include "voronoi_tile_pack.hpp"
+#include "voronoi_tile_pyramid.hpp"
+#include "voronoi_vector_tile.hpp"
 #include "voronoi_visual_utils.hpp"
 
 
+// Positions may be 16 bit tile offsets, which need the full float
+// precision to be expanded exactly.
 static const char* vertex_shader_code = R"(#ifdef GL_ES
-precision mediump float;
+precision highp float;
 #endif
 attribute vec2 position;
 uniform mat4 mvpMatrix;
@@ -50,15 +92,257 @@ void main(void) {
 }
 )";
 
+// Site glyphs are drawn instanced: the unit circle offsets are shared by
+// all glyphs and every instance supplies its center.
+static const char* glyph_vertex_shader_code = R"(#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 offset;
+attribute vec2 center;
+uniform mat4 mvpMatrix;
+uniform vec2 radius;
+void main(void) {
+    gl_Position = mvpMatrix * vec4(center + offset * radius, 0.0, 1.0);
+}
+)";
+
+// Without instancing the glyphs are drawn as points of the glyph size,
+// round with point smoothing on desktop OpenGL and by discarding the
+// corners on OpenGL ES.
+static const char* point_glyph_vertex_shader_code = R"(#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 center;
+uniform mat4 mvpMatrix;
+uniform float pointSize;
+void main(void) {
+    gl_Position = mvpMatrix * vec4(center, 0.0, 1.0);
+    gl_PointSize = pointSize;
+}
+)";
+
+static const char* point_glyph_fragment_shader_code = R"(#ifdef GL_ES
+precision mediump float;
+#endif
+uniform vec4 color;
+void main(void) {
+#ifdef GL_ES
+  if (length(gl_PointCoord - vec2(0.5)) > 0.5) {
+    discard;
+  }
+#endif
+  gl_FragColor = color;
+}
+)";
+
+// Edges are drawn as one instanced quad per line piece, so the width and
+// the dashes of every category come from the style table and all of the
+// edges of a tile take one draw call. An instance spans two consecutive
+// vertices of the tile buffer and the category of the first one styles
+// it; the last vertex of every strip has the hidden category, whose
+// width is zero. The tables have NUM_EDGE_STYLES rows: the color and the
+// width, dash and gap lengths in pixels. Without instancing the attributes
+// of the instances are repeated for the six vertices of every quad.
+static const char* edge_vertex_shader_code = R"(#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 corner;
+attribute vec2 start;
+attribute vec2 end;
+attribute float category;
+attribute float arcLength;
+uniform mat4 mvpMatrix;
+uniform vec2 viewportSize;
+uniform float pixelsPerUnit;
+uniform vec4 styleColors[16];
+uniform vec4 styleStrokes[16];
+varying vec4 fragColor;
+varying vec2 dash;
+varying float dashPosition;
+void main(void) {
+    int index = int(category + 0.5);
+    vec4 stroke = styleStrokes[index];
+    vec2 halfSize = 0.5 * viewportSize;
+    vec2 p0 = (mvpMatrix * vec4(start, 0.0, 1.0)).xy * halfSize;
+    vec2 p1 = (mvpMatrix * vec4(end, 0.0, 1.0)).xy * halfSize;
+    vec2 direction = p1 - p0;
+    float pieceLength = length(direction);
+    direction = pieceLength > 0.0 ? direction / pieceLength : vec2(1.0, 0.0);
+    // Square caps of half the width close the joints of the pieces.
+    vec2 pixel = mix(p0, p1, corner.x) + 0.5 * stroke.x *
+        ((2.0 * corner.x - 1.0) * direction +
+         corner.y * vec2(-direction.y, direction.x));
+    gl_Position = vec4(pixel / halfSize, 0.0, 1.0);
+    fragColor = styleColors[index];
+    dash = stroke.yz;
+    dashPosition = arcLength * pixelsPerUnit + dot(pixel - p0, direction);
+}
+)";
+
+static const char* edge_fragment_shader_code = R"(#ifdef GL_ES
+precision mediump float;
+#endif
+varying vec4 fragColor;
+varying vec2 dash;
+varying float dashPosition;
+void main(void) {
+  if (dash.y > 0.0 && mod(dashPosition, dash.x + dash.y) >= dash.x) {
+    discard;
+  }
+  gl_FragColor = fragColor;
+}
+)";
+
+// Site labels are drawn instanced from a signed distance field glyph
+// atlas: the unit quad is shared by all the characters and every instance
+// supplies the label anchor, the column of the character and its glyph.
+// The labels keep their size in pixels at any zoom.
+static const char* label_vertex_shader_code = R"(#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 corner;
+attribute vec4 glyph;
+uniform mat4 mvpMatrix;
+uniform vec2 origin;
+uniform vec2 advance;
+uniform vec2 cellSize;
+uniform vec2 atlasGrid;
+varying vec2 texCoord;
+void main(void) {
+    vec4 anchor = mvpMatrix * vec4(glyph.xy, 0.0, 1.0);
+    gl_Position = vec4(anchor.xy + origin + glyph.z * advance +
+                       corner * cellSize, 0.0, 1.0);
+    vec2 cell = vec2(mod(glyph.w, atlasGrid.x), floor(glyph.w / atlasGrid.x));
+    texCoord = (cell + vec2(corner.x, 1.0 - corner.y)) / atlasGrid;
+}
+)";
+
+// The outline is at half of the distance range, the halo keeps the labels
+// readable over the edges.
+static const char* label_fragment_shader_code = R"(#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D atlas;
+uniform vec4 color;
+uniform vec4 haloColor;
+uniform float smoothing;
+varying vec2 texCoord;
+void main(void) {
+  float distance = texture2D(atlas, texCoord).a;
+  float fill = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+  float halo = smoothstep(0.38 - smoothing, 0.38 + smoothing, distance);
+  gl_FragColor = vec4(mix(haloColor.rgb, color.rgb, fill),
+                      mix(haloColor.a * halo, color.a, fill));
+}
+)";
+
+static const char* texture_vertex_shader_code = R"(#ifdef GL_ES
+precision mediump float;
+#endif
+attribute vec2 position;
+attribute vec2 texCoord;
+varying vec2 fragTexCoord;
+void main(void) {
+    fragTexCoord = texCoord;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+static const char* texture_fragment_shader_code = R"(#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D sampler;
+varying vec2 fragTexCoord;
+void main(void) {
+  gl_FragColor = texture2D(sampler, fragTexCoord);
+}
+)";
+
+// Time the process was started at, the reference of the startup timings.
+static std::chrono::steady_clock::time_point process_start_time;
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Constructs the diagram on a long lived builder, such as the pooled or the
+// instrumented one of the widget.
+template <typename VB, typename Point, typename Segment, typename VD>
+static void construct_with(VB* builder, const std::vector<Point>& points,
+                           const std::vector<Segment>& segments, VD* vd) {
+  builder->clear();
+  insert(points.begin(), points.end(), builder);
+  insert(segments.begin(), segments.end(), builder);
+  builder->construct(vd);
+  builder->clear();
+}
+
+// Diagram of the file given on the command line. It is read and
+// constructed on a worker thread started at the process start from a guess
+// of the path, before Qt is initialized, so that neither waits for the
+// other. See guess_startup_path.
+struct startup_build {
+  typedef point_data<double> point_type;
+  typedef segment_data<double> segment_type;
+  typedef voronoi_diagram<double> VD;
+
+  startup_build() : vd(new VD), ok(false), input_ms(0) {}
+
+  std::vector<point_type> points;
+  std::vector<segment_type> segments;
+  std::unique_ptr<VD> vd;
+  bool ok;
+  // Time from the process start until the input was read.
+  double input_ms;
+
+  static std::unique_ptr<startup_build> run(const std::string& file_path) {
+    std::unique_ptr<startup_build> build(new startup_build);
+    std::ifstream in(file_path.c_str());
+    build->ok = in && read_voronoi_input(in, &build->points,
+                                         &build->segments);
+    build->input_ms = milliseconds_since(process_start_time);
+    if (build->ok) {
+      typedef detail::voronoi_ctype_traits<int> CTT;
+      typedef voronoi_instrumented_builder<
+          int, CTT, detail::voronoi_predicates<CTT>,
+          voronoi_pool_allocator<char> > pooled_builder_type;
+      voronoi_node_pool node_pool;
+      pooled_builder_type vb((voronoi_pool_allocator<char>(&node_pool)));
+      construct_with(&vb, build->points, build->segments, build->vd.get());
+    }
+    return build;
+  }
+};
+
 class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   Q_OBJECT
 
  public:
   explicit GLWidget(QWidget* parent = NULL) :
       QOpenGLWidget(parent),
+      vb_(voronoi_pool_allocator<char>(&node_pool_)),
+      vd_(new VD),
       primary_edges_only_(false),
-      internal_edges_only_(false) {
+      internal_edges_only_(false),
+      winding_classifier_(false),
+      region_only_(false),
+      region_build_(false),
+      selecting_(false) {
+    // In the order of edge_flag and edge_column.
+    edge_attributes_.add_flag("primary");
+    edge_attributes_.add_flag("internal");
+    edge_attributes_.add_flag("curved");
+    edge_attributes_.add_flag("infinite");
+    edge_attributes_.add_flag("unreliable");
+    for (int i = 0; i < MAX_LAYERS; ++i) {
+      edge_attributes_.add_flag("layer" + std::to_string(i));
+    }
+    edge_attributes_.add_column("length");
+    edge_attributes_.add_column("clearance");
+    set_edge_styles();
     setUpdateBehavior(QOpenGLWidget::UpdateBehavior::NoPartialUpdate);
+    setMouseTracking(true);
     startTimer(40);
   }
 
@@ -69,47 +353,407 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   void build(const QString& file_path) {
     // Clear all containers.
     clear();
+    file_path_ = file_path;
 
     // Read data.
     read_data(file_path);
 
-    // No data, don't proceed.
-    if (!brect_initialized_) {
-      return;
-    }
-
-    // Construct bounding rectangle.
-    construct_brect();
+    start_build();
+  }
 
-    // Construct voronoi diagram.
-    construct_voronoi(
-        point_data_.begin(), point_data_.end(),
-        segment_data_.begin(), segment_data_.end(),
-        &vd_);
+  // Builds one diagram of the sites of all the files, every file being a
+  // layer of its own. The files are read in parallel.
+  void build(const QStringList& file_paths) {
+    clear();
+    file_path_ = file_paths.first();
+    read_layers(file_paths);
+    start_build();
+  }
 
-    // Color exterior edges.
-    for (const_edge_iterator it = vd_.edges().begin();
-         it != vd_.edges().end(); ++it) {
-      if (!it->is_finite()) {
-        color_exterior(&(*it));
-      }
-    }
+  // Shows the diagram of the file given on the command line once the
+  // startup build is done.
+  void build(const QString& file_path,
+             std::future<std::unique_ptr<startup_build> > startup) {
+    clear();
+    file_path_ = file_path;
+    startup_future_ = std::move(startup);
+  }
 
-    // Update view port.
-    update_view_port();
+  bool is_building() const {
+    return build_future_.valid() || startup_future_.valid();
   }
 
   void show_primary_edges_only() {
     primary_edges_only_ ^= true;
+    static_layer_dirty_ = true;
   }
 
   void show_internal_edges_only() {
     internal_edges_only_ ^= true;
+    static_layer_dirty_ = true;
+  }
+
+  // Shows or hides the sites of the layer and the edges they generate.
+  // The diagram is kept, only the render layers are prepared again.
+  void set_layer_visible(int layer, bool visible) {
+    if (visible) {
+      visible_layers_ |= 1u << layer;
+    } else {
+      visible_layers_ &= ~(1u << layer);
+    }
+    invalidate_layers();
+    site_points_dirty_ = true;
+    labels_dirty_ = true;
+    if (hovered_site_ != site_locator_type::NO_SITE &&
+        !site_visible(hovered_site_)) {
+      hovered_site_ = site_locator_type::NO_SITE;
+    }
+  }
+
+  // Switches the edge colors between the categories and the layers of
+  // the sites that generate the edges.
+  void color_edges_by_layer() {
+    color_by_layer_ ^= true;
+    invalidate_layers();
+  }
+
+  // Switches between styling the edges by category and drawing them
+  // alike. Only the style table changes, the edge buffers are kept.
+  void style_edge_categories() {
+    edge_categories_styled_ ^= true;
+    set_edge_styles();
+    static_layer_dirty_ = true;
+  }
+
+  void classify_by_winding_numbers() {
+    winding_classifier_ ^= true;
+  }
+
+  void build_region_only() {
+    region_only_ ^= true;
+  }
+
+  // Shows only the edges passing the filter expression, see
+  // voronoi_attribute_filter for the syntax and prepare_edge_attributes
+  // for the attributes. The filter applies to the view and the exports
+  // of the visible edges; an empty expression shows all edges. Returns
+  // false and sets error if the expression is not valid, the current
+  // filter staying in effect.
+  bool set_edge_filter(const QString& expression, QString* error) {
+    std::string message;
+    if (!edge_filter_.compile(expression.toStdString(), edge_attributes_,
+                              &message)) {
+      *error = QString::fromStdString(message);
+      return false;
+    }
+    edge_filter_dirty_ = true;
+    // The pool only releases all of its buffers at once, so the layers
+    // are all dropped and prepared again rather than the edges alone.
+    invalidate_layers();
+    return true;
+  }
+
+  // Builds with the instrumented builder and prints its statistics.
+  void record_builder_telemetry() {
+    record_telemetry_ ^= true;
+  }
+
+  // Switches the parallel routines between the free running and the
+  // deterministic mode, in which the render buffers and the exports do not
+  // depend on the thread count. Applies to the layers prepared afterwards.
+  void run_deterministic() {
+    voronoi_parallel_config().deterministic =
+        !voronoi_parallel_config().deterministic;
+  }
+
+  // Writes XYZ map tiles of the diagram for the zoom levels 0..max_zoom
+  // to directory/z/x/y.format, rendered on the CPU in parallel. Tiles
+  // without any geometry are skipped. Returns the number of tiles written.
+  std::size_t export_tiles(const QString& directory, int max_zoom,
+                           const QString& format) {
+    if (is_building() || !brect_initialized_) {
+      return 0;
+    }
+    tile_pyramid_type pyramid(xl(brect_), yl(brect_),
+                              xh(brect_) - xl(brect_));
+    fill_tile_pyramid(false, &pyramid);
+
+    QByteArray format_name = format.toLatin1();
+    std::atomic<std::size_t> num_written(0);
+    for (int z = 0; z <= max_zoom; ++z) {
+      tile_pyramid_type::level level;
+      pyramid.bin(z, TILE_PAD * pyramid.tile_side(z) / TILE_SIZE, &level);
+      // Create the directories up front, the workers only write files.
+      for (std::size_t i = 0; i < level.tiles.size(); ++i) {
+        if (i == 0 || level.tiles[i].x != level.tiles[i - 1].x) {
+          QDir().mkpath(tr("%1/%2/%3").arg(directory).arg(z)
+                                      .arg(level.tiles[i].x));
+        }
+      }
+      voronoi_parallel_for(level.tiles.size(), 16,
+                           [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+          QImage image = render_tile(pyramid, level, i);
+          if (is_blank(image)) {
+            continue;
+          }
+          const tile_pyramid_type::tile_key& tile = level.tiles[i];
+          QString path = tr("%1/%2/%3/%4.%5").arg(directory).arg(tile.z)
+              .arg(tile.x).arg(tile.y).arg(format);
+          if (image.save(path, format_name.constData())) {
+            ++num_written;
+          }
+        }
+      });
+    }
+    return num_written;
+  }
+
+  // Writes Mapbox vector tiles of the diagram for the zoom levels
+  // 0..max_zoom to directory/z/x/y.mvt, encoded in parallel. All edges are
+  // exported with their primary, internal, curved and unreliable flags as
+  // feature properties, so that the clients choose what to show. Returns
+  // the number of tiles written.
+  std::size_t export_vector_tiles(const QString& directory, int max_zoom) {
+    if (is_building() || !brect_initialized_) {
+      return 0;
+    }
+    tile_pyramid_type pyramid(xl(brect_), yl(brect_),
+                              xh(brect_) - xl(brect_));
+    fill_tile_pyramid(true, &pyramid);
+
+    std::vector<std::string> site_properties;
+    std::vector<std::string> edge_properties;
+    edge_properties.push_back("primary");
+    edge_properties.push_back("internal");
+    edge_properties.push_back("curved");
+    edge_properties.push_back("unreliable");
+    std::atomic<std::size_t> num_written(0);
+    for (int z = 0; z <= max_zoom; ++z) {
+      tile_pyramid_type::level level;
+      // Features are kept up to the tile buffer, bin them accordingly.
+      pyramid.bin(z, coordinate_type(MVT_BUFFER) * pyramid.tile_side(z) /
+                     MVT_EXTENT, &level);
+      for (std::size_t i = 0; i < level.tiles.size(); ++i) {
+        if (i == 0 || level.tiles[i].x != level.tiles[i - 1].x) {
+          QDir().mkpath(tr("%1/%2/%3").arg(directory).arg(z)
+                                      .arg(level.tiles[i].x));
+        }
+      }
+      voronoi_parallel_for(level.tiles.size(), 16,
+                           [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+          const tile_pyramid_type::tile_key& tile = level.tiles[i];
+          coordinate_type txl, tyl, txh, tyh;
+          pyramid.tile_bounds(tile, &txl, &tyl, &txh, &tyh);
+          vector_tile_type vector_tile(txl, tyl, txh, tyh,
+                                       MVT_EXTENT, MVT_BUFFER);
+          const int layer_kinds[] = {TILE_SITE, TILE_SEGMENT, TILE_EDGE};
+          const char* layer_names[] = {"sites", "segments", "edges"};
+          for (int k = 0; k < 3; ++k) {
+            vector_tile.begin_layer(layer_names[k], layer_kinds[k] == TILE_EDGE ?
+                                    edge_properties : site_properties);
+            for (std::size_t j = level.item_start[i];
+                 j < level.item_start[i + 1]; ++j) {
+              std::size_t item = level.items[j];
+              int style = pyramid.item_style(item);
+              if ((style & TILE_KIND_MASK) != layer_kinds[k]) {
+                continue;
+              }
+              const coordinate_type* c = pyramid.item_coords(item);
+              if (layer_kinds[k] == TILE_SITE) {
+                vector_tile.add_point(c[0], c[1], 0);
+              } else {
+                vector_tile.add_polyline(c, pyramid.item_size(item),
+                                         edge_properties_mask(style));
+              }
+            }
+          }
+          if (vector_tile.empty()) {
+            continue;
+          }
+          std::string bytes = vector_tile.encode();
+          QString path = tr("%1/%2/%3/%4.mvt").arg(directory).arg(tile.z)
+              .arg(tile.x).arg(tile.y);
+          std::ofstream output(path.toStdString().c_str(),
+                               std::ios::out | std::ios::binary);
+          output.write(bytes.data(), bytes.size());
+          if (output) {
+            ++num_written;
+          }
+        }
+      });
+    }
+    return num_written;
+  }
+
+  // Writes the render geometry of the diagram for the zoom levels
+  // 0..max_zoom into a tile pack (see voronoi_tile_pack.hpp) that
+  // open_tile_pack shows. Only the edges shown in the viewer are written.
+  // Returns the number of tiles written.
+  std::size_t export_tile_pack(const QString& path, int max_zoom) {
+    if (is_building() || !brect_initialized_) {
+      return 0;
+    }
+    tile_pyramid_type pyramid(xl(brect_), yl(brect_),
+                              xh(brect_) - xl(brect_));
+    fill_tile_pyramid(false, &pyramid);
+    tile_pack_writer_type writer(PACK_EXTENT, PACK_BORDER, PACK_MIN_STRIP,
+                                 NUM_PACK_LAYERS);
+    if (!writer.open(path.toLocal8Bit().constData(), pyramid)) {
+      return 0;
+    }
+    for (int z = 0; z <= max_zoom; ++z) {
+      writer.add_level(pyramid, z, &tile_pack_layer);
+    }
+    return writer.close() ? writer.num_tiles() : 0;
+  }
+
+  // Shows a tile pack instead of a diagram. The pack is mapped, not read:
+  // the tiles in view are uploaded as they are needed and kept in a least
+  // recently used cache of PACK_CACHE_BUDGET bytes, the tiles ahead of the
+  // pan direction are prefetched. Drag to pan, use the wheel to zoom.
+  bool open_tile_pack(const QString& path) {
+    clear();
+    std::unique_ptr<voronoi_tile_pack> pack(new voronoi_tile_pack);
+    if (!pack->open(path.toLocal8Bit().constData())) {
+      QMessageBox::warning(
+          this, tr("Voronoi Visualizer"),
+          tr("Unable to open the tile pack ") + path);
+      emit build_finished();
+      return false;
+    }
+    tile_pack_.swap(pack);
+    file_path_ = path;
+    set_pack_view(tile_pack_->xl() + 0.5 * tile_pack_->side(),
+                  tile_pack_->yl() + 0.5 * tile_pack_->side(),
+                  tile_pack_->side());
+    emit build_finished();
+    return true;
+  }
+
+ signals:
+  void build_finished();
+  void status_changed(const QString& message);
+
+ protected:
+  void mousePressEvent(QMouseEvent* e) {
+    // Dragging pans the view unless it selects a region.
+    if (e->button() == Qt::LeftButton &&
+        (tile_pack_ || (!region_selection() && brect_initialized_))) {
+      panning_ = true;
+      pan_last_ = e->pos();
+      return;
+    }
+    if (!region_selection() || is_building() || !brect_initialized_ ||
+        e->button() != Qt::LeftButton) {
+      return;
+    }
+    selecting_ = true;
+    selection_start_ = to_world(e->pos());
+    set_points(selection_, selection_start_, selection_start_);
+  }
+
+  void mouseMoveEvent(QMouseEvent* e) {
+    if (panning_) {
+      point_type from = to_world(pan_last_);
+      point_type to = to_world(e->pos());
+      coordinate_type dx = from.x() - to.x();
+      coordinate_type dy = from.y() - to.y();
+      if (tile_pack_) {
+        coordinate_type length = std::sqrt(dx * dx + dy * dy);
+        if (length > 0) {
+          pan_direction_ = point_type(dx / length, dy / length);
+        }
+        set_pack_view(shift_.x() + dx, shift_.y() + dy, pack_view_side_);
+      } else {
+        set_view(0.5 * (xl(view_) + xh(view_)) + dx,
+                 0.5 * (yl(view_) + yh(view_)) + dy, xh(view_) - xl(view_));
+      }
+      pan_last_ = e->pos();
+    } else if (selecting_) {
+      set_points(selection_, selection_start_, to_world(e->pos()));
+    } else if (site_locator_ && !is_building()) {
+      point_type point = to_world(e->pos());
+      hovered_site_ = site_locator_->nearest_site(
+          point.x(), point.y(),
+          [this](std::size_t site) { return site_visible(site); });
+    }
+  }
+
+  void mouseReleaseEvent(QMouseEvent* e) {
+    if (panning_ && e->button() == Qt::LeftButton) {
+      panning_ = false;
+      return;
+    }
+    if (!selecting_ || e->button() != Qt::LeftButton) {
+      return;
+    }
+    selecting_ = false;
+    set_points(selection_, selection_start_, to_world(e->pos()));
+    if (xh(selection_) > xl(selection_) && yh(selection_) > yl(selection_)) {
+      build_region(selection_);
+    }
+  }
+
+  static QPoint wheel_position(const QWheelEvent* e) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return e->position().toPoint();
+#else
+    return e->pos();
+#endif
+  }
+
+  // Zooms the view around the cursor position.
+  void wheelEvent(QWheelEvent* e) {
+    coordinate_type factor = std::pow(2.0, -e->angleDelta().y() / 240.0);
+    if (!tile_pack_) {
+      if (!brect_initialized_) {
+        return;
+      }
+      coordinate_type side = xh(view_) - xl(view_);
+      coordinate_type full_side = xh(brect_) - xl(brect_);
+      side = (std::max)(full_side / MAX_VIEW_ZOOM,
+                        (std::min)(side * factor, full_side));
+      factor = side / (xh(view_) - xl(view_));
+      point_type anchor = to_world(wheel_position(e));
+      set_view(anchor.x() + (0.5 * (xl(view_) + xh(view_)) - anchor.x()) *
+                   factor,
+               anchor.y() + (0.5 * (yl(view_) + yh(view_)) - anchor.y()) *
+                   factor,
+               side);
+      return;
+    }
+    coordinate_type min_side =
+        tile_pack_->side() / (1 << tile_pack_->max_zoom()) / 16;
+    coordinate_type side = (std::max)(min_side, (std::min)(
+        pack_view_side_ * factor, 2 * tile_pack_->side()));
+    factor = side / pack_view_side_;
+    point_type anchor = to_world(wheel_position(e));
+    set_pack_view(anchor.x() + (shift_.x() - anchor.x()) * factor,
+                  anchor.y() + (shift_.y() - anchor.y()) * factor, side);
   }
 
  protected:
   void initializeGL() {
     initializeOpenGLFunctions();
+    // Instanced drawing is core in OpenGL 3.3 and OpenGL ES 3.0, older
+    // contexts may have it as extensions. The functions are resolved under
+    // the extension names as well.
+    QOpenGLContext* gl_context = context();
+    const QSurfaceFormat gl_format = gl_context->format();
+    if (gl_context->isOpenGLES()) {
+      instancing_ = gl_format.majorVersion() >= 3 ||
+          gl_context->hasExtension("GL_EXT_instanced_arrays") ||
+          gl_context->hasExtension("GL_ANGLE_instanced_arrays");
+    } else {
+      instancing_ = gl_format.majorVersion() > 3 ||
+          (gl_format.majorVersion() == 3 && gl_format.minorVersion() >= 3) ||
+          (gl_context->hasExtension("GL_ARB_instanced_arrays") &&
+           gl_context->hasExtension("GL_ARB_draw_instanced"));
+      // Point sizes of the glyph fallback come from the shader.
+      glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    }
     glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_BLEND);
@@ -128,6 +772,247 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
     assert(vertex_location_ >= 0);
     color_location_ = glGetUniformLocation(gl_program_, "color");
     assert(color_location_ >= 0);
+
+    GLuint glyph_vertex_shader =
+        prepare_shader(GL_VERTEX_SHADER, glyph_vertex_shader_code);
+    GLuint glyph_fragment_shader =
+        prepare_shader(GL_FRAGMENT_SHADER, fragment_shader_code);
+    glyph_program_ = glCreateProgram();
+    glAttachShader(glyph_program_, glyph_vertex_shader);
+    glAttachShader(glyph_program_, glyph_fragment_shader);
+    glLinkProgram(glyph_program_);
+    glDeleteShader(glyph_vertex_shader);
+    glDeleteShader(glyph_fragment_shader);
+    glyph_mvp_matrix_location_ =
+        glGetUniformLocation(glyph_program_, "mvpMatrix");
+    assert(glyph_mvp_matrix_location_ >= 0);
+    glyph_radius_location_ = glGetUniformLocation(glyph_program_, "radius");
+    assert(glyph_radius_location_ >= 0);
+    glyph_color_location_ = glGetUniformLocation(glyph_program_, "color");
+    assert(glyph_color_location_ >= 0);
+    glyph_offset_location_ = glGetAttribLocation(glyph_program_, "offset");
+    assert(glyph_offset_location_ >= 0);
+    glyph_center_location_ = glGetAttribLocation(glyph_program_, "center");
+    assert(glyph_center_location_ >= 0);
+
+    GLuint point_glyph_vertex_shader =
+        prepare_shader(GL_VERTEX_SHADER, point_glyph_vertex_shader_code);
+    GLuint point_glyph_fragment_shader =
+        prepare_shader(GL_FRAGMENT_SHADER, point_glyph_fragment_shader_code);
+    point_glyph_program_ = glCreateProgram();
+    glAttachShader(point_glyph_program_, point_glyph_vertex_shader);
+    glAttachShader(point_glyph_program_, point_glyph_fragment_shader);
+    glLinkProgram(point_glyph_program_);
+    glDeleteShader(point_glyph_vertex_shader);
+    glDeleteShader(point_glyph_fragment_shader);
+    point_glyph_mvp_matrix_location_ =
+        glGetUniformLocation(point_glyph_program_, "mvpMatrix");
+    assert(point_glyph_mvp_matrix_location_ >= 0);
+    point_glyph_size_location_ =
+        glGetUniformLocation(point_glyph_program_, "pointSize");
+    assert(point_glyph_size_location_ >= 0);
+    point_glyph_color_location_ =
+        glGetUniformLocation(point_glyph_program_, "color");
+    assert(point_glyph_color_location_ >= 0);
+    point_glyph_center_location_ =
+        glGetAttribLocation(point_glyph_program_, "center");
+    assert(point_glyph_center_location_ >= 0);
+
+    GLuint edge_vertex_shader =
+        prepare_shader(GL_VERTEX_SHADER, edge_vertex_shader_code);
+    GLuint edge_fragment_shader =
+        prepare_shader(GL_FRAGMENT_SHADER, edge_fragment_shader_code);
+    edge_program_ = glCreateProgram();
+    glAttachShader(edge_program_, edge_vertex_shader);
+    glAttachShader(edge_program_, edge_fragment_shader);
+    glLinkProgram(edge_program_);
+    glDeleteShader(edge_vertex_shader);
+    glDeleteShader(edge_fragment_shader);
+    edge_mvp_matrix_location_ =
+        glGetUniformLocation(edge_program_, "mvpMatrix");
+    assert(edge_mvp_matrix_location_ >= 0);
+    edge_viewport_size_location_ =
+        glGetUniformLocation(edge_program_, "viewportSize");
+    assert(edge_viewport_size_location_ >= 0);
+    edge_pixels_per_unit_location_ =
+        glGetUniformLocation(edge_program_, "pixelsPerUnit");
+    assert(edge_pixels_per_unit_location_ >= 0);
+    edge_style_colors_location_ =
+        glGetUniformLocation(edge_program_, "styleColors");
+    assert(edge_style_colors_location_ >= 0);
+    edge_style_strokes_location_ =
+        glGetUniformLocation(edge_program_, "styleStrokes");
+    assert(edge_style_strokes_location_ >= 0);
+    edge_corner_location_ = glGetAttribLocation(edge_program_, "corner");
+    assert(edge_corner_location_ >= 0);
+    edge_start_location_ = glGetAttribLocation(edge_program_, "start");
+    assert(edge_start_location_ >= 0);
+    edge_end_location_ = glGetAttribLocation(edge_program_, "end");
+    assert(edge_end_location_ >= 0);
+    edge_category_location_ = glGetAttribLocation(edge_program_, "category");
+    assert(edge_category_location_ >= 0);
+    edge_arc_length_location_ =
+        glGetAttribLocation(edge_program_, "arcLength");
+    assert(edge_arc_length_location_ >= 0);
+
+    // Quad of a line piece: along the piece from 0 to 1, across it from
+    // -1 to 1, drawn as a triangle strip.
+    static const GLfloat edge_corners[] = {
+      0.f, -1.f,
+      1.f, -1.f,
+      0.f,  1.f,
+      1.f,  1.f,
+    };
+    glGenBuffers(1, &edge_corner_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, edge_corner_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(edge_corners), edge_corners,
+                 GL_STATIC_DRAW);
+
+    // Unit circle drawn as a triangle fan around its center.
+    static constexpr size_t boundary_point_count = 20;
+    static constexpr float angle_increment =
+        2 * 3.14159265358979323846 / boundary_point_count;
+    std::vector<GLPoint> circle;
+    circle.reserve(boundary_point_count + 2);
+    circle.emplace_back(0.f, 0.f);
+    for (size_t i = 0; i <= boundary_point_count; ++i) {
+      const float angle = angle_increment * i;
+      circle.emplace_back(std::sin(angle), std::cos(angle));
+    }
+    glGenBuffers(1, &gl_circle_.id_);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_circle_.id_);
+    glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(GLPoint), circle.data(), GL_STATIC_DRAW);
+    gl_circle_.vertex_count_ = circle.size();
+
+    GLuint texture_vertex_shader =
+        prepare_shader(GL_VERTEX_SHADER, texture_vertex_shader_code);
+    GLuint texture_fragment_shader =
+        prepare_shader(GL_FRAGMENT_SHADER, texture_fragment_shader_code);
+    texture_program_ = glCreateProgram();
+    glAttachShader(texture_program_, texture_vertex_shader);
+    glAttachShader(texture_program_, texture_fragment_shader);
+    glLinkProgram(texture_program_);
+    glDeleteShader(texture_vertex_shader);
+    glDeleteShader(texture_fragment_shader);
+    texture_vertex_location_ =
+        glGetAttribLocation(texture_program_, "position");
+    assert(texture_vertex_location_ >= 0);
+    texture_coord_location_ =
+        glGetAttribLocation(texture_program_, "texCoord");
+    assert(texture_coord_location_ >= 0);
+    sampler_location_ = glGetUniformLocation(texture_program_, "sampler");
+    assert(sampler_location_ >= 0);
+
+    // Quad covering the whole view port, drawn as a triangle strip.
+    static const GLfloat quad[] = {
+      -1.f, -1.f, 0.f, 0.f,
+       1.f, -1.f, 1.f, 0.f,
+      -1.f,  1.f, 0.f, 1.f,
+       1.f,  1.f, 1.f, 1.f,
+    };
+    glGenBuffers(1, &quad_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    GLuint label_vertex_shader =
+        prepare_shader(GL_VERTEX_SHADER, label_vertex_shader_code);
+    GLuint label_fragment_shader =
+        prepare_shader(GL_FRAGMENT_SHADER, label_fragment_shader_code);
+    label_program_ = glCreateProgram();
+    glAttachShader(label_program_, label_vertex_shader);
+    glAttachShader(label_program_, label_fragment_shader);
+    glLinkProgram(label_program_);
+    glDeleteShader(label_vertex_shader);
+    glDeleteShader(label_fragment_shader);
+    label_mvp_matrix_location_ =
+        glGetUniformLocation(label_program_, "mvpMatrix");
+    assert(label_mvp_matrix_location_ >= 0);
+    label_origin_location_ = glGetUniformLocation(label_program_, "origin");
+    assert(label_origin_location_ >= 0);
+    label_advance_location_ = glGetUniformLocation(label_program_, "advance");
+    assert(label_advance_location_ >= 0);
+    label_cell_size_location_ =
+        glGetUniformLocation(label_program_, "cellSize");
+    assert(label_cell_size_location_ >= 0);
+    label_atlas_grid_location_ =
+        glGetUniformLocation(label_program_, "atlasGrid");
+    assert(label_atlas_grid_location_ >= 0);
+    label_sampler_location_ = glGetUniformLocation(label_program_, "atlas");
+    assert(label_sampler_location_ >= 0);
+    label_color_location_ = glGetUniformLocation(label_program_, "color");
+    assert(label_color_location_ >= 0);
+    label_halo_color_location_ =
+        glGetUniformLocation(label_program_, "haloColor");
+    assert(label_halo_color_location_ >= 0);
+    label_smoothing_location_ =
+        glGetUniformLocation(label_program_, "smoothing");
+    assert(label_smoothing_location_ >= 0);
+    label_corner_location_ = glGetAttribLocation(label_program_, "corner");
+    assert(label_corner_location_ >= 0);
+    label_glyph_location_ = glGetAttribLocation(label_program_, "glyph");
+    assert(label_glyph_location_ >= 0);
+
+    // Unit quad of a character, drawn as a triangle strip.
+    static const GLfloat corners[] = {
+      0.f, 0.f,
+      1.f, 0.f,
+      0.f, 1.f,
+      1.f, 1.f,
+    };
+    glGenBuffers(1, &label_corner_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, label_corner_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glGenBuffers(1, &label_vbo_);
+    prepare_label_atlas();
+  }
+
+  // Rasterizes the printable ASCII characters of a monospace font and
+  // uploads their distance fields as the label atlas texture.
+  void prepare_label_atlas() {
+    voronoi_glyph_atlas atlas(LABEL_CELL_WIDTH, LABEL_CELL_HEIGHT,
+                              LABEL_ATLAS_COLUMNS, LABEL_SPREAD);
+    const int scale = LABEL_RASTER_SCALE;
+    QFont font(tr("monospace"));
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPixelSize(LABEL_FONT_TEXELS * scale);
+    QFontMetricsF metrics(font);
+    // Every glyph is centered in its cell, on a common baseline.
+    const qreal baseline = 0.5 * (LABEL_CELL_HEIGHT * scale +
+                                  metrics.ascent() - metrics.descent());
+    QImage image(LABEL_CELL_WIDTH * scale, LABEL_CELL_HEIGHT * scale,
+                 QImage::Format_Grayscale8);
+    std::vector<unsigned char> coverage(
+        static_cast<std::size_t>(image.width()) * image.height());
+    for (int i = 0; i < voronoi_glyph_atlas::NUM_GLYPHS; ++i) {
+      char c = static_cast<char>(voronoi_glyph_atlas::FIRST_CHAR + i);
+      QString text = QString::fromLatin1(&c, 1);
+      image.fill(QColor(0, 0, 0));
+      QPainter painter(&image);
+      painter.setRenderHint(QPainter::Antialiasing);
+      painter.setFont(font);
+      painter.setPen(QColor(255, 255, 255));
+      painter.drawText(QPointF(0.5 * (image.width() -
+                                      metrics.horizontalAdvance(text)),
+                               baseline), text);
+      painter.end();
+      for (int j = 0; j < image.height(); ++j) {
+        std::copy(image.constScanLine(j), image.constScanLine(j) + image.width(),
+                  coverage.begin() + static_cast<std::size_t>(j) * image.width());
+      }
+      atlas.set_glyph(c, coverage.data(), scale);
+    }
+    label_advance_ = metrics.horizontalAdvance(tr("0")) / scale;
+
+    glGenTextures(1, &label_atlas_texture_);
+    glBindTexture(GL_TEXTURE_2D, label_atlas_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, atlas.width(), atlas.height(), 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, atlas.texels().data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   }
 
   GLuint prepare_shader(GLenum type, const char* shader_code) {
@@ -152,20 +1037,72 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   }
 
   void paintGL() {
+    delete_retired_buffers();
     glClearColor(1.f, 1.f, 1.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    draw_points();
-    draw_segments();
-    draw_vertices();
-    draw_edges();
+    glViewport(viewport_x_, viewport_y_, viewport_side_, viewport_side_);
+    if (tile_pack_) {
+      draw_tile_pack();
+    } else if (is_building()) {
+      draw_preview();
+    } else {
+      clear_preview_texture();
+      // The diagram only changes on a rebuild or a view change, so it is
+      // rendered once into a texture and every other frame is a single
+      // textured quad plus the overlays.
+      if (static_layer_dirty_) {
+        render_static_layer();
+      }
+      draw_texture(static_layer_->texture());
+      draw_hovered_site();
+      draw_site_labels();
+    }
+    if (selecting_) {
+      draw_selection();
+    }
   }
 
   void resizeGL(int width, int height) {
-    int side = qMin(width, height);
-    glViewport((width - side) / 2, (height - side) / 2, side, side);
+    viewport_side_ = qMin(width, height);
+    viewport_x_ = (width - viewport_side_) / 2;
+    viewport_y_ = (height - viewport_side_) / 2;
+    glViewport(viewport_x_, viewport_y_, viewport_side_, viewport_side_);
+    static_layer_dirty_ = true;
+    labels_dirty_ = true;
   }
 
   void timerEvent(QTimerEvent* e) {
+    if (startup_future_.valid() &&
+        startup_future_.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready) {
+      adopt_startup_build(startup_future_.get());
+    }
+    if (build_future_.valid() &&
+        build_future_.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready) {
+      collect_build();
+      edge_filter_dirty_ = true;
+      labels_dirty_ = true;
+      if (telemetry_ready_) {
+        print_builder_telemetry();
+        telemetry_ready_ = false;
+      }
+      static_layer_dirty_ = true;
+      emit build_finished();
+    } else {
+      if (pool_stats_.allocations_ != reported_allocations_) {
+        report_pool_stats();
+      }
+      // Once the first diagram is drawn, its timing replaces the pool
+      // statistics of the same frame.
+      if (startup_diagram_ms_ > 0) {
+        emit status_changed(
+            tr("Startup: input read after %1 ms, first diagram after %2 ms.")
+                .arg(startup_input_ms_, 0, 'f', 1)
+                .arg(startup_diagram_ms_, 0, 'f', 1));
+        startup_diagram_ms_ = 0;
+      }
+    }
     update();
   }
 
@@ -174,8 +1111,12 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   typedef point_data<coordinate_type> point_type;
   typedef segment_data<coordinate_type> segment_type;
   typedef rectangle_data<coordinate_type> rect_type;
-  typedef voronoi_builder<int> VB;
+  typedef detail::voronoi_ctype_traits<int> CTT;
+  // Builder whose beach line and circle event nodes come from node_pool_.
+  typedef voronoi_instrumented_builder<int, CTT, detail::voronoi_predicates<CTT>,
+                                       voronoi_pool_allocator<char> > VB;
   typedef voronoi_diagram<coordinate_type> VD;
+  typedef voronoi_instrumented_builder<int> instrumented_builder_type;
   typedef VD::cell_type cell_type;
   typedef VD::cell_type::source_index_type source_index_type;
   typedef VD::cell_type::source_category_type source_category_type;
@@ -188,17 +1129,267 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   typedef VD::const_edge_iterator const_edge_iterator;
 
   static const std::size_t EXTERNAL_COLOR = 1;
+  static const std::size_t UNRELIABLE_COLOR = 2;
+
+  // Flag bits and numeric columns of edge_attributes_.
+  enum edge_flag {
+    EDGE_PRIMARY = 0,
+    EDGE_INTERNAL = 1,
+    EDGE_CURVED = 2,
+    EDGE_INFINITE = 3,
+    EDGE_UNRELIABLE = 4,
+    // Flags layer0, layer1, ... of the layers of the two sites.
+    EDGE_LAYER0 = 5
+  };
+  enum edge_column {
+    EDGE_LENGTH = 0,
+    EDGE_CLEARANCE = 1
+  };
+
+  // Edge categories of the edge layer, the rows of the edge style table.
+  // The strip ends take the hidden row, see edge_vertex_shader_code.
+  enum edge_category {
+    CATEGORY_PRIMARY = 0,
+    CATEGORY_SECONDARY = 1,
+    CATEGORY_CURVED = 2,
+    CATEGORY_INFINITE = 3,
+    CATEGORY_UNRELIABLE = 4,
+    // Colored by layer: the edges between two layers and the first of the
+    // layer colors, which repeat for the layers past NUM_LAYER_COLORS.
+    CATEGORY_LAYER_BOUNDARY = 5,
+    CATEGORY_HIDDEN = 7,
+    CATEGORY_LAYER = 8,
+    NUM_LAYER_COLORS = 8,
+    NUM_EDGE_STYLES = 16
+  };
+
+  // Color, width in pixels and dash pattern of an edge category; the gap
+  // is zero for solid lines.
+  struct edge_style {
+    std::array<float, 4> color;
+    float width;
+    float dash;
+    float gap;
+  };
+
+  // Files of a layered build at most, every layer has an edge flag.
+  static const int MAX_LAYERS = 16;
+
+  // Guard band loaded around the selected region, relative to its size.
+  static constexpr coordinate_type GUARD_BAND = 0.25;
+
+  // View port side the render layers are quantized for, in pixels. A
+  // quantization step is a pixel of a view port this wide at MAX_VIEW_ZOOM,
+  // render positions are rounded to half a step.
+  static const int QUANTIZATION_VIEWPORT_SIDE = 4096;
+
+  typedef voronoi_quantized_layer<coordinate_type> quantized_layer_type;
+
+  // Map tile export: tile size and the styles of the tile items. The pad
+  // covers the widest line and the site dots, in pixels. A style is the
+  // item kind combined with the edge flags.
+  typedef voronoi_tile_pyramid<coordinate_type> tile_pyramid_type;
+  static const int TILE_SIZE = 256;
+  static constexpr coordinate_type TILE_PAD = 3.0;
+  enum tile_style {
+    TILE_SITE = 0,
+    TILE_SEGMENT = 1,
+    TILE_EDGE = 2,
+    TILE_KIND_MASK = 3,
+    TILE_PRIMARY = 4,
+    TILE_INTERNAL = 8,
+    TILE_CURVED = 16,
+    TILE_UNRELIABLE = 32
+  };
+
+  // Vector tile export: grid size of a tile and the border kept around it.
+  typedef voronoi_vector_tile<coordinate_type> vector_tile_type;
+  static const int MVT_EXTENT = 4096;
+  static const int MVT_BUFFER = 64;
+
+  // Tile packs: quantization steps per tile side, the border kept around
+  // a tile and the smallest strip kept, in steps. Tiles are shown at about
+  // TILE_SIZE pixels, so the strips below a pixel are dropped.
+  typedef voronoi_tile_pack_writer<coordinate_type> tile_pack_writer_type;
+  static const int PACK_EXTENT = 4096;
+  static const int PACK_BORDER = 64;
+  static const int PACK_MIN_STRIP = PACK_EXTENT / TILE_SIZE;
+  enum pack_layer {
+    PACK_SITES = 0,
+    PACK_SEGMENTS = 1,
+    PACK_EDGES = 2,
+    PACK_UNRELIABLE_EDGES = 3,
+    NUM_PACK_LAYERS = 4
+  };
+  // GPU memory of the paged tiles and the tiles uploaded per frame; the
+  // tiles not uploaded yet are drawn from a cached coarser tile meanwhile.
+  static const std::size_t PACK_CACHE_BUDGET = 256 << 20;
+  static const int PACK_UPLOADS_PER_FRAME = 8;
+
+  // Zoom of the diagram view at most. The layers are quantized for the
+  // whole diagram at this zoom, see QUANTIZATION_VIEWPORT_SIDE.
+  static constexpr coordinate_type MAX_VIEW_ZOOM = 32;
+
+  // Site labels: the glyph cells and the font size in atlas texels, the
+  // distance range around the outlines in texels, the raster scale of the
+  // glyphs for the distance transform and the font size on screen. The
+  // sites are labeled if there are at most MAX_LABELED_SITES in view and
+  // LABEL_AREA square pixels for every one of them.
+  static const int LABEL_CELL_WIDTH = 24;
+  static const int LABEL_CELL_HEIGHT = 32;
+  static const int LABEL_ATLAS_COLUMNS = 16;
+  static constexpr float LABEL_FONT_TEXELS = 20.0f;
+  static constexpr float LABEL_SPREAD = 4.0f;
+  static const int LABEL_RASTER_SCALE = 4;
+  static constexpr float LABEL_FONT_SIZE = 12.0f;
+  static constexpr std::size_t MAX_LABELED_SITES = 4096;
+  static const std::size_t LABEL_AREA = 48 * 48;
+
+  // Maps a widget position to the input coordinates.
+  point_type to_world(const QPoint& pos) const {
+    const int side = (std::max)(qMin(width(), height()), 1);
+    const coordinate_type clip_x =
+        2.0 * (pos.x() - (width() - side) / 2) / side - 1.0;
+    const coordinate_type clip_y =
+        1.0 - 2.0 * (pos.y() - (height() - side) / 2) / side;
+    point_type view(
+        (clip_x - projection_matrix_[12]) / projection_matrix_[0],
+        (clip_y - projection_matrix_[13]) / projection_matrix_[5]);
+    return convolve(view, shift_);
+  }
+
+  // Builds the diagram of the sites inside the given region of the last
+  // built file, plus a guard band around it. The sites are streamed using
+  // the spatial index stored next to the file, so the cost depends on the
+  // region size rather than the file size.
+  void build_region(const rect_type& region) {
+    QString file_path = file_path_;
+    clear();
+    file_path_ = file_path;
+
+    rect_type guarded = region;
+    coordinate_type guard = GUARD_BAND * (std::max)(
+        xh(region) - xl(region), yh(region) - yl(region));
+    bloat(guarded, (std::max)(std::ceil(guard), coordinate_type(1)));
+    region_build_ = true;
+    region_ = guarded;
+    read_region(file_path, guarded);
+
+    start_build();
+  }
+
+  void start_build() {
+    // No data, don't proceed.
+    if (!brect_initialized_) {
+      emit build_finished();
+      return;
+    }
+
+    // Construct bounding rectangle.
+    construct_brect();
+
+    // Update view port.
+    view_ = brect_;
+    update_view_port();
+
+    // Show the raster approximation until the exact diagram is ready.
+    prepare_site_locator();
+    if (!diagram_preloaded_) {
+      prepare_preview();
+    }
+
+    // Construct voronoi diagram on a worker thread. The input containers
+    // and the diagram are not touched by the GUI thread until the build
+    // is collected in timerEvent.
+    // The options are read once here, the GUI thread may toggle them while
+    // the build runs.
+    bool winding_classifier = winding_classifier_;
+    bool record_telemetry = record_telemetry_;
+    build_future_ = std::async(std::launch::async,
+                               [this, winding_classifier, record_telemetry]() {
+      construct_diagram(winding_classifier, record_telemetry);
+    });
+  }
+
+  // Waits for the build job. A failed build, such as one that ran out of
+  // memory, is reported and leaves an empty diagram behind.
+  void collect_build() {
+    try {
+      build_future_.get();
+    } catch (const std::exception& e) {
+      vd_->clear();
+      QMessageBox::warning(
+          this, tr("Voronoi Visualizer"),
+          tr("Unable to build the Voronoi diagram: ") +
+          QString::fromLocal8Bit(e.what()));
+    }
+  }
+
+  void adopt_startup_build(std::unique_ptr<startup_build> startup) {
+    if (!startup->ok) {
+      QMessageBox::warning(
+          this, tr("Voronoi Visualizer"),
+          tr("Unable to read ") + file_path_);
+      emit build_finished();
+      return;
+    }
+    point_data_.swap(startup->points);
+    segment_data_.swap(startup->segments);
+    vd_.swap(startup->vd);
+    for (std::size_t i = 0; i < point_data_.size(); ++i) {
+      update_brect(point_data_[i]);
+    }
+    for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+      update_brect(low(segment_data_[i]));
+      update_brect(high(segment_data_[i]));
+    }
+    startup_input_ms_ = startup->input_ms;
+    report_startup_ = true;
+    diagram_preloaded_ = true;
+    retirement_queue_.retire(std::move(startup));
+    start_build();
+  }
 
   void clear() {
+    // Let the previous build finish before its data is released.
+    if (startup_future_.valid()) {
+      retirement_queue_.retire(startup_future_.get());
+    }
+    if (build_future_.valid()) {
+      collect_build();
+    }
+    diagram_preloaded_ = false;
+    // The containers are handed over to the retirement thread, freeing
+    // them would delay the next build.
+    retirement_queue_.retire(std::move(preview_pixels_));
+    preview_pixels_.clear();
+    retirement_queue_.retire(std::move(site_locator_));
+    hovered_site_ = site_locator_type::NO_SITE;
+    static_layer_dirty_ = true;
+    labels_dirty_ = true;
+
     brect_initialized_ = false;
+    retirement_queue_.retire(std::move(point_data_));
     point_data_.clear();
+    retirement_queue_.retire(std::move(segment_data_));
     segment_data_.clear();
-    vd_.clear();
-
-    clear_vbo_array(gl_points_);
-    clear_vbo(gl_segments_);
-    clear_vbo_array(gl_vertices_);
-    clear_vbo_array(gl_edges_);
+    site_layers_.clear();
+    visible_layers_ = ~0u;
+    site_points_dirty_ = false;
+    retirement_queue_.retire(std::move(vd_));
+    vd_.reset(new VD);
+    edge_attributes_.clear();
+    edge_filter_dirty_ = true;
+
+    retirement_queue_.retire(std::move(site_layer_));
+    site_layer_ = quantized_layer_type();
+    clear_layer(gl_points_);
+    clear_layer(gl_segments_);
+    clear_layer(gl_vertices_);
+    clear_layer(gl_edges_);
+    reset_pool();
+    region_build_ = false;
+    close_tile_pack();
   }
 
   void read_data(const QString& file_path) {
@@ -230,6 +1421,350 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
     in_stream.flush();
   }
 
+  // Reads the files in parallel and appends their sites file after file,
+  // the points before the segments as in the source indices of the
+  // cells, keeping the layer of every site.
+  void read_layers(const QStringList& file_paths) {
+    if (file_paths.size() > MAX_LAYERS) {
+      QMessageBox::warning(
+          this, tr("Voronoi Visualizer"),
+          tr("At most %1 files can be built as layers").arg(MAX_LAYERS));
+      return;
+    }
+    struct layer_input {
+      std::vector<point_type> points;
+      std::vector<segment_type> segments;
+      bool ok;
+    };
+    std::vector<std::string> paths;
+    for (const QString& path : file_paths) {
+      paths.push_back(path.toLocal8Bit().constData());
+    }
+    std::vector<layer_input> layers(paths.size());
+    voronoi_parallel_for(layers.size(), 1,
+                         [&](std::size_t first, std::size_t last) {
+      for (std::size_t i = first; i < last; ++i) {
+        std::ifstream in(paths[i].c_str());
+        layers[i].ok = in && read_voronoi_input(in, &layers[i].points,
+                                                &layers[i].segments);
+      }
+    });
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+      if (!layers[i].ok) {
+        QMessageBox::warning(
+            this, tr("Voronoi Visualizer"),
+            tr("Unable to read ") + file_paths[static_cast<int>(i)]);
+        return;
+      }
+    }
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+      point_data_.insert(point_data_.end(), layers[i].points.begin(),
+                         layers[i].points.end());
+      site_layers_.insert(site_layers_.end(), layers[i].points.size(),
+                          static_cast<unsigned char>(i));
+    }
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+      segment_data_.insert(segment_data_.end(), layers[i].segments.begin(),
+                           layers[i].segments.end());
+      site_layers_.insert(site_layers_.end(), layers[i].segments.size(),
+                          static_cast<unsigned char>(i));
+    }
+    for (std::size_t i = 0; i < point_data_.size(); ++i) {
+      update_brect(point_data_[i]);
+    }
+    for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+      update_brect(low(segment_data_[i]));
+      update_brect(high(segment_data_[i]));
+    }
+  }
+
+  // Layer of the input site, indexed as the source indices of the cells.
+  // Single file builds are layer 0.
+  unsigned site_layer(std::size_t site) const {
+    return site_layers_.empty() ? 0 : site_layers_[site];
+  }
+
+  bool site_visible(std::size_t site) const {
+    return (visible_layers_ >> site_layer(site)) & 1;
+  }
+
+  // Bits of the layers of the two sites that generate the edge.
+  boost::uint32_t edge_layers(const edge_type& edge) const {
+    return (1u << site_layer(edge.cell()->source_index())) |
+           (1u << site_layer(edge.twin()->cell()->source_index()));
+  }
+
+  // Regions are read from the spatial index of a single file.
+  bool region_selection() const {
+    return region_only_ && site_layers_.empty();
+  }
+
+  void read_region(const QString& file_path, const rect_type& region) {
+    voronoi_region_index index;
+    std::string path = file_path.toLocal8Bit().constData();
+    if (!index.open(path) ||
+        !index.load(static_cast<int>(xl(region)), static_cast<int>(yl(region)),
+                    static_cast<int>(xh(region)), static_cast<int>(yh(region)),
+                    &point_data_, &segment_data_)) {
+      QMessageBox::warning(
+          this, tr("Voronoi Visualizer"),
+          tr("Unable to read the region index of ") + file_path);
+      return;
+    }
+    for (std::size_t i = 0; i < point_data_.size(); ++i) {
+      update_brect(point_data_[i]);
+    }
+    for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+      update_brect(low(segment_data_[i]));
+      update_brect(high(segment_data_[i]));
+    }
+  }
+
+  // Runs on the build thread.
+  void construct_diagram(bool winding_classifier, bool record_telemetry) {
+    prepare_site_points();
+
+    // Construct voronoi diagram, unless the startup build did it already.
+    if (!diagram_preloaded_) {
+      if (record_telemetry) {
+        construct_with(&instrumented_builder_, point_data_, segment_data_,
+                       vd_.get());
+        telemetry_ = instrumented_builder_.telemetry();
+        telemetry_ready_ = true;
+      } else {
+        construct_with(&vb_, point_data_, segment_data_, vd_.get());
+      }
+    }
+
+    // Color exterior edges.
+    if (winding_classifier) {
+      color_exterior_by_winding_numbers();
+    } else {
+      for (const_edge_iterator it = vd_->edges().begin();
+           it != vd_->edges().end(); ++it) {
+        if (!it->is_finite()) {
+          color_exterior(&(*it));
+        }
+      }
+    }
+
+    if (region_build_) {
+      color_unreliable();
+    }
+
+    prepare_edge_attributes();
+  }
+
+  // Fills the edge attribute columns of the filter, one row per half edge:
+  // the primary, internal, curved, infinite, unreliable and layer flags, the
+  // length (infinite for the infinite edges) and the clearance, the
+  // smallest distance from a point of the edge to the sites of its cells.
+  void prepare_edge_attributes() {
+    const edge_container_type& edges = vd_->edges();
+    edge_attributes_.resize(edges.size());
+    voronoi_attribute_table::flags_type* flags = edge_attributes_.flags();
+    float* length = edge_attributes_.column(EDGE_LENGTH);
+    float* clearance = edge_attributes_.column(EDGE_CLEARANCE);
+    voronoi_parallel_for(edges.size(), 4096,
+                         [&](std::size_t first, std::size_t last) {
+      std::vector<point_type> samples;
+      for (std::size_t i = first; i < last; ++i) {
+        const edge_type& edge = edges[i];
+        voronoi_attribute_table::flags_type edge_flags = 0;
+        if (edge.is_primary()) {
+          edge_flags |= 1 << EDGE_PRIMARY;
+        }
+        if (!(edge.color() & EXTERNAL_COLOR)) {
+          edge_flags |= 1 << EDGE_INTERNAL;
+        }
+        if (edge.is_curved()) {
+          edge_flags |= 1 << EDGE_CURVED;
+        }
+        if (!edge.is_finite()) {
+          edge_flags |= 1 << EDGE_INFINITE;
+        }
+        if (edge.color() & UNRELIABLE_COLOR) {
+          edge_flags |= 1 << EDGE_UNRELIABLE;
+        }
+        edge_flags |= edge_layers(edge) << EDGE_LAYER0;
+        flags[i] = edge_flags;
+        samples.clear();
+        sample_edge(edge, &samples);
+        coordinate_type edge_length = 0;
+        for (std::size_t j = 1; j < samples.size(); ++j) {
+          edge_length += euclidean_distance(samples[j - 1], samples[j]);
+        }
+        length[i] = edge.is_finite() ?
+            static_cast<float>(edge_length) :
+            std::numeric_limits<float>::infinity();
+        clearance[i] = static_cast<float>(edge_clearance(edge, samples));
+      }
+    });
+  }
+
+  // Clearance of the edge given its polyline. Edges of two segments are
+  // linear and the distance to the segments changes linearly along them,
+  // otherwise the distance to a point site is measured along the polyline.
+  coordinate_type edge_clearance(const edge_type& edge,
+                                 const std::vector<point_type>& samples) {
+    const cell_type& cell = *edge.cell();
+    const cell_type& twin_cell = *edge.twin()->cell();
+    if (cell.contains_segment() && twin_cell.contains_segment()) {
+      segment_type segment = retrieve_segment(cell);
+      return (std::min)(euclidean_distance(segment, samples.front()),
+                        euclidean_distance(segment, samples.back()));
+    }
+    point_type site = retrieve_point(cell.contains_point() ? cell : twin_cell);
+    coordinate_type clearance = euclidean_distance(samples.front(), site);
+    for (std::size_t j = 1; j < samples.size(); ++j) {
+      // Zero length pieces are measured as points.
+      if (samples[j - 1] != samples[j]) {
+        clearance = (std::min)(clearance, euclidean_distance(
+            segment_type(samples[j - 1], samples[j]), site));
+      }
+    }
+    return clearance;
+  }
+
+  // Rows of the edges passing the edge filter, or NULL if there is none.
+  const std::vector<voronoi_attribute_filter::index_type>* filtered_edges() {
+    if (edge_filter_.empty()) {
+      return NULL;
+    }
+    if (edge_filter_dirty_) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      edge_filter_.select(edge_attributes_, &filtered_edges_);
+      emit status_changed(tr("Edge filter: %1 of %2 edges in %3 ms.")
+                          .arg(filtered_edges_.size())
+                          .arg(edge_attributes_.size())
+                          .arg(milliseconds_since(start), 0, 'f', 1));
+      edge_filter_dirty_ = false;
+    }
+    return &filtered_edges_;
+  }
+
+  // Collects the input points and the segment endpoints without
+  // duplicates. In closed polygons every endpoint is shared by two
+  // segments, so this halves the number of site glyphs at least.
+  void prepare_site_points() {
+    std::vector<point_type> sites;
+    sites.reserve(point_data_.size() + 2 * segment_data_.size());
+    for (std::size_t i = 0; i < point_data_.size(); ++i) {
+      if (site_visible(i)) {
+        sites.push_back(point_data_[i]);
+      }
+    }
+    for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+      if (site_visible(point_data_.size() + i)) {
+        sites.push_back(low(segment_data_[i]));
+        sites.push_back(high(segment_data_[i]));
+      }
+    }
+    voronoi_parallel_sort(sites.begin(), sites.end(),
+                          [](const point_type& lhs, const point_type& rhs) {
+      return lhs.x() < rhs.x() || (lhs.x() == rhs.x() && lhs.y() < rhs.y());
+    });
+    sites.erase(std::unique(sites.begin(), sites.end()), sites.end());
+    site_layer_ = new_layer();
+    for (std::size_t i = 0; i < sites.size(); ++i) {
+      point_type site = deconvolve(sites[i], shift_);
+      site_layer_.add_point(site.x(), site.y());
+    }
+  }
+
+  // Alternative to color_exterior that does not depend on connectivity to
+  // the infinite edges, so the regions enclosed by holes are classified as
+  // exterior as well. Every vertex is located against the input polygons
+  // independently, in parallel. An edge is exterior if it is infinite or
+  // one of its vertices is outside; edges connecting two boundary vertices
+  // are decided by their midpoint.
+  void color_exterior_by_winding_numbers() {
+    typedef voronoi_interior_classifier<coordinate_type> classifier_type;
+    const classifier_type classifier(
+        segment_data_, 1E-9 * (xh(brect_) - xl(brect_)));
+    const VD::vertex_container_type& vertices = vd_->vertices();
+    std::vector<unsigned char> locations(vertices.size());
+    voronoi_parallel_for(vertices.size(), 4096,
+                         [&](std::size_t first, std::size_t last) {
+      for (std::size_t i = first; i < last; ++i) {
+        locations[i] = classifier.locate(vertices[i].x(), vertices[i].y());
+        if (locations[i] == classifier_type::OUTSIDE) {
+          vertices[i].color(vertices[i].color() | EXTERNAL_COLOR);
+        }
+      }
+    });
+    const VD::edge_container_type& edges = vd_->edges();
+    voronoi_parallel_for(edges.size(), 4096,
+                         [&](std::size_t first, std::size_t last) {
+      for (std::size_t i = first; i < last; ++i) {
+        const edge_type& edge = edges[i];
+        bool external = !edge.is_finite();
+        if (!external) {
+          unsigned char l0 = locations[edge.vertex0() - &vertices[0]];
+          unsigned char l1 = locations[edge.vertex1() - &vertices[0]];
+          if (l0 == classifier_type::OUTSIDE ||
+              l1 == classifier_type::OUTSIDE) {
+            external = true;
+          } else if (l0 == classifier_type::BOUNDARY &&
+                     l1 == classifier_type::BOUNDARY) {
+            external = classifier.locate(
+                0.5 * (edge.vertex0()->x() + edge.vertex1()->x()),
+                0.5 * (edge.vertex0()->y() + edge.vertex1()->y())) ==
+                classifier_type::OUTSIDE;
+          }
+        }
+        if (external) {
+          edge.color(edge.color() | EXTERNAL_COLOR);
+        }
+      }
+    });
+  }
+
+  // Flags the edges that sites excluded from a region build could change.
+  // A Voronoi vertex is certain if its empty circle lies inside the loaded
+  // region: every excluded site lies outside of it and therefore farther
+  // away than the sites defining the vertex. An edge is certain if both
+  // of its vertices are.
+  void color_unreliable() {
+    for (const_vertex_iterator it = vd_->vertices().begin();
+         it != vd_->vertices().end(); ++it) {
+      point_type vertex(it->x(), it->y());
+      coordinate_type radius =
+          site_distance(*it->incident_edge()->cell(), vertex);
+      if (it->x() - radius < xl(region_) || it->x() + radius > xh(region_) ||
+          it->y() - radius < yl(region_) || it->y() + radius > yh(region_)) {
+        it->color(it->color() | UNRELIABLE_COLOR);
+      }
+    }
+    for (const_edge_iterator it = vd_->edges().begin();
+         it != vd_->edges().end(); ++it) {
+      if (!it->is_finite() ||
+          (it->vertex0()->color() & UNRELIABLE_COLOR) ||
+          (it->vertex1()->color() & UNRELIABLE_COLOR)) {
+        it->color(it->color() | UNRELIABLE_COLOR);
+      }
+    }
+  }
+
+  // Distance from the point to the input site of the cell.
+  coordinate_type site_distance(const cell_type& cell,
+                                const point_type& point) {
+    if (cell.contains_point()) {
+      return euclidean_distance(retrieve_point(cell), point);
+    }
+    segment_type segment = retrieve_segment(cell);
+    coordinate_type dx = high(segment).x() - low(segment).x();
+    coordinate_type dy = high(segment).y() - low(segment).y();
+    coordinate_type t = ((point.x() - low(segment).x()) * dx +
+                         (point.y() - low(segment).y()) * dy) /
+                        (dx * dx + dy * dy);
+    t = (std::max)(coordinate_type(0), (std::min)(coordinate_type(1), t));
+    return euclidean_distance(
+        point_type(low(segment).x() + t * dx, low(segment).y() + t * dy),
+        point);
+  }
+
   void update_brect(const point_type& point) {
     if (brect_initialized_) {
       encompass(brect_, point);
@@ -247,16 +1782,16 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
   }
 
   void color_exterior(const VD::edge_type* edge) {
-    if (edge->color() == EXTERNAL_COLOR) {
+    if (edge->color() & EXTERNAL_COLOR) {
       return;
     }
-    edge->color(EXTERNAL_COLOR);
-    edge->twin()->color(EXTERNAL_COLOR);
+    edge->color(edge->color() | EXTERNAL_COLOR);
+    edge->twin()->color(edge->twin()->color() | EXTERNAL_COLOR);
     const VD::vertex_type* v = edge->vertex1();
     if (v == NULL || !edge->is_primary()) {
       return;
     }
-    v->color(EXTERNAL_COLOR);
+    v->color(v->color() | EXTERNAL_COLOR);
     const VD::edge_type* e = v->incident_edge();
     do {
       color_exterior(e);
@@ -264,8 +1799,20 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
     } while (e != v->incident_edge());
   }
 
+  // Shows the square of the given center and side of the diagram. The
+  // render layers are quantized for the whole diagram, so the view is
+  // only a projection change.
+  void set_view(coordinate_type cx, coordinate_type cy,
+                coordinate_type side) {
+    set_points(view_, point_type(cx - 0.5 * side, cy - 0.5 * side),
+               point_type(cx + 0.5 * side, cy + 0.5 * side));
+    update_view_port();
+    static_layer_dirty_ = true;
+    labels_dirty_ = true;
+  }
+
   void update_view_port() {
-    rect_type view_rect = brect_;
+    rect_type view_rect = view_;
     deconvolve(view_rect, shift_);
     const float width = xh(view_rect) - xl(view_rect);
     const float height = yh(view_rect) - yl(view_rect);
@@ -285,199 +1832,1420 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
     float y_;
   };
   struct VBO {
-    VBO(GLuint id, size_t vertex_count)
-      : id_(id), vertex_count_(vertex_count) {}
+    VBO(GLuint id, size_t vertex_count, size_t offset = 0)
+      : id_(id), vertex_count_(vertex_count), offset_(offset) {}
     GLuint id_;
     size_t vertex_count_;
+    // Byte offset of the data within the buffer.
+    size_t offset_;
+
+    const void* pointer() const {
+      return reinterpret_cast<const void*>(offset_);
+    }
+  };
+  // Large GL buffer that vertex data is suballocated from.
+  struct GLArena {
+    GLuint id_;
+    size_t capacity_;
+    size_t used_;
+    // Whether the arena was carried over from a previous build.
+    bool recycled_;
   };
+  struct GLPoolStats {
+    size_t allocations_ = 0;
+    size_t allocated_bytes_ = 0;
+    size_t recycled_bytes_ = 0;
+    double allocation_ms_ = 0;
+  };
+  // Uploaded tile of a quantized layer: 16 bit offsets from the origin.
+  struct GLTile {
+    GLTile() : x_(0), y_(0), vbo_(0, 0) {}
+    coordinate_type x_;
+    coordinate_type y_;
+    VBO vbo_;
+    std::vector<GLint> strip_first_;
+    std::vector<GLsizei> strip_count_;
+  };
+  struct GLLayer {
+    GLLayer() : prepared_(false), step_(1) {}
+    bool prepared_;
+    coordinate_type step_;
+    std::vector<GLTile> tiles_;
+  };
+  // Vertex of the edge layer: the 16 bit offsets, the category of the
+  // piece starting at the vertex and the length of the strip up to the
+  // vertex, in quantization steps.
+  struct GLEdgeVertex {
+    GLshort x_;
+    GLshort y_;
+    GLushort category_;
+    GLushort padding_;
+    GLfloat arc_length_;
+  };
+  // Vertex of the edge layer without instancing: the corner of the quad
+  // followed by the two vertices of its piece.
+  struct GLEdgeCorner {
+    GLfloat corner_x_;
+    GLfloat corner_y_;
+    GLEdgeVertex start_;
+    GLEdgeVertex end_;
+  };
+  // Uploaded tile of a tile pack, all layers in one buffer.
+  struct GLPackedTile {
+    const voronoi_tile_pack::tile_entry* entry_;
+    GLuint vbo_;
+    std::array<GLint, NUM_PACK_LAYERS> first_vertex_;
+    std::array<GLsizei, NUM_PACK_LAYERS> num_vertices_;
+    std::vector<GLint> strip_first_[NUM_PACK_LAYERS];
+    std::vector<GLsizei> strip_count_[NUM_PACK_LAYERS];
+  };
+  typedef voronoi_lru_cache<boost::uint64_t, GLPackedTile> tile_cache_type;
+
+  // Empty layer covering the whole diagram, geometry up to a diagram side
+  // outside of it is kept. The step is a pixel of the view at the maximum
+  // zoom, so the rounding stays within half a pixel at any zoom for view
+  // ports up to QUANTIZATION_VIEWPORT_SIDE pixels and below a pixel up to
+  // twice that. The tiles are a quarter of the diagram side then.
+  quantized_layer_type new_layer() const {
+    rect_type diagram_rect = brect_;
+    deconvolve(diagram_rect, shift_);
+    coordinate_type side = xh(diagram_rect) - xl(diagram_rect);
+    return quantized_layer_type(
+        side / (MAX_VIEW_ZOOM * QUANTIZATION_VIEWPORT_SIDE),
+        xl(diagram_rect) - side, yl(diagram_rect) - side,
+        xh(diagram_rect) + side, yh(diagram_rect) + side);
+  }
+
+  void upload_layer(const quantized_layer_type& layer, GLLayer* gl_layer) {
+    gl_layer->prepared_ = true;
+    gl_layer->step_ = layer.step();
+    gl_layer->tiles_.resize(layer.tiles().size());
+    for (std::size_t i = 0; i < layer.tiles().size(); ++i) {
+      const quantized_layer_type::tile& tile = layer.tiles()[i];
+      GLTile& gl_tile = gl_layer->tiles_[i];
+      gl_tile.x_ = tile.x;
+      gl_tile.y_ = tile.y;
+      gl_tile.vbo_ = pool_upload(tile.offsets.data(),
+                                 tile.offsets.size() * sizeof(GLshort),
+                                 tile.num_vertices());
+      for (std::size_t j = 0; j < tile.strips.size(); ++j) {
+        std::size_t last = j + 1 < tile.strips.size() ?
+            tile.strips[j + 1] : tile.num_vertices();
+        gl_tile.strip_first_.push_back((GLint)tile.strips[j]);
+        gl_tile.strip_count_.push_back((GLsizei)(last - tile.strips[j]));
+      }
+    }
+  }
+
+  // Uploads a layer of strips styled by edge category. Every tile is one
+  // buffer of GLEdgeVertex, drawn with a single instanced call, or of
+  // GLEdgeCorner, six per visible piece, without instancing.
+  void upload_edge_layer(const quantized_layer_type& layer,
+                         GLLayer* gl_layer) {
+    gl_layer->prepared_ = true;
+    gl_layer->step_ = layer.step();
+    gl_layer->tiles_.resize(layer.tiles().size());
+    std::vector<GLEdgeVertex> vertices;
+    std::vector<GLEdgeCorner> corners;
+    for (std::size_t i = 0; i < layer.tiles().size(); ++i) {
+      const quantized_layer_type::tile& tile = layer.tiles()[i];
+      GLTile& gl_tile = gl_layer->tiles_[i];
+      gl_tile.x_ = tile.x;
+      gl_tile.y_ = tile.y;
+      vertices.resize(tile.num_vertices());
+      for (std::size_t j = 0; j < tile.strips.size(); ++j) {
+        std::size_t first = tile.strips[j];
+        std::size_t last = j + 1 < tile.strips.size() ?
+            tile.strips[j + 1] : tile.num_vertices();
+        float arc_length = 0.0f;
+        for (std::size_t k = first; k < last; ++k) {
+          GLEdgeVertex& vertex = vertices[k];
+          vertex.x_ = tile.offsets[2 * k];
+          vertex.y_ = tile.offsets[2 * k + 1];
+          if (k > first) {
+            float dx = static_cast<float>(vertex.x_ - vertices[k - 1].x_);
+            float dy = static_cast<float>(vertex.y_ - vertices[k - 1].y_);
+            arc_length += std::sqrt(dx * dx + dy * dy);
+          }
+          vertex.category_ = static_cast<GLushort>(
+              k + 1 < last ? tile.styles[j] : CATEGORY_HIDDEN);
+          vertex.padding_ = 0;
+          vertex.arc_length_ = arc_length;
+        }
+      }
+      if (!instancing_) {
+        // The triangles of the quads, see edge_corners in initializeGL.
+        static const GLfloat quad[] = {
+          0.f, -1.f, 1.f, -1.f, 0.f, 1.f,
+          0.f, 1.f, 1.f, -1.f, 1.f, 1.f,
+        };
+        corners.clear();
+        for (std::size_t k = 0; k + 1 < vertices.size(); ++k) {
+          if (vertices[k].category_ == CATEGORY_HIDDEN) {
+            continue;
+          }
+          for (int c = 0; c < 6; ++c) {
+            GLEdgeCorner corner = {quad[2 * c], quad[2 * c + 1],
+                                   vertices[k], vertices[k + 1]};
+            corners.push_back(corner);
+          }
+        }
+        gl_tile.vbo_ = pool_upload(corners.data(),
+                                   corners.size() * sizeof(GLEdgeCorner),
+                                   corners.size());
+        continue;
+      }
+      gl_tile.vbo_ = pool_upload(vertices.data(),
+                                 vertices.size() * sizeof(GLEdgeVertex),
+                                 vertices.size());
+    }
+  }
+
+  // The tile buffers are owned by the pool, see reset_pool.
+  void clear_layer(GLLayer& gl_layer) {
+    retirement_queue_.retire(std::move(gl_layer.tiles_));
+    gl_layer.tiles_.clear();
+    gl_layer.prepared_ = false;
+  }
+
+  // Drops the render buffers of the diagram, they are prepared again for
+  // the next frame.
+  void invalidate_layers() {
+    clear_layer(gl_points_);
+    clear_layer(gl_segments_);
+    clear_layer(gl_vertices_);
+    clear_layer(gl_edges_);
+    reset_pool();
+    static_layer_dirty_ = true;
+  }
+
+  // Copies the data into a range of one of the pool arenas. A new arena
+  // is created only if none of the existing ones has room left; arenas
+  // grow geometrically so that a few of them hold the largest diagram.
+  VBO pool_upload(const void* data, size_t bytes, size_t vertex_count) {
+    static const size_t alignment = 16;
+    static const size_t min_arena_capacity = 1 << 20;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    size_t aligned_bytes = (bytes + alignment - 1) & ~(alignment - 1);
+    GLArena* arena = NULL;
+    for (GLArena& candidate : gl_arenas_) {
+      if (candidate.capacity_ - candidate.used_ >= aligned_bytes) {
+        arena = &candidate;
+        break;
+      }
+    }
+    if (arena == NULL) {
+      size_t capacity = min_arena_capacity;
+      for (const GLArena& existing : gl_arenas_) {
+        capacity = (std::max)(capacity, 2 * existing.capacity_);
+      }
+      capacity = (std::max)(capacity, aligned_bytes);
+      GLArena new_arena = {0, capacity, 0, false};
+      glGenBuffers(1, &new_arena.id_);
+      glBindBuffer(GL_ARRAY_BUFFER, new_arena.id_);
+      glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+      gl_arenas_.push_back(new_arena);
+      arena = &gl_arenas_.back();
+    }
+    VBO range(arena->id_, vertex_count, arena->used_);
+    arena->used_ += aligned_bytes;
+    ++pool_stats_.allocations_;
+    pool_stats_.allocated_bytes_ += aligned_bytes;
+    if (arena->recycled_) {
+      pool_stats_.recycled_bytes_ += aligned_bytes;
+    }
+    pool_stats_.allocation_ms_ += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    glBindBuffer(GL_ARRAY_BUFFER, range.id_);
+    glBufferSubData(GL_ARRAY_BUFFER, range.offset_, bytes, data);
+    return range;
+  }
 
-  VBO point_vbo(const point_type& point, float radius_px) {
-      const float width = xh(brect_) - xl(brect_);
-      const float height = yh(brect_) - yl(brect_);
-      const float xRadius = radius_px * width / size().width();
-      const float yRadius = radius_px * height / size().height();
-      static constexpr size_t boundary_point_count = 20;
-      static constexpr float angle_increment = 2 * 3.14159265358979323846 / boundary_point_count;
-      std::vector<GLPoint> boundary;
-      boundary.reserve(boundary_point_count + 2);
-      boundary.emplace_back(point.x(), point.y());
-      for (int i = 0; i <= boundary_point_count; ++i) {
-          const float angle = angle_increment * i;
-          boundary.emplace_back(point.x() + std::sin(angle) * xRadius, point.y() + std::cos(angle) * yRadius);
+  // Releases every range at once; the arenas are kept for the next build
+  // unless the last build did not need them. This runs outside of the GL
+  // context, the unneeded buffers are deleted at the next frame.
+  void reset_pool() {
+    std::vector<GLArena> arenas;
+    for (GLArena& arena : gl_arenas_) {
+      if (arena.recycled_ && arena.used_ == 0) {
+        retired_buffers_.push_back(arena.id_);
+        continue;
       }
-      GLuint buffer_id;
-      glGenBuffers(1, &buffer_id);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
-      glBufferData(GL_ARRAY_BUFFER, boundary.size() * sizeof(GLPoint), boundary.data(), GL_STATIC_DRAW);
-      return VBO(buffer_id, boundary.size());
+      arena.used_ = 0;
+      arena.recycled_ = true;
+      arenas.push_back(arena);
+    }
+    gl_arenas_.swap(arenas);
+  }
+
+  void delete_retired_buffers() {
+    if (retired_buffers_.empty()) {
+      return;
+    }
+    glDeleteBuffers((GLsizei)retired_buffers_.size(), retired_buffers_.data());
+    retired_buffers_.clear();
+  }
+
+  // Shows the pool statistics in the status label. Called from
+  // timerEvent, not from the render path.
+  void report_pool_stats() {
+    size_t capacity = 0;
+    for (const GLArena& arena : gl_arenas_) {
+      capacity += arena.capacity_;
+    }
+    double reuse_ratio = pool_stats_.allocated_bytes_ ?
+        static_cast<double>(pool_stats_.recycled_bytes_) /
+            pool_stats_.allocated_bytes_ : 0.0;
+    emit status_changed(
+        tr("Buffer pool: %1 buffers, %2 KiB, %3 allocations, reuse ratio "
+           "%4, allocation time %5 ms.")
+            .arg(gl_arenas_.size())
+            .arg(capacity / 1024)
+            .arg(pool_stats_.allocations_)
+            .arg(reuse_ratio, 0, 'f', 2)
+            .arg(pool_stats_.allocation_ms_, 0, 'f', 1));
+    reported_allocations_ = pool_stats_.allocations_;
+  }
+
+  void print_builder_telemetry() const {
+    const voronoi_predicate_counters& predicates = telemetry_.predicates;
+    std::cout << "builder: " << telemetry_.site_events << " site events, "
+              << telemetry_.circle_events << " circle events ("
+              << telemetry_.processed_circle_events << " processed, "
+              << telemetry_.invalidated_circle_events << " invalidated), "
+              << "max beach line " << telemetry_.max_beach_line_size
+              << ", " << predicates.node_comparisons << " node comparisons"
+              << std::endl;
+    const char* kinds[] = {"ppp", "pps", "pss", "sss"};
+    std::cout << "predicates: circles lazy/exact";
+    for (int i = 0; i < 4; ++i) {
+      std::cout << " " << kinds[i] << " " << predicates.lazy_circles[i]
+                << "/" << predicates.exact_circles[i];
+    }
+    std::cout << ", " << predicates.exact_evaluations
+              << " exact evaluations" << std::endl;
+  }
+
+  // Projection of the tile offsets: scales the steps to the view units and
+  // moves them to the tile origin.
+  std::array<float, 16> tile_matrix(const GLLayer& layer,
+                                    const GLTile& tile) const {
+    std::array<float, 16> matrix = projection_matrix_;
+    matrix[0] = projection_matrix_[0] * layer.step_;
+    matrix[5] = projection_matrix_[5] * layer.step_;
+    matrix[12] = projection_matrix_[0] * tile.x_ + projection_matrix_[12];
+    matrix[13] = projection_matrix_[5] * tile.y_ + projection_matrix_[13];
+    return matrix;
+  }
+
+  // Grid of the input sites used for the raster preview and to look up
+  // the hovered site.
+  void prepare_site_locator() {
+    preview_side_ = (std::max)(qMin(size().width(), size().height()), 1);
+    site_locator_.reset(new site_locator_type(
+        point_data_, segment_data_,
+        xl(brect_), yl(brect_), xh(brect_), yh(brect_),
+        static_cast<std::size_t>(preview_side_) * preview_side_));
+  }
+
+  void prepare_preview() {
+    // Label the view port pixels with the closest input site and mark the
+    // pixels where the label changes, which approximates the Voronoi edges.
+    std::vector<unsigned int> labels;
+    site_locator_->label(preview_side_, preview_side_, &labels);
+    preview_pixels_.assign(4 * labels.size(), 255);
+    for (int j = 0; j < preview_side_; ++j) {
+      for (int i = 0; i < preview_side_; ++i) {
+        std::size_t index = static_cast<std::size_t>(j) * preview_side_ + i;
+        bool boundary =
+            (i + 1 < preview_side_ && labels[index] != labels[index + 1]) ||
+            (j + 1 < preview_side_ &&
+             labels[index] != labels[index + preview_side_]);
+        if (boundary) {
+          preview_pixels_[4 * index] = 128;
+          preview_pixels_[4 * index + 1] = 128;
+          preview_pixels_[4 * index + 2] = 128;
+        }
+      }
+    }
+    preview_dirty_ = true;
+  }
+
+  void draw_preview() {
+    if (preview_pixels_.empty()) {
+      return;
+    }
+    if (preview_texture_ == 0) {
+      glGenTextures(1, &preview_texture_);
+      glBindTexture(GL_TEXTURE_2D, preview_texture_);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    if (preview_dirty_) {
+      glBindTexture(GL_TEXTURE_2D, preview_texture_);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, preview_side_, preview_side_, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, preview_pixels_.data());
+      preview_dirty_ = false;
+    }
+    draw_texture(preview_texture_);
+  }
+
+  void draw_texture(GLuint texture) {
+    glUseProgram(texture_program_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(sampler_location_, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
+    glVertexAttribPointer(texture_vertex_location_, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(GLfloat), nullptr);
+    glVertexAttribPointer(texture_coord_location_, 2, GL_FLOAT, GL_FALSE,
+                          4 * sizeof(GLfloat),
+                          reinterpret_cast<const void*>(2 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(texture_vertex_location_);
+    glEnableVertexAttribArray(texture_coord_location_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(texture_coord_location_);
+    glDisableVertexAttribArray(texture_vertex_location_);
+  }
+
+  void render_static_layer() {
+    // Render the diagram into a multisampled framebuffer of the view port
+    // size and resolve it into a texture.
+    const QSize layer_size(viewport_side_, viewport_side_);
+    if (!static_layer_ || static_layer_->size() != layer_size) {
+      QOpenGLFramebufferObjectFormat format;
+      multisample_layer_.reset();
+      if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit()) {
+        format.setSamples(4);
+        multisample_layer_.reset(
+            new QOpenGLFramebufferObject(layer_size, format));
+      }
+      static_layer_.reset(new QOpenGLFramebufferObject(layer_size));
+    }
+    QOpenGLFramebufferObject* target =
+        multisample_layer_ ? multisample_layer_.get() : static_layer_.get();
+    target->bind();
+    glViewport(0, 0, viewport_side_, viewport_side_);
+    glClearColor(1.f, 1.f, 1.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    draw_points();
+    draw_segments();
+    draw_vertices();
+    draw_edges();
+    if (report_startup_ && !is_building()) {
+      startup_diagram_ms_ = milliseconds_since(process_start_time);
+      report_startup_ = false;
+    }
+    if (multisample_layer_) {
+      QOpenGLFramebufferObject::blitFramebuffer(
+          static_layer_.get(), multisample_layer_.get());
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glViewport(viewport_x_, viewport_y_, viewport_side_, viewport_side_);
+    static_layer_dirty_ = false;
   }
 
-  void clear_vbo(VBO& vbo) {
-      glDeleteBuffers(1, &vbo.id_);
-      vbo.id_ = 0;
+  void draw_hovered_site() {
+    // Highlight the input site whose cell is under the mouse cursor.
+    if (hovered_site_ == site_locator_type::NO_SITE) {
+      return;
+    }
+    std::vector<GLPoint> points;
+    if (hovered_site_ < point_data_.size()) {
+      point_type point = point_data_[hovered_site_];
+      point = deconvolve(point, shift_);
+      points.emplace_back(point.x(), point.y());
+    } else {
+      const segment_type& segment =
+          segment_data_[hovered_site_ - point_data_.size()];
+      point_type lp = low(segment);
+      point_type hp = high(segment);
+      lp = deconvolve(lp, shift_);
+      hp = deconvolve(hp, shift_);
+      points.emplace_back(lp.x(), lp.y());
+      points.emplace_back(hp.x(), hp.y());
+    }
+    std::array<float, 4> color{1.0f, 0.5f, 0.0f, 1.0f};
+    upload_overlay(points);
+    if (points.size() == 2) {
+      glUseProgram(gl_program_);
+      glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, projection_matrix_.data());
+      glUniform4fv(color_location_, 1, color.data());
+      glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+      glLineWidth(3.5f);
+      glEnableVertexAttribArray(vertex_location_);
+      glDrawArrays(GL_LINES, 0, 2);
+      glDisableVertexAttribArray(vertex_location_);
+    }
+    draw_glyph_buffer(gl_overlay_, GL_FLOAT, projection_matrix_, 6.f, 1.f,
+                      color);
   }
 
-  void clear_vbo_array(std::vector<VBO>& vbos) {
-      for (VBO& vbo : vbos) {
-          clear_vbo(vbo);
+  // Labels the sites in view with their index and coordinates, once the
+  // view is zoomed in far enough for them not to cover each other.
+  void prepare_site_labels() {
+    labels_dirty_ = false;
+    num_label_glyphs_ = 0;
+    if (!site_locator_) {
+      return;
+    }
+    std::size_t max_sites = (std::min)(
+        MAX_LABELED_SITES,
+        static_cast<std::size_t>(viewport_side_) * viewport_side_ /
+            LABEL_AREA);
+    std::vector<site_locator_type::label_type> sites;
+    // Sites of the hidden layers are neither labeled nor counted.
+    if (!site_locator_->sites_in_rect(
+            xl(view_), yl(view_), xh(view_), yh(view_), max_sites,
+            [this](std::size_t site) { return site_visible(site); },
+            &sites)) {
+      return;
+    }
+    std::vector<GLfloat> glyphs;
+    char text[128];
+    for (std::size_t i = 0; i < sites.size(); ++i) {
+      std::size_t site = sites[i];
+      point_type anchor;
+      if (site < point_data_.size()) {
+        anchor = point_data_[site];
+        std::snprintf(text, sizeof(text), "%u (%.0f, %.0f)",
+                      static_cast<unsigned>(site), anchor.x(), anchor.y());
+      } else {
+        const segment_type& segment = segment_data_[site - point_data_.size()];
+        anchor = point_type(0.5 * (low(segment).x() + high(segment).x()),
+                            0.5 * (low(segment).y() + high(segment).y()));
+        std::snprintf(text, sizeof(text),
+                      "%u (%.0f, %.0f)-(%.0f, %.0f)",
+                      static_cast<unsigned>(site),
+                      low(segment).x(), low(segment).y(),
+                      high(segment).x(), high(segment).y());
       }
-      vbos.clear();
+      anchor = deconvolve(anchor, shift_);
+      for (int column = 0; text[column] != '\0'; ++column) {
+        int glyph = voronoi_glyph_atlas::glyph(text[column]);
+        if (glyph < 0 || text[column] == ' ') {
+          continue;
+        }
+        glyphs.push_back(static_cast<GLfloat>(anchor.x()));
+        glyphs.push_back(static_cast<GLfloat>(anchor.y()));
+        glyphs.push_back(static_cast<GLfloat>(column));
+        glyphs.push_back(static_cast<GLfloat>(glyph));
+      }
+    }
+    num_label_glyphs_ = glyphs.size() / 4;
+    if (!instancing_) {
+      // Two triangles per character, every vertex is its corner followed
+      // by the attributes of the character.
+      static const GLfloat corners[] = {
+        0.f, 0.f, 1.f, 0.f, 0.f, 1.f,
+        0.f, 1.f, 1.f, 0.f, 1.f, 1.f,
+      };
+      std::vector<GLfloat> vertices;
+      vertices.reserve(num_label_glyphs_ * 6 * 6);
+      for (std::size_t i = 0; i < glyphs.size(); i += 4) {
+        for (int k = 0; k < 6; ++k) {
+          vertices.push_back(corners[2 * k]);
+          vertices.push_back(corners[2 * k + 1]);
+          vertices.insert(vertices.end(), &glyphs[i], &glyphs[i] + 4);
+        }
+      }
+      glyphs.swap(vertices);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, label_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, glyphs.size() * sizeof(GLfloat),
+                 glyphs.data(), GL_DYNAMIC_DRAW);
+  }
+
+  void draw_site_labels() {
+    // Draw all the characters of all the labels with one instanced draw
+    // call, or one call of their triangles without instancing.
+    if (labels_dirty_) {
+      prepare_site_labels();
+    }
+    if (num_label_glyphs_ == 0) {
+      return;
+    }
+    QOpenGLExtraFunctions* f = context()->extraFunctions();
+    // Texels per pixel and the sizes in clip units.
+    const float scale = LABEL_FONT_SIZE / LABEL_FONT_TEXELS;
+    const float clip = 2.0f / viewport_side_;
+    const float cell_width = LABEL_CELL_WIDTH * scale * clip;
+    const float cell_height = LABEL_CELL_HEIGHT * scale * clip;
+    // Right of the site glyph, centered on it vertically; the glyphs are
+    // centered in their cells.
+    const float origin_x = 8.0f * clip -
+        0.5f * (LABEL_CELL_WIDTH - label_advance_) * scale * clip;
+    glUseProgram(label_program_);
+    glUniformMatrix4fv(label_mvp_matrix_location_, 1, GL_FALSE,
+                       projection_matrix_.data());
+    glUniform2f(label_origin_location_, origin_x, -0.5f * cell_height);
+    glUniform2f(label_advance_location_, label_advance_ * scale * clip, 0.0f);
+    glUniform2f(label_cell_size_location_, cell_width, cell_height);
+    glUniform2f(label_atlas_grid_location_, LABEL_ATLAS_COLUMNS,
+                (voronoi_glyph_atlas::NUM_GLYPHS + LABEL_ATLAS_COLUMNS - 1) /
+                    LABEL_ATLAS_COLUMNS);
+    // Half a pixel of the distance range on each side of the outline.
+    glUniform1f(label_smoothing_location_,
+                0.5f * (127.0f / 255.0f) / (LABEL_SPREAD * scale));
+    glUniform4f(label_color_location_, 0.1f, 0.1f, 0.1f, 1.0f);
+    glUniform4f(label_halo_color_location_, 1.0f, 1.0f, 1.0f, 0.85f);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, label_atlas_texture_);
+    glUniform1i(label_sampler_location_, 0);
+    if (!instancing_) {
+      const GLsizei stride = 6 * sizeof(GLfloat);
+      glBindBuffer(GL_ARRAY_BUFFER, label_vbo_);
+      glVertexAttribPointer(label_corner_location_, 2, GL_FLOAT, GL_FALSE,
+                            stride, nullptr);
+      glVertexAttribPointer(label_glyph_location_, 4, GL_FLOAT, GL_FALSE,
+                            stride,
+                            reinterpret_cast<const void*>(2 * sizeof(GLfloat)));
+      glEnableVertexAttribArray(label_corner_location_);
+      glEnableVertexAttribArray(label_glyph_location_);
+      glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(6 * num_label_glyphs_));
+      glDisableVertexAttribArray(label_glyph_location_);
+      glDisableVertexAttribArray(label_corner_location_);
+      return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, label_corner_vbo_);
+    glVertexAttribPointer(label_corner_location_, 2, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    glEnableVertexAttribArray(label_corner_location_);
+    glBindBuffer(GL_ARRAY_BUFFER, label_vbo_);
+    glVertexAttribPointer(label_glyph_location_, 4, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    glEnableVertexAttribArray(label_glyph_location_);
+    f->glVertexAttribDivisor(label_glyph_location_, 1);
+    f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                             (GLsizei)num_label_glyphs_);
+    f->glVertexAttribDivisor(label_glyph_location_, 0);
+    glDisableVertexAttribArray(label_glyph_location_);
+    glDisableVertexAttribArray(label_corner_location_);
+  }
+
+  // Overlays are tiny and change every frame, they share one buffer.
+  void upload_overlay(const std::vector<GLPoint>& points) {
+    if (gl_overlay_.id_ == 0) {
+      glGenBuffers(1, &gl_overlay_.id_);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, gl_overlay_.id_);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(GLPoint), points.data(), GL_DYNAMIC_DRAW);
+    gl_overlay_.vertex_count_ = points.size();
+  }
+
+  void clear_preview_texture() {
+    if (preview_texture_ != 0) {
+      glDeleteTextures(1, &preview_texture_);
+      preview_texture_ = 0;
+    }
+  }
+
+  void draw_glyphs(const GLLayer& centers, float radius_px,
+                   const std::array<float, 4>& color) {
+    for (const GLTile& tile : centers.tiles_) {
+      draw_glyph_buffer(tile.vbo_, GL_SHORT, tile_matrix(centers, tile),
+                        radius_px, centers.step_, color);
+    }
+  }
+
+  void draw_glyph_buffer(const VBO& centers, GLenum type,
+                         const std::array<float, 16>& matrix, float radius_px,
+                         coordinate_type unit,
+                         const std::array<float, 4>& color) {
+    // Draw one circle per center with a single instanced draw call. The
+    // radius is converted to the units of the centers.
+    if (centers.vertex_count_ == 0) {
+        return;
+    }
+    if (!instancing_) {
+      draw_point_glyphs(centers, type, matrix, radius_px, color);
+      return;
+    }
+    QOpenGLExtraFunctions* f = context()->extraFunctions();
+    const float width = (xh(view_) - xl(view_)) / unit;
+    const float height = (yh(view_) - yl(view_)) / unit;
+    glUseProgram(glyph_program_);
+    glUniformMatrix4fv(glyph_mvp_matrix_location_, 1, GL_FALSE, matrix.data());
+    glUniform2f(glyph_radius_location_,
+                radius_px * width / size().width(),
+                radius_px * height / size().height());
+    glUniform4fv(glyph_color_location_, 1, color.data());
+    glBindBuffer(GL_ARRAY_BUFFER, gl_circle_.id_);
+    glVertexAttribPointer(glyph_offset_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(glyph_offset_location_);
+    glBindBuffer(GL_ARRAY_BUFFER, centers.id_);
+    glVertexAttribPointer(glyph_center_location_, 2, type, GL_FALSE, 0, centers.pointer());
+    glEnableVertexAttribArray(glyph_center_location_);
+    f->glVertexAttribDivisor(glyph_center_location_, 1);
+    f->glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, (GLsizei)gl_circle_.vertex_count_,
+                             (GLsizei)centers.vertex_count_);
+    f->glVertexAttribDivisor(glyph_center_location_, 0);
+    glDisableVertexAttribArray(glyph_center_location_);
+    glDisableVertexAttribArray(glyph_offset_location_);
+  }
+
+  // Fallback of draw_glyph_buffer for the contexts without instancing.
+  void draw_point_glyphs(const VBO& centers, GLenum type,
+                         const std::array<float, 16>& matrix, float radius_px,
+                         const std::array<float, 4>& color) {
+    glUseProgram(point_glyph_program_);
+    glUniformMatrix4fv(point_glyph_mvp_matrix_location_, 1, GL_FALSE,
+                       matrix.data());
+    glUniform1f(point_glyph_size_location_,
+                2.0f * radius_px * viewport_side_ / size().width());
+    glUniform4fv(point_glyph_color_location_, 1, color.data());
+    glBindBuffer(GL_ARRAY_BUFFER, centers.id_);
+    glVertexAttribPointer(point_glyph_center_location_, 2, type, GL_FALSE, 0,
+                          centers.pointer());
+    glEnableVertexAttribArray(point_glyph_center_location_);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)centers.vertex_count_);
+    glDisableVertexAttribArray(point_glyph_center_location_);
   }
 
   void prepare_points() {
-      static constexpr float radius = 4.5f;
-      if (!gl_points_.empty()) {
+      if (gl_points_.prepared_) {
           return;
       }
-      gl_points_.reserve(point_data_.size() + 2 * segment_data_.size());
-      for (std::size_t i = 0; i < point_data_.size(); ++i) {
-          point_type point = point_data_[i];
-          point = deconvolve(point, shift_);
-          gl_points_.push_back(point_vbo(point, radius));
-      }
-      for (std::size_t i = 0; i < segment_data_.size(); ++i) {
-          point_type lp = low(segment_data_[i]);
-          lp = deconvolve(lp, shift_);
-          gl_points_.push_back(point_vbo(lp, radius));
-          point_type hp = high(segment_data_[i]);
-          hp = deconvolve(hp, shift_);
-          gl_points_.push_back(point_vbo(hp, radius));
+      // Layer visibility changes take the sites out of the build thread's
+      // layer.
+      if (site_points_dirty_) {
+          prepare_site_points();
+          site_points_dirty_ = false;
       }
+      upload_layer(site_layer_, &gl_points_);
   }
 
   void draw_points() {
     // Draw input points and endpoints of the input segments.
     prepare_points();
-    glUseProgram(gl_program_);
-    glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, projection_matrix_.data());
-    std::array<float, 4> color{0.0f, 0.5f, 1.0f, 1.0f};
-    glUniform4fv(color_location_, 1, color.data());
-    for (const VBO& point_vbo : gl_points_) {
-        glBindBuffer(GL_ARRAY_BUFFER, point_vbo.id_);
-        glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glEnableVertexAttribArray(vertex_location_);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, (GLsizei)point_vbo.vertex_count_);
-        glDisableVertexAttribArray(vertex_location_);
-    }
+    draw_glyphs(gl_points_, 4.5f, {0.0f, 0.5f, 1.0f, 1.0f});
   }
 
   void prepare_segments() {
-      if (gl_segments_.id_ != 0) {
+      if (gl_segments_.prepared_) {
           return;
       }
-      std::vector<GLPoint> segment_points;
-      segment_points.reserve(segment_data_.size() * 2);
+      // Segments split at tile borders stay pairs of vertices, so every
+      // tile is drawn as lines.
+      quantized_layer_type layer = new_layer();
       for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+          if (!site_visible(point_data_.size() + i)) {
+              continue;
+          }
           point_type lp = low(segment_data_[i]);
           lp = deconvolve(lp, shift_);
-          segment_points.emplace_back(lp.x(), lp.y());
           point_type hp = high(segment_data_[i]);
           hp = deconvolve(hp, shift_);
-          segment_points.emplace_back(hp.x(), hp.y());
+          layer.begin_strip();
+          layer.add_vertex(lp.x(), lp.y());
+          layer.add_vertex(hp.x(), hp.y());
       }
-      glGenBuffers(1, &gl_segments_.id_);
-      glBindBuffer(GL_ARRAY_BUFFER, gl_segments_.id_);
-      glBufferData(GL_ARRAY_BUFFER, segment_points.size() * sizeof(GLPoint), segment_points.data(), GL_STATIC_DRAW);
-      gl_segments_.vertex_count_ = segment_points.size();
+      upload_layer(layer, &gl_segments_);
   }
   void draw_segments() {
     // Draw input segments.
     prepare_segments();
     glUseProgram(gl_program_);
-    glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, projection_matrix_.data());
     std::array<float, 4> color{0.0f, 0.5f, 1.0f, 1.0f};
     glUniform4fv(color_location_, 1, color.data());
-    glBindBuffer(GL_ARRAY_BUFFER, gl_segments_.id_);
-    glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
     glLineWidth(2.7f);
-    glEnableVertexAttribArray(vertex_location_);
-    glDrawArrays(GL_LINES, 0, (GLsizei)gl_segments_.vertex_count_);
-    glDisableVertexAttribArray(vertex_location_);
+    for (const GLTile& tile : gl_segments_.tiles_) {
+      glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, tile_matrix(gl_segments_, tile).data());
+      glBindBuffer(GL_ARRAY_BUFFER, tile.vbo_.id_);
+      glVertexAttribPointer(vertex_location_, 2, GL_SHORT, GL_FALSE, 0, tile.vbo_.pointer());
+      glEnableVertexAttribArray(vertex_location_);
+      glDrawArrays(GL_LINES, 0, (GLsizei)tile.vbo_.vertex_count_);
+      glDisableVertexAttribArray(vertex_location_);
+    }
   }
 
   void prepare_vertices() {
-      static constexpr float radius = 3;
-      if (!gl_vertices_.empty()) {
+      if (gl_vertices_.prepared_) {
           return;
       }
-      for (const_vertex_iterator it = vd_.vertices().begin();
-           it != vd_.vertices().end(); ++it) {
-          if (internal_edges_only_ && (it->color() == EXTERNAL_COLOR)) {
+      quantized_layer_type vertices = new_layer();
+      for (const_vertex_iterator it = vd_->vertices().begin();
+           it != vd_->vertices().end(); ++it) {
+          if (internal_edges_only_ && (it->color() & EXTERNAL_COLOR)) {
               continue;
           }
           point_type vertex(it->x(), it->y());
           vertex = deconvolve(vertex, shift_);
-          gl_vertices_.push_back(point_vbo(vertex, radius));
+          vertices.add_point(vertex.x(), vertex.y());
       }
+      upload_layer(vertices, &gl_vertices_);
   }
   void draw_vertices() {
     // Draw voronoi vertices.
     prepare_vertices();
-    glUseProgram(gl_program_);
-    glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, projection_matrix_.data());
-    std::array<float, 4> color{0.0f, 0.0f, 0.0f, 1.0f};
-    glUniform4fv(color_location_, 1, color.data());
-    for (const VBO& vertex_vbo : gl_vertices_) {
-      glBindBuffer(GL_ARRAY_BUFFER, vertex_vbo.id_);
-      glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-      glEnableVertexAttribArray(vertex_location_);
-      glDrawArrays(GL_TRIANGLE_FAN, 0, (GLsizei)vertex_vbo.vertex_count_);
-      glDisableVertexAttribArray(vertex_location_);
-    }
+    draw_glyphs(gl_vertices_, 3.f, {0.0f, 0.0f, 0.0f, 1.0f});
   }
 
   void prepare_edges() {
-      if (!gl_edges_.empty()) {
+      if (gl_edges_.prepared_) {
           return;
       }
-      for (const_edge_iterator it = vd_.edges().begin();
-           it != vd_.edges().end(); ++it) {
-          if (primary_edges_only_ && !it->is_primary()) {
-              continue;
+      // The chains keep one category, which styles the whole strip.
+      quantized_layer_type edges = new_layer();
+      edge_polylines polylines;
+      sample_edge_chains(filtered_edges(), [this](const edge_type& edge) {
+        return edge_visible(edge);
+      }, [this](const edge_type& edge) {
+        return edge_category(edge);
+      }, &polylines);
+      for (std::size_t i = 0; i < polylines.edges.size(); ++i) {
+          edges.begin_strip(edge_category(*polylines.edges[i]));
+          for (std::size_t j = polylines.starts[i];
+               j < polylines.starts[i + 1]; ++j) {
+              point_type vertex = deconvolve(polylines.samples[j], shift_);
+              edges.add_vertex(vertex.x(), vertex.y());
           }
-          if (internal_edges_only_ && (it->color() == EXTERNAL_COLOR)) {
-              continue;
-          }
-          std::vector<point_type> samples;
-          if (!it->is_finite()) {
-              clip_infinite_edge(*it, &samples);
-          } else {
-              point_type vertex0(it->vertex0()->x(), it->vertex0()->y());
-              samples.push_back(vertex0);
-              point_type vertex1(it->vertex1()->x(), it->vertex1()->y());
-              samples.push_back(vertex1);
-              if (it->is_curved()) {
-                  sample_curved_edge(*it, &samples);
-              }
-          }
-          std::vector<GLPoint> gl_samples;
-          gl_samples.reserve(samples.size());
-          for (point_type& sample : samples) {
-              point_type vertex = deconvolve(sample, shift_);
-              gl_samples.emplace_back(sample.x(), sample.y());
-          }
-          GLuint vbo_id;
-          glGenBuffers(1, &vbo_id);
-          glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
-          glBufferData(GL_ARRAY_BUFFER, gl_samples.size() * sizeof(GLPoint), gl_samples.data(), GL_STATIC_DRAW);
-          gl_edges_.emplace_back(vbo_id, gl_samples.size());
       }
+      upload_edge_layer(edges, &gl_edges_);
   }
   void draw_edges() {
-    // Draw voronoi edges.
+    // Draw voronoi edges styled by their category; edges of a region
+    // build that may be affected by the sites outside of the region are
+    // unreliable.
     prepare_edges();
+    QOpenGLExtraFunctions* f = context()->extraFunctions();
+    std::array<GLfloat, 4 * NUM_EDGE_STYLES> colors;
+    std::array<GLfloat, 4 * NUM_EDGE_STYLES> strokes;
+    for (int i = 0; i < NUM_EDGE_STYLES; ++i) {
+      const edge_style& style = edge_styles_[i];
+      std::copy(style.color.begin(), style.color.end(), &colors[4 * i]);
+      strokes[4 * i] = style.width;
+      strokes[4 * i + 1] = style.dash;
+      strokes[4 * i + 2] = style.gap;
+      strokes[4 * i + 3] = 0.0f;
+    }
+    glUseProgram(edge_program_);
+    glUniform2f(edge_viewport_size_location_, viewport_side_, viewport_side_);
+    glUniform4fv(edge_style_colors_location_, NUM_EDGE_STYLES, colors.data());
+    glUniform4fv(edge_style_strokes_location_, NUM_EDGE_STYLES,
+                 strokes.data());
+    if (!instancing_) {
+      draw_edge_corners();
+      return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, edge_corner_vbo_);
+    glVertexAttribPointer(edge_corner_location_, 2, GL_FLOAT, GL_FALSE, 0,
+                          nullptr);
+    glEnableVertexAttribArray(edge_corner_location_);
+    const GLint instanced[] = {edge_start_location_, edge_end_location_,
+                               edge_category_location_,
+                               edge_arc_length_location_};
+    for (GLint location : instanced) {
+      glEnableVertexAttribArray(location);
+      f->glVertexAttribDivisor(location, 1);
+    }
+    const GLsizei stride = sizeof(GLEdgeVertex);
+    for (const GLTile& tile : gl_edges_.tiles_) {
+      if (tile.vbo_.vertex_count_ < 2) {
+        continue;
+      }
+      std::array<float, 16> matrix = tile_matrix(gl_edges_, tile);
+      glUniformMatrix4fv(edge_mvp_matrix_location_, 1, GL_FALSE,
+                         matrix.data());
+      glUniform1f(edge_pixels_per_unit_location_,
+                  0.5f * viewport_side_ * matrix[0]);
+      glBindBuffer(GL_ARRAY_BUFFER, tile.vbo_.id_);
+      const size_t offset = tile.vbo_.offset_;
+      glVertexAttribPointer(edge_start_location_, 2, GL_SHORT, GL_FALSE,
+                            stride, reinterpret_cast<const void*>(offset));
+      glVertexAttribPointer(edge_end_location_, 2, GL_SHORT, GL_FALSE,
+                            stride,
+                            reinterpret_cast<const void*>(offset + stride));
+      glVertexAttribPointer(edge_category_location_, 1, GL_UNSIGNED_SHORT,
+                            GL_FALSE, stride,
+                            reinterpret_cast<const void*>(
+                                offset + offsetof(GLEdgeVertex, category_)));
+      glVertexAttribPointer(edge_arc_length_location_, 1, GL_FLOAT, GL_FALSE,
+                            stride,
+                            reinterpret_cast<const void*>(
+                                offset + offsetof(GLEdgeVertex, arc_length_)));
+      f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                               (GLsizei)tile.vbo_.vertex_count_ - 1);
+    }
+    for (GLint location : instanced) {
+      f->glVertexAttribDivisor(location, 0);
+      glDisableVertexAttribArray(location);
+    }
+    glDisableVertexAttribArray(edge_corner_location_);
+  }
+
+  // Draws the edge tiles uploaded without instancing, the program and the
+  // style tables are set up by draw_edges.
+  void draw_edge_corners() {
+    const GLint locations[] = {edge_corner_location_, edge_start_location_,
+                               edge_end_location_, edge_category_location_,
+                               edge_arc_length_location_};
+    for (GLint location : locations) {
+      glEnableVertexAttribArray(location);
+    }
+    const GLsizei stride = sizeof(GLEdgeCorner);
+    for (const GLTile& tile : gl_edges_.tiles_) {
+      if (tile.vbo_.vertex_count_ == 0) {
+        continue;
+      }
+      std::array<float, 16> matrix = tile_matrix(gl_edges_, tile);
+      glUniformMatrix4fv(edge_mvp_matrix_location_, 1, GL_FALSE,
+                         matrix.data());
+      glUniform1f(edge_pixels_per_unit_location_,
+                  0.5f * viewport_side_ * matrix[0]);
+      glBindBuffer(GL_ARRAY_BUFFER, tile.vbo_.id_);
+      const size_t offset = tile.vbo_.offset_;
+      const size_t start = offset + offsetof(GLEdgeCorner, start_);
+      glVertexAttribPointer(edge_corner_location_, 2, GL_FLOAT, GL_FALSE,
+                            stride, reinterpret_cast<const void*>(offset));
+      glVertexAttribPointer(edge_start_location_, 2, GL_SHORT, GL_FALSE,
+                            stride, reinterpret_cast<const void*>(start));
+      glVertexAttribPointer(edge_end_location_, 2, GL_SHORT, GL_FALSE,
+                            stride,
+                            reinterpret_cast<const void*>(
+                                offset + offsetof(GLEdgeCorner, end_)));
+      glVertexAttribPointer(edge_category_location_, 1, GL_UNSIGNED_SHORT,
+                            GL_FALSE, stride,
+                            reinterpret_cast<const void*>(
+                                start + offsetof(GLEdgeVertex, category_)));
+      glVertexAttribPointer(edge_arc_length_location_, 1, GL_FLOAT, GL_FALSE,
+                            stride,
+                            reinterpret_cast<const void*>(
+                                start + offsetof(GLEdgeVertex, arc_length_)));
+      glDrawArrays(GL_TRIANGLES, 0, (GLsizei)tile.vbo_.vertex_count_);
+    }
+    for (GLint location : locations) {
+      glDisableVertexAttribArray(location);
+    }
+  }
+
+  int edge_category(const edge_type& edge) const {
+    if (edge.color() & UNRELIABLE_COLOR) {
+      return CATEGORY_UNRELIABLE;
+    }
+    if (color_by_layer_) {
+      unsigned layer = site_layer(edge.cell()->source_index());
+      if (layer != site_layer(edge.twin()->cell()->source_index())) {
+        return CATEGORY_LAYER_BOUNDARY;
+      }
+      return CATEGORY_LAYER + layer % NUM_LAYER_COLORS;
+    }
+    if (!edge.is_finite()) {
+      return CATEGORY_INFINITE;
+    }
+    if (edge.is_curved()) {
+      return CATEGORY_CURVED;
+    }
+    return edge.is_primary() ? CATEGORY_PRIMARY : CATEGORY_SECONDARY;
+  }
+
+  // Fills the style table: all the edges alike and the unreliable ones in
+  // red, or every category in a style of its own. The layer colors are
+  // used while the edges are colored by layer.
+  void set_edge_styles() {
+    const edge_style plain = {{0.0f, 0.0f, 0.0f, 1.0f}, 1.7f, 0.0f, 0.0f};
+    edge_styles_.fill(plain);
+    edge_styles_[CATEGORY_UNRELIABLE].color = {0.9f, 0.2f, 0.1f, 1.0f};
+    edge_styles_[CATEGORY_HIDDEN].width = 0.0f;
+    edge_styles_[CATEGORY_LAYER_BOUNDARY].color = {0.4f, 0.4f, 0.4f, 1.0f};
+    const std::array<float, 4> layer_colors[NUM_LAYER_COLORS] = {
+        {0.12f, 0.47f, 0.71f, 1.0f}, {1.0f, 0.5f, 0.05f, 1.0f},
+        {0.17f, 0.63f, 0.17f, 1.0f}, {0.58f, 0.4f, 0.74f, 1.0f},
+        {0.55f, 0.34f, 0.29f, 1.0f}, {0.89f, 0.47f, 0.76f, 1.0f},
+        {0.74f, 0.74f, 0.13f, 1.0f}, {0.09f, 0.75f, 0.81f, 1.0f}};
+    for (int i = 0; i < NUM_LAYER_COLORS; ++i) {
+      edge_styles_[CATEGORY_LAYER + i].color = layer_colors[i];
+    }
+    if (!edge_categories_styled_) {
+      return;
+    }
+    edge_styles_[CATEGORY_SECONDARY] =
+        edge_style{{0.55f, 0.55f, 0.55f, 1.0f}, 1.0f, 4.0f, 3.0f};
+    edge_styles_[CATEGORY_CURVED] =
+        edge_style{{0.0f, 0.35f, 0.7f, 1.0f}, 1.7f, 0.0f, 0.0f};
+    edge_styles_[CATEGORY_INFINITE] =
+        edge_style{{0.0f, 0.0f, 0.0f, 1.0f}, 1.7f, 10.0f, 5.0f};
+    edge_styles_[CATEGORY_UNRELIABLE].width = 2.5f;
+  }
+
+  void draw_selection() {
+    // Draw the region being selected.
+    point_type corners[4] = {
+      point_type(xl(selection_), yl(selection_)),
+      point_type(xh(selection_), yl(selection_)),
+      point_type(xh(selection_), yh(selection_)),
+      point_type(xl(selection_), yh(selection_)),
+    };
+    std::vector<GLPoint> outline;
+    for (point_type& corner : corners) {
+      corner = deconvolve(corner, shift_);
+      outline.emplace_back(corner.x(), corner.y());
+    }
+    upload_overlay(outline);
     glUseProgram(gl_program_);
     glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE, projection_matrix_.data());
-    std::array<float, 4> color{0.0f, 0.0f, 0.0f, 1.0f};
+    std::array<float, 4> color{0.9f, 0.2f, 0.1f, 1.0f};
     glUniform4fv(color_location_, 1, color.data());
-    glLineWidth(1.7f);
-    for (const VBO& edge_vbo : gl_edges_) {
-        glBindBuffer(GL_ARRAY_BUFFER, edge_vbo.id_);
-        glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glVertexAttribPointer(vertex_location_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glLineWidth(1.0f);
+    glEnableVertexAttribArray(vertex_location_);
+    glDrawArrays(GL_LINE_LOOP, 0, (GLsizei)outline.size());
+    glDisableVertexAttribArray(vertex_location_);
+  }
+
+  // Whether the edge passes the edge filters.
+  bool edge_visible(const edge_type& edge) const {
+    if (primary_edges_only_ && !edge.is_primary()) {
+      return false;
+    }
+    if (internal_edges_only_ && (edge.color() & EXTERNAL_COLOR)) {
+      return false;
+    }
+    return (edge_layers(edge) & ~visible_layers_) == 0;
+  }
+
+  static int tile_pack_layer(int style) {
+    switch (style & TILE_KIND_MASK) {
+      case TILE_SITE:
+        return PACK_SITES;
+      case TILE_SEGMENT:
+        return PACK_SEGMENTS;
+      default:
+        return (style & TILE_UNRELIABLE) ? PACK_UNRELIABLE_EDGES : PACK_EDGES;
+    }
+  }
+
+  // Unique for all the zoom levels a pack may have (up to 30): the tiles
+  // of level z follow the (4^z - 1) / 3 tiles of the levels above, so the
+  // keys also order the tiles by level.
+  static boost::uint64_t tile_pack_key(int z, int x, int y) {
+    boost::uint64_t level_start = ((boost::uint64_t(1) << (2 * z)) - 1) / 3;
+    return level_start + (static_cast<boost::uint64_t>(y) << z) +
+           static_cast<boost::uint64_t>(x);
+  }
+
+  // Centers the tile pack view on (cx, cy). The view is kept in shift_
+  // and brect_ as for a diagram, so that to_world and the glyph sizes work
+  // the same; recentering shift_ keeps the float positions exact at any
+  // zoom.
+  void set_pack_view(coordinate_type cx, coordinate_type cy,
+                     coordinate_type side) {
+    shift_ = point_type(cx, cy);
+    set_points(brect_, point_type(cx - 0.5 * side, cy - 0.5 * side),
+               point_type(cx + 0.5 * side, cy + 0.5 * side));
+    view_ = brect_;
+    pack_view_side_ = side;
+    update_view_port();
+  }
+
+  void close_tile_pack() {
+    std::vector<GLPackedTile> evicted;
+    tile_cache_.clear(&evicted);
+    for (const GLPackedTile& tile : evicted) {
+      retired_buffers_.push_back(tile.vbo_);
+    }
+    tile_pack_.reset();
+    panning_ = false;
+    pan_direction_ = point_type(0, 0);
+  }
+
+  // Zoom level whose tiles are shown at about TILE_SIZE pixels; the last
+  // level is magnified beyond that.
+  int tile_pack_zoom() const {
+    coordinate_type tiles = viewport_side_ * tile_pack_->side() /
+                            (pack_view_side_ * TILE_SIZE);
+    int z = static_cast<int>(std::floor(std::log2(tiles) + 0.5));
+    return (std::max)(0, (std::min)(z, tile_pack_->max_zoom()));
+  }
+
+  // Range of the tiles of level z covering the rectangle, clamped to the
+  // pyramid; empty if x1 > x2 or y1 > y2.
+  void tile_pack_range(int z, const rect_type& rect,
+                       int* x1, int* y1, int* x2, int* y2) const {
+    const int n = 1 << z;
+    const coordinate_type side = tile_pack_->side() / n;
+    const coordinate_type yh_pack = tile_pack_->yl() + tile_pack_->side();
+    *x1 = (std::max)(0, static_cast<int>(
+        std::floor((xl(rect) - tile_pack_->xl()) / side)));
+    *x2 = (std::min)(n - 1, static_cast<int>(
+        std::floor((xh(rect) - tile_pack_->xl()) / side)));
+    *y1 = (std::max)(0, static_cast<int>(
+        std::floor((yh_pack - yh(rect)) / side)));
+    *y2 = (std::min)(n - 1, static_cast<int>(
+        std::floor((yh_pack - yl(rect)) / side)));
+  }
+
+  GLPackedTile upload_packed_tile(const voronoi_tile_pack::tile_entry& entry,
+                                  std::size_t* bytes) {
+    GLPackedTile tile;
+    tile.entry_ = &entry;
+    std::size_t num_vertices = 0;
+    voronoi_tile_pack::layer_view layers[NUM_PACK_LAYERS];
+    for (int l = 0; l < NUM_PACK_LAYERS; ++l) {
+      layers[l] = tile_pack_->layer(entry, l);
+      tile.first_vertex_[l] = (GLint)num_vertices;
+      tile.num_vertices_[l] = (GLsizei)layers[l].num_vertices;
+      num_vertices += layers[l].num_vertices;
+    }
+    *bytes = num_vertices * 2 * sizeof(GLshort);
+    glGenBuffers(1, &tile.vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, tile.vbo_);
+    glBufferData(GL_ARRAY_BUFFER, *bytes, nullptr, GL_STATIC_DRAW);
+    for (int l = 0; l < NUM_PACK_LAYERS; ++l) {
+      const voronoi_tile_pack::layer_view& layer = layers[l];
+      glBufferSubData(GL_ARRAY_BUFFER,
+                      tile.first_vertex_[l] * 2 * sizeof(GLshort),
+                      layer.num_vertices * 2 * sizeof(GLshort),
+                      layer.coords);
+      for (std::size_t j = 0; j < layer.num_strips; ++j) {
+        std::size_t last = j + 1 < layer.num_strips ?
+            layer.strip_first[j + 1] : layer.num_vertices;
+        tile.strip_first_[l].push_back(
+            tile.first_vertex_[l] + (GLint)layer.strip_first[j]);
+        tile.strip_count_[l].push_back(
+            (GLsizei)(last - layer.strip_first[j]));
+      }
+    }
+    return tile;
+  }
+
+  // Projection of the 16 bit offsets of a packed tile.
+  std::array<float, 16> packed_tile_matrix(
+      const voronoi_tile_pack::tile_entry& entry) const {
+    const coordinate_type side = tile_pack_->side() / (1 << entry.z);
+    const coordinate_type step = side / tile_pack_->extent();
+    const coordinate_type tile_xl = tile_pack_->xl() + entry.x * side;
+    const coordinate_type tile_yl =
+        tile_pack_->yl() + tile_pack_->side() - (entry.y + 1) * side;
+    std::array<float, 16> matrix = projection_matrix_;
+    matrix[0] = projection_matrix_[0] * step;
+    matrix[5] = projection_matrix_[5] * step;
+    matrix[12] = projection_matrix_[0] * (tile_xl - shift_.x()) +
+                 projection_matrix_[12];
+    matrix[13] = projection_matrix_[5] * (tile_yl - shift_.y()) +
+                 projection_matrix_[13];
+    return matrix;
+  }
+
+  void draw_tile_pack() {
+    const int z = tile_pack_zoom();
+    int x1, y1, x2, y2;
+    tile_pack_range(z, brect_, &x1, &y1, &x2, &y2);
+    // Upload the missing tiles first, a few per frame; the tiles still
+    // missing are stood in for by their closest cached ancestor.
+    std::vector<GLPackedTile> evicted;
+    std::vector<boost::uint64_t> keys;
+    int uploads = 0;
+    for (int y = y1; y <= y2; ++y) {
+      for (int x = x1; x <= x2; ++x) {
+        const voronoi_tile_pack::tile_entry* entry =
+            tile_pack_->find(z, x, y);
+        if (entry == NULL) {
+          continue;
+        }
+        boost::uint64_t key = tile_pack_key(z, x, y);
+        if (tile_cache_.find(key) != NULL) {
+          keys.push_back(key);
+          continue;
+        }
+        if (uploads < PACK_UPLOADS_PER_FRAME) {
+          std::size_t bytes = 0;
+          GLPackedTile tile = upload_packed_tile(*entry, &bytes);
+          tile_cache_.insert(key, std::move(tile), bytes, &evicted);
+          keys.push_back(key);
+          ++uploads;
+          continue;
+        }
+        for (int up = 1; up <= z; ++up) {
+          boost::uint64_t ancestor = tile_pack_key(z - up, x >> up, y >> up);
+          if (tile_cache_.contains(ancestor)) {
+            keys.push_back(ancestor);
+            break;
+          }
+        }
+      }
+    }
+    for (const GLPackedTile& tile : evicted) {
+      glDeleteBuffers(1, &tile.vbo_);
+      tile_pack_->release(*tile.entry_);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<const GLPackedTile*> tiles;
+    for (boost::uint64_t key : keys) {
+      // Tiles evicted by this frame's uploads are not drawn.
+      const GLPackedTile* tile = tile_cache_.find(key);
+      if (tile != NULL) {
+        tiles.push_back(tile);
+      }
+    }
+
+    glUseProgram(gl_program_);
+    const int line_layers[] = {PACK_EDGES, PACK_UNRELIABLE_EDGES,
+                               PACK_SEGMENTS};
+    const std::array<float, 4> line_colors[] = {
+        {0.0f, 0.0f, 0.0f, 1.0f}, {0.9f, 0.2f, 0.1f, 1.0f},
+        {0.0f, 0.5f, 1.0f, 1.0f}};
+    const float line_widths[] = {1.7f, 1.7f, 2.7f};
+    for (int k = 0; k < 3; ++k) {
+      const int l = line_layers[k];
+      glUseProgram(gl_program_);
+      glUniform4fv(color_location_, 1, line_colors[k].data());
+      glLineWidth(line_widths[k]);
+      for (const GLPackedTile* tile : tiles) {
+        if (tile->strip_first_[l].empty()) {
+          continue;
+        }
+        glUniformMatrix4fv(mvp_matrix_location_, 1, GL_FALSE,
+                           packed_tile_matrix(*tile->entry_).data());
+        glBindBuffer(GL_ARRAY_BUFFER, tile->vbo_);
+        glVertexAttribPointer(vertex_location_, 2, GL_SHORT, GL_FALSE, 0,
+                              nullptr);
         glEnableVertexAttribArray(vertex_location_);
-        glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)edge_vbo.vertex_count_);
+        for (std::size_t i = 0; i < tile->strip_first_[l].size(); ++i) {
+          glDrawArrays(GL_LINE_STRIP, tile->strip_first_[l][i],
+                       tile->strip_count_[l][i]);
+        }
         glDisableVertexAttribArray(vertex_location_);
+      }
+    }
+    for (const GLPackedTile* tile : tiles) {
+      VBO sites(tile->vbo_, tile->num_vertices_[PACK_SITES],
+                tile->first_vertex_[PACK_SITES] * 2 * sizeof(GLshort));
+      const coordinate_type step = tile_pack_->side() /
+          (1 << tile->entry_->z) / tile_pack_->extent();
+      draw_glyph_buffer(sites, GL_SHORT, packed_tile_matrix(*tile->entry_),
+                        4.5f, step, {0.0f, 0.5f, 1.0f, 1.0f});
+    }
+    prefetch_tile_pack(z);
+  }
+
+  // Prefetches the tiles one view ahead in the pan direction.
+  void prefetch_tile_pack(int z) {
+    if (!panning_ || (pan_direction_.x() == 0 && pan_direction_.y() == 0)) {
+      return;
+    }
+    rect_type ahead = brect_;
+    move(ahead, HORIZONTAL, pan_direction_.x() * pack_view_side_);
+    move(ahead, VERTICAL, pan_direction_.y() * pack_view_side_);
+    int x1, y1, x2, y2;
+    tile_pack_range(z, ahead, &x1, &y1, &x2, &y2);
+    for (int y = y1; y <= y2; ++y) {
+      for (int x = x1; x <= x2; ++x) {
+        const voronoi_tile_pack::tile_entry* entry =
+            tile_pack_->find(z, x, y);
+        if (entry != NULL && !tile_cache_.contains(tile_pack_key(z, x, y))) {
+          tile_pack_->prefetch(*entry);
+        }
+      }
+    }
+  }
+
+  // Polylines of a run of edges, all samples stored back to back.
+  struct edge_polylines {
+    edge_polylines() : starts(1, 0) {}
+
+    std::vector<const edge_type*> edges;
+    std::vector<point_type> samples;
+    // Polyline i is samples[starts[i]..starts[i + 1]).
+    std::vector<std::size_t> starts;
+  };
+
+  // Stitches the edges accepted by filter, out of the given edge rows or
+  // of all the edges if there are none, into chains through the vertices
+  // of degree two, then samples the chains in parallel. Consecutive edges
+  // of a chain share the key and every polyline is one chain, edges[i]
+  // being its first edge; twin edges share the geometry and only one of
+  // them is sampled. The polylines follow the order of the chains in the
+  // deterministic mode of the parallel routines, the default; the free
+  // running mode appends the runs of chains as they complete.
+  template <typename Filter, typename Key>
+  void sample_edge_chains(
+      const std::vector<voronoi_attribute_filter::index_type>* rows,
+      Filter filter, Key key, edge_polylines* output) {
+    const edge_container_type& edges = vd_->edges();
+    std::vector<char> in_rows;
+    if (rows) {
+      in_rows.resize(edges.size(), 0);
+      for (std::size_t i = 0; i < rows->size(); ++i) {
+        in_rows[(*rows)[i]] = 1;
+      }
+    }
+    voronoi_edge_chains<VD> chains;
+    chains.stitch(*vd_, [&](const edge_type& edge) {
+      if (rows && !in_rows[&edge - &edges[0]] &&
+          !in_rows[edge.twin() - &edges[0]]) {
+        return false;
+      }
+      return filter(edge);
+    }, key);
+    voronoi_parallel_reduce(chains.size(), 1024, output,
+        [&](std::size_t first, std::size_t last, edge_polylines* partial) {
+      // sample_edge works on the polyline of a single edge.
+      std::vector<point_type> samples;
+      for (std::size_t i = first; i < last; ++i) {
+        const edge_type* const* it = chains.chain_begin(i);
+        partial->edges.push_back(*it);
+        for (; it != chains.chain_end(i); ++it) {
+          samples.clear();
+          sample_edge(**it, &samples);
+          // The first sample is the last one of the previous edge.
+          std::size_t skip = it == chains.chain_begin(i) ? 0 : 1;
+          partial->samples.insert(partial->samples.end(),
+                                  samples.begin() + skip, samples.end());
+        }
+        partial->starts.push_back(partial->samples.size());
+      }
+    }, [](edge_polylines* result, edge_polylines* partial) {
+      std::size_t offset = result->samples.size();
+      result->edges.insert(result->edges.end(), partial->edges.begin(),
+                           partial->edges.end());
+      result->samples.insert(result->samples.end(), partial->samples.begin(),
+                             partial->samples.end());
+      for (std::size_t i = 1; i < partial->starts.size(); ++i) {
+        result->starts.push_back(offset + partial->starts[i]);
+      }
+    });
+  }
+
+  // Polyline of the edge in the input coordinates; infinite edges are
+  // clipped and curved edges discretized.
+  void sample_edge(const edge_type& edge, std::vector<point_type>* samples) {
+    if (!edge.is_finite()) {
+      clip_infinite_edge(edge, samples);
+    } else {
+      point_type vertex0(edge.vertex0()->x(), edge.vertex0()->y());
+      samples->push_back(vertex0);
+      point_type vertex1(edge.vertex1()->x(), edge.vertex1()->y());
+      samples->push_back(vertex1);
+      if (edge.is_curved()) {
+        sample_curved_edge(edge, samples);
+      }
+    }
+  }
+
+  // Adds the sites, the segments and the edges to the pyramid. Unless
+  // all_edges is set only the sites and edges shown in the viewer are
+  // added.
+  void fill_tile_pyramid(bool all_edges, tile_pyramid_type* pyramid) {
+    for (std::size_t i = 0; i < point_data_.size(); ++i) {
+      if (!all_edges && !site_visible(i)) {
+        continue;
+      }
+      pyramid->add_point(x(point_data_[i]), y(point_data_[i]), TILE_SITE);
+    }
+    for (std::size_t i = 0; i < segment_data_.size(); ++i) {
+      if (!all_edges && !site_visible(point_data_.size() + i)) {
+        continue;
+      }
+      const segment_type& segment = segment_data_[i];
+      pyramid->begin_polyline(TILE_SEGMENT);
+      pyramid->add_vertex(x(low(segment)), y(low(segment)));
+      pyramid->add_vertex(x(high(segment)), y(high(segment)));
+      pyramid->add_point(x(low(segment)), y(low(segment)), TILE_SITE);
+      pyramid->add_point(x(high(segment)), y(high(segment)), TILE_SITE);
+    }
+    edge_polylines polylines;
+    // Chains keep one style, so the exported properties stay exact.
+    sample_edge_chains(all_edges ? NULL : filtered_edges(),
+                       [this, all_edges](const edge_type& edge) {
+      return all_edges || edge_visible(edge);
+    }, [](const edge_type& edge) {
+      return edge_tile_style(edge);
+    }, &polylines);
+    for (std::size_t i = 0; i < polylines.edges.size(); ++i) {
+      pyramid->begin_polyline(edge_tile_style(*polylines.edges[i]));
+      for (std::size_t j = polylines.starts[i]; j < polylines.starts[i + 1];
+           ++j) {
+        pyramid->add_vertex(polylines.samples[j].x(),
+                            polylines.samples[j].y());
+      }
+    }
+  }
+
+  static int edge_tile_style(const edge_type& edge) {
+    int style = TILE_EDGE;
+    if (edge.is_primary()) {
+      style |= TILE_PRIMARY;
+    }
+    if (!(edge.color() & EXTERNAL_COLOR)) {
+      style |= TILE_INTERNAL;
+    }
+    if (edge.is_curved()) {
+      style |= TILE_CURVED;
+    }
+    if (edge.color() & UNRELIABLE_COLOR) {
+      style |= TILE_UNRELIABLE;
+    }
+    return style;
+  }
+
+  // Bit mask of the vector tile edge properties, in the order of the
+  // property names: primary, internal, curved, unreliable.
+  static unsigned edge_properties_mask(int style) {
+    return ((style & TILE_PRIMARY) ? 1 : 0) |
+           ((style & TILE_INTERNAL) ? 2 : 0) |
+           ((style & TILE_CURVED) ? 4 : 0) |
+           ((style & TILE_UNRELIABLE) ? 8 : 0);
+  }
+
+  // Renders the items of one tile of the level, using the viewer colors.
+  static QImage render_tile(const tile_pyramid_type& pyramid,
+                            const tile_pyramid_type::level& level,
+                            std::size_t index) {
+    QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(0, 0, 0, 0));
+    coordinate_type txl, tyl, txh, tyh;
+    pyramid.tile_bounds(level.tiles[index], &txl, &tyl, &txh, &tyh);
+    const coordinate_type scale = TILE_SIZE / (txh - txl);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    std::vector<QPointF> polyline;
+    for (std::size_t i = level.item_start[index];
+         i < level.item_start[index + 1]; ++i) {
+      std::size_t item = level.items[i];
+      const coordinate_type* c = pyramid.item_coords(item);
+      polyline.clear();
+      for (std::size_t j = 0; j < pyramid.item_size(item); ++j) {
+        polyline.push_back(QPointF((c[2 * j] - txl) * scale,
+                                   (tyh - c[2 * j + 1]) * scale));
+      }
+      int style = pyramid.item_style(item);
+      switch (style & TILE_KIND_MASK) {
+        case TILE_SITE:
+          painter.setPen(Qt::NoPen);
+          painter.setBrush(QColor(0, 128, 255));
+          painter.drawEllipse(polyline[0], 2.5, 2.5);
+          break;
+        case TILE_SEGMENT:
+          painter.setPen(QPen(QColor(0, 128, 255), 2.0));
+          painter.drawPolyline(polyline.data(), (int)polyline.size());
+          break;
+        case TILE_EDGE:
+          painter.setPen(QPen((style & TILE_UNRELIABLE) ?
+                              QColor(230, 51, 26) : QColor(0, 0, 0), 1.0));
+          painter.drawPolyline(polyline.data(), (int)polyline.size());
+          break;
+      }
+    }
+    return image;
+  }
+
+  // Whether nothing was drawn into the tile; the items of a tile may only
+  // pass nearby.
+  static bool is_blank(const QImage& image) {
+    for (int j = 0; j < image.height(); ++j) {
+      const QRgb* row = reinterpret_cast<const QRgb*>(image.constScanLine(j));
+      for (int i = 0; i < image.width(); ++i) {
+        if (qAlpha(row[i]) != 0) {
+          return false;
+        }
+      }
     }
+    return true;
   }
 
   void clip_infinite_edge(
@@ -564,48 +3332,194 @@ class GLWidget : public QOpenGLWidget, public QOpenGLFunctions {
     return segment_data_[index];
   }
 
+  // Declared first so that it outlives everything retired into it.
+  voronoi_retirement_queue retirement_queue_;
   point_type shift_;
   std::vector<point_type> point_data_;
   std::vector<segment_type> segment_data_;
   rect_type brect_;
+  // Area shown by the viewer, brect_ unless zoomed.
+  rect_type view_;
+  // Declared before vb_ that returns its nodes here on destruction.
+  voronoi_node_pool node_pool_;
   VB vb_;
-  VD vd_;
+  std::unique_ptr<VD> vd_;
+  instrumented_builder_type instrumented_builder_;
+  bool record_telemetry_ = false;
+  // Written by the build thread, printed once the build is collected.
+  bool telemetry_ready_ = false;
+  voronoi_builder_telemetry telemetry_;
   bool brect_initialized_;
   bool primary_edges_only_;
   bool internal_edges_only_;
+  voronoi_attribute_table edge_attributes_;
+  voronoi_attribute_filter edge_filter_;
+  std::vector<voronoi_attribute_filter::index_type> filtered_edges_;
+  bool edge_filter_dirty_ = true;
+  bool winding_classifier_;
+  bool region_only_;
+  bool region_build_;
+  rect_type region_;
+  QString file_path_;
+  bool selecting_;
+  point_type selection_start_;
+  rect_type selection_;
 
   std::array<float, 16> projection_matrix_{};
-  std::vector<VBO> gl_points_;
-  VBO gl_segments_{0, 0};
-  std::vector<VBO> gl_vertices_;
-  std::vector<VBO> gl_edges_;
+  quantized_layer_type site_layer_;
+  GLLayer gl_points_;
+  GLLayer gl_segments_;
+  GLLayer gl_vertices_;
+  GLLayer gl_edges_;
+  std::array<edge_style, NUM_EDGE_STYLES> edge_styles_;
+  bool edge_categories_styled_ = false;
+  // Layer of every site of a layered build, empty otherwise, and the
+  // visible layers, which the build thread reads for the site glyphs.
+  std::vector<unsigned char> site_layers_;
+  std::atomic<boost::uint32_t> visible_layers_{~0u};
+  bool site_points_dirty_ = false;
+  bool color_by_layer_ = false;
+  std::unique_ptr<voronoi_tile_pack> tile_pack_;
+  tile_cache_type tile_cache_{PACK_CACHE_BUDGET};
+  coordinate_type pack_view_side_ = 1;
+  bool panning_ = false;
+  QPoint pan_last_;
+  // Unit vector of the last pan step, in the input coordinates.
+  point_type pan_direction_;
+  VBO gl_overlay_{0, 0};
+  std::vector<GLArena> gl_arenas_;
+  std::vector<GLuint> retired_buffers_;
+  GLPoolStats pool_stats_;
+  size_t reported_allocations_ = 0;
   GLuint gl_program_;
   GLuint vertex_shader_;
   GLuint fragment_shader_;
   GLint mvp_matrix_location_;
   GLint vertex_location_;
   GLint color_location_;
+  GLuint glyph_program_;
+  GLint glyph_mvp_matrix_location_;
+  GLint glyph_radius_location_;
+  GLint glyph_color_location_;
+  GLint glyph_offset_location_;
+  GLint glyph_center_location_;
+  VBO gl_circle_{0, 0};
+  // Whether the context supports instanced drawing, see initializeGL.
+  bool instancing_ = false;
+  GLuint point_glyph_program_;
+  GLint point_glyph_mvp_matrix_location_;
+  GLint point_glyph_size_location_;
+  GLint point_glyph_color_location_;
+  GLint point_glyph_center_location_;
+  GLuint edge_program_;
+  GLint edge_mvp_matrix_location_;
+  GLint edge_viewport_size_location_;
+  GLint edge_pixels_per_unit_location_;
+  GLint edge_style_colors_location_;
+  GLint edge_style_strokes_location_;
+  GLint edge_corner_location_;
+  GLint edge_start_location_;
+  GLint edge_end_location_;
+  GLint edge_category_location_;
+  GLint edge_arc_length_location_;
+  GLuint edge_corner_vbo_;
+
+  std::future<void> build_future_;
+  std::future<std::unique_ptr<startup_build> > startup_future_;
+  bool diagram_preloaded_ = false;
+  bool report_startup_ = false;
+  double startup_input_ms_ = 0;
+  // Time from the process start until the first diagram was drawn, zero
+  // once reported.
+  double startup_diagram_ms_ = 0;
+  typedef voronoi_raster_preview<coordinate_type> site_locator_type;
+  std::unique_ptr<site_locator_type> site_locator_;
+  std::size_t hovered_site_ = site_locator_type::NO_SITE;
+  std::unique_ptr<QOpenGLFramebufferObject> static_layer_;
+  std::unique_ptr<QOpenGLFramebufferObject> multisample_layer_;
+  bool static_layer_dirty_ = true;
+  int viewport_x_ = 0;
+  int viewport_y_ = 0;
+  int viewport_side_ = 1;
+  int preview_side_;
+  std::vector<GLubyte> preview_pixels_;
+  bool preview_dirty_ = false;
+  GLuint preview_texture_ = 0;
+  GLuint label_program_;
+  GLint label_mvp_matrix_location_;
+  GLint label_origin_location_;
+  GLint label_advance_location_;
+  GLint label_cell_size_location_;
+  GLint label_atlas_grid_location_;
+  GLint label_sampler_location_;
+  GLint label_color_location_;
+  GLint label_halo_color_location_;
+  GLint label_smoothing_location_;
+  GLint label_corner_location_;
+  GLint label_glyph_location_;
+  GLuint label_corner_vbo_;
+  GLuint label_vbo_;
+  GLuint label_atlas_texture_;
+  // Advance of the font in atlas texels.
+  float label_advance_ = 0.0f;
+  std::size_t num_label_glyphs_ = 0;
+  bool labels_dirty_ = true;
+  GLuint texture_program_;
+  GLint texture_vertex_location_;
+  GLint texture_coord_location_;
+  GLint sampler_location_;
+  GLuint quad_vbo_;
 };
 
+constexpr std::size_t GLWidget::MAX_LABELED_SITES;
+
 class MainWindow : public QWidget {
   Q_OBJECT
 
  public:
   MainWindow() {
     glWidget_ = new GLWidget();
+    connect(glWidget_, SIGNAL(build_finished()), this, SLOT(build_finished()));
+    connect(glWidget_, SIGNAL(status_changed(const QString&)),
+            this, SLOT(status_changed(const QString&)));
     file_dir_ = QDir(QDir::currentPath(), tr("*.txt"));
     file_name_ = tr("");
 
+    QString cache_dir =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        tr("/thumbnails");
+    if (!QDir().mkpath(cache_dir)) {
+      cache_dir.clear();
+    }
+    // Half of the cores, the thumbnails compete with the builds otherwise.
+    thumbnails_.reset(new voronoi_thumbnail_queue(
+        cache_dir.toLocal8Bit().constData(), THUMBNAIL_SIZE,
+        (voronoi_thread_count() + 1) / 2));
+    startTimer(100);
+
     QHBoxLayout* centralLayout = new QHBoxLayout;
     centralLayout->addWidget(glWidget_);
     centralLayout->addLayout(create_file_layout());
     setLayout(centralLayout);
 
-    update_file_list();
+    // Listing a large directory would delay the first frame.
+    QTimer::singleShot(0, this, SLOT(update_file_list()));
     setWindowTitle(tr("Voronoi Visualizer"));
     layout()->setSizeConstraint(QLayout::SetFixedSize);
   }
 
+  // Shows the file given on the command line and lists its directory.
+  void build_startup_file(
+      const QString& file_path,
+      std::future<std::unique_ptr<startup_build> > startup) {
+    QFileInfo file_info(file_path);
+    file_dir_ = QDir(file_info.absolutePath(), tr("*.txt"));
+    file_name_ = file_info.fileName();
+    message_label_->setText("Building...");
+    glWidget_->build(file_path, std::move(startup));
+    setWindowTitle(tr("Voronoi Visualizer - ") + file_path);
+  }
+
  private slots:
   void primary_edges_only() {
     glWidget_->show_primary_edges_only();
@@ -615,6 +3529,35 @@ class MainWindow : public QWidget {
     glWidget_->show_internal_edges_only();
   }
 
+  void edge_categories() {
+    glWidget_->style_edge_categories();
+  }
+
+  void winding_classifier() {
+    glWidget_->classify_by_winding_numbers();
+  }
+
+  void region_only() {
+    glWidget_->build_region_only();
+  }
+
+  void builder_telemetry() {
+    glWidget_->record_builder_telemetry();
+  }
+
+  void deterministic() {
+    glWidget_->run_deterministic();
+  }
+
+  void edge_filter() {
+    QString error;
+    if (!glWidget_->set_edge_filter(edge_filter_edit_->text(), &error)) {
+      message_label_->setText(tr("Edge filter: ") + error);
+      return;
+    }
+    message_label_->setText("Double click the item to build voronoi diagram:");
+  }
+
   void browse() {
     QString new_path = QFileDialog::getExistingDirectory(
         0, tr("Choose Directory"), file_dir_.absolutePath());
@@ -629,11 +3572,59 @@ class MainWindow : public QWidget {
     file_name_ = file_list_->currentItem()->text();
     QString file_path = file_dir_.filePath(file_name_);
     message_label_->setText("Building...");
+    layer_list_->clear();
     glWidget_->build(file_path);
-    message_label_->setText("Double click the item to build voronoi diagram:");
     setWindowTitle(tr("Voronoi Visualizer - ") + file_path);
   }
 
+  // Builds the selected files as the layers of one diagram, in the order
+  // of the list.
+  void build_layers() {
+    std::vector<int> rows;
+    for (QListWidgetItem* item : file_list_->selectedItems()) {
+      rows.push_back(file_list_->row(item));
+    }
+    if (rows.empty()) {
+      return;
+    }
+    std::sort(rows.begin(), rows.end());
+    QStringList file_paths;
+    // Unchecking an item hides its layer, see layer_visibility.
+    layer_list_->blockSignals(true);
+    layer_list_->clear();
+    for (int row : rows) {
+      QString file_name = file_list_->item(row)->text();
+      file_paths.append(file_dir_.filePath(file_name));
+      QListWidgetItem* item = new QListWidgetItem(file_name);
+      item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+      item->setCheckState(Qt::Checked);
+      layer_list_->addItem(item);
+    }
+    layer_list_->blockSignals(false);
+    file_name_ = file_list_->item(rows.front())->text();
+    message_label_->setText("Building...");
+    glWidget_->build(file_paths);
+    setWindowTitle(tr("Voronoi Visualizer - %1 layers in ").arg(rows.size()) +
+                   file_dir_.absolutePath());
+  }
+
+  void layer_visibility(QListWidgetItem* item) {
+    glWidget_->set_layer_visible(layer_list_->row(item),
+                                 item->checkState() == Qt::Checked);
+  }
+
+  void color_by_layer() {
+    glWidget_->color_edges_by_layer();
+  }
+
+  void build_finished() {
+    message_label_->setText("Double click the item to build voronoi diagram:");
+  }
+
+  void status_changed(const QString& message) {
+    message_label_->setText(message);
+  }
+
   void print_scr() {
     if (!file_name_.isEmpty()) {
       QImage screenshot = glWidget_->grabFramebuffer();
@@ -643,17 +3634,171 @@ class MainWindow : public QWidget {
     }
   }
 
+  void export_tiles() {
+    if (file_name_.isEmpty() || glWidget_->is_building()) {
+      return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(
+        0, tr("Choose Tile Directory"), file_dir_.absolutePath());
+    if (directory.isEmpty()) {
+      return;
+    }
+    bool ok = false;
+    int max_zoom = QInputDialog::getInt(
+        this, tr("Export Map Tiles"), tr("Maximum zoom level:"),
+        5, 0, 16, 1, &ok);
+    if (!ok) {
+      return;
+    }
+    QStringList formats;
+    formats << tr("png");
+    for (const QByteArray& format : QImageWriter::supportedImageFormats()) {
+      if (format == "webp") {
+        formats << tr("webp");
+      }
+    }
+    QString format = QInputDialog::getItem(
+        this, tr("Export Map Tiles"), tr("Tile format:"), formats, 0, false,
+        &ok);
+    if (!ok) {
+      return;
+    }
+    message_label_->setText("Exporting tiles...");
+    std::size_t num_tiles =
+        glWidget_->export_tiles(directory, max_zoom, format);
+    message_label_->setText(tr("Exported %1 tiles.").arg(num_tiles));
+  }
+
+  void export_vector_tiles() {
+    if (file_name_.isEmpty() || glWidget_->is_building()) {
+      return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(
+        0, tr("Choose Tile Directory"), file_dir_.absolutePath());
+    if (directory.isEmpty()) {
+      return;
+    }
+    bool ok = false;
+    int max_zoom = QInputDialog::getInt(
+        this, tr("Export Vector Tiles"), tr("Maximum zoom level:"),
+        5, 0, 16, 1, &ok);
+    if (!ok) {
+      return;
+    }
+    message_label_->setText("Exporting vector tiles...");
+    std::size_t num_tiles =
+        glWidget_->export_vector_tiles(directory, max_zoom);
+    message_label_->setText(tr("Exported %1 vector tiles.").arg(num_tiles));
+  }
+
+  void export_tile_pack() {
+    if (file_name_.isEmpty() || glWidget_->is_building()) {
+      return;
+    }
+    QString path = QFileDialog::getSaveFileName(
+        0, tr("Export Render Tile Pack"),
+        file_dir_.filePath(file_name_.left(file_name_.indexOf('.')) +
+                           tr(".vtpk")),
+        tr("Tile packs (*.vtpk)"));
+    if (path.isEmpty()) {
+      return;
+    }
+    bool ok = false;
+    int max_zoom = QInputDialog::getInt(
+        this, tr("Export Render Tile Pack"), tr("Maximum zoom level:"),
+        8, 0, 20, 1, &ok);
+    if (!ok) {
+      return;
+    }
+    message_label_->setText("Exporting the tile pack...");
+    std::size_t num_tiles = glWidget_->export_tile_pack(path, max_zoom);
+    message_label_->setText(tr("Exported %1 packed tiles.").arg(num_tiles));
+  }
+
+  void open_tile_pack() {
+    QString path = QFileDialog::getOpenFileName(
+        0, tr("Open Render Tile Pack"), file_dir_.absolutePath(),
+        tr("Tile packs (*.vtpk)"));
+    if (path.isEmpty()) {
+      return;
+    }
+    file_name_.clear();
+    if (glWidget_->open_tile_pack(path)) {
+      setWindowTitle(tr("Voronoi Visualizer - ") + path);
+    }
+  }
+
+  void update_file_list() {
+    QFileInfoList list = file_dir_.entryInfoList();
+    file_list_->clear();
+    thumbnail_items_.clear();
+    thumbnails_->forget();
+    if (file_dir_.count() == 0) {
+      return;
+    }
+    QFileInfoList::const_iterator it;
+    for (it = list.begin(); it != list.end(); it++) {
+      file_list_->addItem(it->fileName());
+    }
+    file_list_->setCurrentRow(0);
+    // The rows are laid out by then.
+    QTimer::singleShot(0, this, SLOT(request_thumbnails()));
+  }
+
+  // Requests the thumbnails of the rows on screen, the ones of the rows
+  // scrolled past meanwhile are dropped unless already started.
+  void request_thumbnails() {
+    if (file_list_->count() == 0) {
+      return;
+    }
+    int first = file_list_->indexAt(QPoint(0, 0)).row();
+    int last = file_list_->indexAt(
+        QPoint(0, file_list_->viewport()->height() - 1)).row();
+    if (first < 0) {
+      return;
+    }
+    if (last < 0) {
+      last = file_list_->count() - 1;
+    }
+    std::vector<std::string> paths;
+    for (int row = first; row <= last; ++row) {
+      QListWidgetItem* item = file_list_->item(row);
+      QString path = file_dir_.filePath(item->text());
+      paths.push_back(path.toLocal8Bit().constData());
+      thumbnail_items_[paths.back()] = item;
+    }
+    thumbnails_->request(paths);
+  }
+
  private:
   QGridLayout* create_file_layout() {
     QGridLayout* file_layout = new QGridLayout;
 
     message_label_ = new QLabel("Double click item to build voronoi diagram:");
 
+    // Uniform rows let the view lay out and paint the visible rows only,
+    // independent of the number of files.
     file_list_ = new QListWidget();
+    file_list_->setUniformItemSizes(true);
+    file_list_->setIconSize(QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
+    connect(file_list_->verticalScrollBar(), SIGNAL(valueChanged(int)),
+        this, SLOT(request_thumbnails()));
     file_list_->connect(file_list_,
                         SIGNAL(itemDoubleClicked(QListWidgetItem*)),
                         this,
                         SLOT(build()));
+    file_list_->setSelectionMode(QAbstractItemView::ExtendedSelection);
+
+    QPushButton* build_layers_button =
+        new QPushButton(tr("Build Selected Files as Layers"));
+    connect(build_layers_button, SIGNAL(clicked()),
+        this, SLOT(build_layers()));
+
+    // Layers of the last layered build, unchecked ones are hidden.
+    layer_list_ = new QListWidget();
+    layer_list_->setMaximumHeight(100);
+    connect(layer_list_, SIGNAL(itemChanged(QListWidgetItem*)),
+        this, SLOT(layer_visibility(QListWidgetItem*)));
 
     QCheckBox* primary_checkbox = new QCheckBox("Show primary edges only.");
     connect(primary_checkbox, SIGNAL(clicked()),
@@ -663,6 +3808,43 @@ class MainWindow : public QWidget {
     connect(internal_checkbox, SIGNAL(clicked()),
         this, SLOT(internal_edges_only()));
 
+    QCheckBox* categories_checkbox =
+        new QCheckBox("Style edges by category.");
+    connect(categories_checkbox, SIGNAL(clicked()),
+        this, SLOT(edge_categories()));
+
+    QCheckBox* layer_colors_checkbox =
+        new QCheckBox("Color edges by layer.");
+    connect(layer_colors_checkbox, SIGNAL(clicked()),
+        this, SLOT(color_by_layer()));
+
+    QCheckBox* winding_checkbox =
+        new QCheckBox("Classify internal edges by winding numbers.");
+    connect(winding_checkbox, SIGNAL(clicked()),
+        this, SLOT(winding_classifier()));
+
+    QCheckBox* region_checkbox =
+        new QCheckBox("Build selected region only (drag to select).");
+    connect(region_checkbox, SIGNAL(clicked()),
+        this, SLOT(region_only()));
+
+    QCheckBox* telemetry_checkbox =
+        new QCheckBox("Print builder telemetry after each build.");
+    connect(telemetry_checkbox, SIGNAL(clicked()),
+        this, SLOT(builder_telemetry()));
+
+    QCheckBox* deterministic_checkbox =
+        new QCheckBox("Deterministic parallel execution.");
+    deterministic_checkbox->setChecked(true);
+    connect(deterministic_checkbox, SIGNAL(clicked()),
+        this, SLOT(deterministic()));
+
+    edge_filter_edit_ = new QLineEdit();
+    edge_filter_edit_->setPlaceholderText(
+        tr("Edge filter, e.g. primary && length > 50 && !curved"));
+    connect(edge_filter_edit_, SIGNAL(returnPressed()),
+        this, SLOT(edge_filter()));
+
     QPushButton* browse_button =
         new QPushButton(tr("Browse Input Directory"));
     connect(browse_button, SIGNAL(clicked()), this, SLOT(browse()));
@@ -672,44 +3854,130 @@ class MainWindow : public QWidget {
     connect(print_scr_button, SIGNAL(clicked()), this, SLOT(print_scr()));
     print_scr_button->setMinimumHeight(50);
 
+    QPushButton* export_tiles_button = new QPushButton(tr("Export Map Tiles"));
+    connect(export_tiles_button, SIGNAL(clicked()),
+        this, SLOT(export_tiles()));
+    export_tiles_button->setMinimumHeight(50);
+
+    QPushButton* export_vector_tiles_button =
+        new QPushButton(tr("Export Vector Tiles"));
+    connect(export_vector_tiles_button, SIGNAL(clicked()),
+        this, SLOT(export_vector_tiles()));
+    export_vector_tiles_button->setMinimumHeight(50);
+
+    QPushButton* export_tile_pack_button =
+        new QPushButton(tr("Export Render Tile Pack"));
+    connect(export_tile_pack_button, SIGNAL(clicked()),
+        this, SLOT(export_tile_pack()));
+    export_tile_pack_button->setMinimumHeight(50);
+
+    QPushButton* open_tile_pack_button =
+        new QPushButton(tr("Open Render Tile Pack"));
+    connect(open_tile_pack_button, SIGNAL(clicked()),
+        this, SLOT(open_tile_pack()));
+    open_tile_pack_button->setMinimumHeight(50);
+
     file_layout->addWidget(message_label_, 0, 0);
     file_layout->addWidget(file_list_, 1, 0);
-    file_layout->addWidget(primary_checkbox, 2, 0);
-    file_layout->addWidget(internal_checkbox, 3, 0);
-    file_layout->addWidget(browse_button, 4, 0);
-    file_layout->addWidget(print_scr_button, 5, 0);
+    file_layout->addWidget(build_layers_button, 2, 0);
+    file_layout->addWidget(layer_list_, 3, 0);
+    file_layout->addWidget(primary_checkbox, 4, 0);
+    file_layout->addWidget(internal_checkbox, 5, 0);
+    file_layout->addWidget(categories_checkbox, 6, 0);
+    file_layout->addWidget(layer_colors_checkbox, 7, 0);
+    file_layout->addWidget(winding_checkbox, 8, 0);
+    file_layout->addWidget(region_checkbox, 9, 0);
+    file_layout->addWidget(telemetry_checkbox, 10, 0);
+    file_layout->addWidget(deterministic_checkbox, 11, 0);
+    file_layout->addWidget(edge_filter_edit_, 12, 0);
+    file_layout->addWidget(browse_button, 13, 0);
+    file_layout->addWidget(print_scr_button, 14, 0);
+    file_layout->addWidget(export_tiles_button, 15, 0);
+    file_layout->addWidget(export_vector_tiles_button, 16, 0);
+    file_layout->addWidget(export_tile_pack_button, 17, 0);
+    file_layout->addWidget(open_tile_pack_button, 18, 0);
 
     return file_layout;
   }
 
-  void update_file_list() {
-    QFileInfoList list = file_dir_.entryInfoList();
-    file_list_->clear();
-    if (file_dir_.count() == 0) {
-      return;
-    }
-    QFileInfoList::const_iterator it;
-    for (it = list.begin(); it != list.end(); it++) {
-      file_list_->addItem(it->fileName());
+  // Sets the icons of the thumbnails finished meanwhile.
+  void timerEvent(QTimerEvent*) {
+    std::string path;
+    voronoi_thumbnail_queue::pixel_container_type pixels;
+    while (thumbnails_->take_result(&path, &pixels)) {
+      // Results of the files of another directory find no item.
+      std::map<std::string, QListWidgetItem*>::const_iterator it =
+          thumbnail_items_.find(path);
+      if (it == thumbnail_items_.end()) {
+        continue;
+      }
+      QImage image(pixels.data(), THUMBNAIL_SIZE, THUMBNAIL_SIZE,
+                   THUMBNAIL_SIZE, QImage::Format_Grayscale8);
+      // The image does not own the pixels, fromImage copies them.
+      it->second->setIcon(QIcon(QPixmap::fromImage(image)));
     }
-    file_list_->setCurrentRow(0);
   }
 
+  static const int THUMBNAIL_SIZE = 48;
+
   QDir file_dir_;
   QString file_name_;
   GLWidget* glWidget_;
   QListWidget* file_list_;
+  QListWidget* layer_list_;
   QLabel* message_label_;
+  QLineEdit* edge_filter_edit_;
+  std::unique_ptr<voronoi_thumbnail_queue> thumbnails_;
+  // Items of the files whose thumbnails were requested, by path. Cleared
+  // with the file list.
+  std::map<std::string, QListWidgetItem*> thumbnail_items_;
 };
 
+// Guess of the file given on the command line, made before QApplication
+// takes out its options: the first argument that neither is an option nor
+// follows one, such as the value of "-platform xcb".
+static std::string guess_startup_path(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i][0] != '-' && argv[i - 1][0] != '-') {
+      return argv[i];
+    }
+  }
+  return std::string();
+}
+
 int main(int argc, char* argv[]) {
+  process_start_time = std::chrono::steady_clock::now();
+  // Start on the command line file right away, Qt and the GL context are
+  // initialized meanwhile. A wrong guess is kept until the exit, the
+  // destructor of its future waits for the build to finish.
+  std::string guessed_path = guess_startup_path(argc, argv);
+  std::future<std::unique_ptr<startup_build> > guessed_startup;
+  if (!guessed_path.empty()) {
+    guessed_startup = std::async(std::launch::async, &startup_build::run,
+                                 guessed_path);
+  }
+
   QSurfaceFormat surfaceFormat = QSurfaceFormat::defaultFormat();
   surfaceFormat.setSamples(4);
   surfaceFormat.setProfile(QSurfaceFormat::OpenGLContextProfile::CompatibilityProfile);
   QSurfaceFormat::setDefaultFormat(surfaceFormat);
 
   QApplication app(argc, argv);
+  // The guess is checked against the arguments left once QApplication
+  // took out the Qt options.
+  QStringList arguments = QApplication::arguments();
+  QString startup_path = arguments.size() > 1 ? arguments.at(1) : QString();
+  std::string path(startup_path.toLocal8Bit().constData());
+  std::future<std::unique_ptr<startup_build> > startup;
+  if (path == guessed_path) {
+    startup = std::move(guessed_startup);
+  } else if (!path.empty()) {
+    startup = std::async(std::launch::async, &startup_build::run, path);
+  }
   MainWindow window;
+  if (startup.valid()) {
+    window.build_startup_file(startup_path, std::move(startup));
+  }
   window.show();
   return app.exec();
 }